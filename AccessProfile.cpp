@@ -0,0 +1,77 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <AccessProfile.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+CAccessProfile::CAccessProfile( CUnicodeView fileName )
+{
+	const CUnicodeString contents = File::ReadUnicodeText( fileName );
+	const int length = contents.Length();
+	for( int lineStart = 0; lineStart < length; ) {
+		int lineEnd = contents.Find( L'\n', lineStart );
+		if( lineEnd == NotFound ) {
+			lineEnd = length;
+		}
+		const CUnicodePart line = contents.Mid( lineStart, lineEnd - lineStart ).TrimSpaces();
+		lineStart = lineEnd + 1;
+
+		if( !line.IsEmpty() && line[0] != L';' ) {
+			parseLine( fileName, line );
+		}
+	}
+}
+
+int64_t CAccessProfile::GetCount( int messageId ) const
+{
+	const int64_t* count = counts.Get( messageId );
+	return count != nullptr ? *count : 0;
+}
+
+extern const CError Err_BadProfileLine( L"Invalid access profile line. Expected format: <message ID> <count>.\nFile name: %0. Line: %1." );
+void CAccessProfile::parseLine( CUnicodeView fileName, CUnicodePart line )
+{
+	int idEnd = 0;
+	while( idEnd < line.Length() && line[idEnd] != L' ' && line[idEnd] != L'\t' ) {
+		idEnd++;
+	}
+	int countStart = idEnd;
+	while( countStart < line.Length() && ( line[countStart] == L' ' || line[countStart] == L'\t' ) ) {
+		countStart++;
+	}
+
+	int64_t id = 0;
+	int64_t count = 0;
+	const bool isValid = parseNumber( line.Mid( 0, idEnd ), 9, id ) && parseNumber( line.Mid( countStart ), 18, count );
+	check( isValid, Err_BadProfileLine, fileName, line );
+	const int messageId = static_cast<int>( id );
+	int64_t* totalCount = counts.Get( messageId );
+	if( totalCount != nullptr ) {
+		*totalCount = AddCounts( *totalCount, count );
+	} else {
+		counts.Add( messageId, count );
+	}
+}
+
+// Parse a decimal number of at most the given number of digits, so that it can't overflow.
+bool CAccessProfile::parseNumber( CUnicodePart str, int maxLength, int64_t& result )
+{
+	if( str.IsEmpty() || str.Length() > maxLength ) {
+		return false;
+	}
+	result = 0;
+	for( int i = 0; i < str.Length(); i++ ) {
+		if( !CUnicodeString::IsCharDigit( str[i] ) ) {
+			return false;
+		}
+		result = result * 10 + ( str[i] - L'0' );
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Numbers of lookups of the messages, recorded by an application and used to lay out the mapped format.
+// File format: one entry per line, <message ID> <count> separated by spaces or tabs. Lines starting with ; are comments.
+// Counts of a repeated ID are added up. The IDs are the message IDs of the binary output, so the profile stays valid
+// between compilations only if the IDs are stable.
+class CAccessProfile {
+public:
+	explicit CAccessProfile( CUnicodeView fileName );
+
+	// Number of lookups of a message. Messages that are absent from the profile have zero lookups.
+	int64_t GetCount( int messageId ) const;
+	// Sum of two counts. Counts can have 18 digits, so the sum saturates at INT64_MAX instead of overflowing.
+	static int64_t AddCounts( int64_t left, int64_t right )
+		{ return left > INT64_MAX - right ? INT64_MAX : left + right; }
+
+private:
+	// Counts by message ID. A profile lists only the used messages and its IDs are not bounded by a table, so the counts are sparse.
+	CMap<int, int64_t> counts;
+
+	void parseLine( CUnicodeView fileName, CUnicodePart line );
+	static bool parseNumber( CUnicodePart str, int maxLength, int64_t& result );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,101 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <BatchCompiler.h>
+#include <MessageCompiler.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// The files are compiled in parallel, so by default every file is parsed on a single thread.
+// Parsing on every hardware thread in every batch worker would run many more threads than there are cores.
+CBatchCompiler::CBatchCompiler( int workerCount, const CCompilerOptions& _options ) :
+	workers( workerCount ),
+	options( _options )
+{
+	if( options.ParseWorkerCount == 0 && workers.WorkerCount() > 1 ) {
+		options.ParseWorkerCount = 1;
+	}
+}
+
+void CBatchCompiler::AddManifest( CUnicodeView manifestName )
+{
+	const CUnicodeString manifest = File::ReadUnicodeText( manifestName );
+	const int length = manifest.Length();
+	for( int lineStart = 0; lineStart < length; ) {
+		int lineEnd = manifest.Find( L'\n', lineStart );
+		if( lineEnd == NotFound ) {
+			lineEnd = length;
+		}
+		const CUnicodePart line = manifest.Mid( lineStart, lineEnd - lineStart ).TrimSpaces();
+		lineStart = lineEnd + 1;
+
+		if( !line.IsEmpty() && line[0] != L';' ) {
+			addManifestLine( manifestName, line );
+		}
+	}
+}
+
+extern const CError Err_BadManifestLine( L"Manifest line must contain three file names separated by '|'.\nManifest name: %0. Line: %1." );
+void CBatchCompiler::addManifestLine( CUnicodeView manifestName, CUnicodePart line )
+{
+	const wchar_t separator = L'|';
+	const int firstSeparator = line.Find( separator );
+	check( firstSeparator != NotFound, Err_BadManifestLine, manifestName, line );
+	const int secondSeparator = line.Find( separator, firstSeparator + 1 );
+	check( secondSeparator != NotFound, Err_BadManifestLine, manifestName, line );
+
+	const CUnicodeString msgFile = UnicodeStr( line.Mid( 0, firstSeparator ).TrimSpaces() );
+	const CUnicodeString srcOutputName = UnicodeStr( line.Mid( firstSeparator + 1, secondSeparator - firstSeparator - 1 ).TrimSpaces() );
+	const CUnicodeString binOutputName = UnicodeStr( line.Mid( secondSeparator + 1 ).TrimSpaces() );
+	check( !msgFile.IsEmpty() && !srcOutputName.IsEmpty() && !binOutputName.IsEmpty(), Err_BadManifestLine, manifestName, line );
+	AddJob( msgFile, srcOutputName, binOutputName );
+}
+
+void CBatchCompiler::AddJob( CUnicodeView msgFile, CUnicodeView srcOutputName, CUnicodeView binOutputName )
+{
+	jobs.IncreaseSize( jobs.Size() + 1 );
+	CJob& job = jobs.Last();
+	job.MsgFile = UnicodeStr( msgFile );
+	job.SrcOutputName = UnicodeStr( srcOutputName );
+	job.BinOutputName = UnicodeStr( binOutputName );
+}
+
+int CBatchCompiler::Compile()
+{
+	workers.Run( jobs.Size(), [this]( int jobIndex ) { compileJob( jobs[jobIndex] ); } );
+
+	int failedCount = 0;
+	for( const auto& job : jobs ) {
+		if( job.Error != nullptr ) {
+			logJobError( job );
+			failedCount++;
+		}
+	}
+	return failedCount;
+}
+
+void CBatchCompiler::compileJob( CJob& job ) const
+{
+	try {
+		CMessageCompiler::CompileFile( job.MsgFile, job.SrcOutputName, job.BinOutputName, options );
+	} catch( CException& ) {
+		job.Error = std::current_exception();
+	}
+}
+
+// Errors are logged from the calling thread after all the workers are done.
+void CBatchCompiler::logJobError( const CJob& job )
+{
+	try {
+		std::rethrow_exception( job.Error );
+	} catch( CException& e ) {
+		Log::Exception( e );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
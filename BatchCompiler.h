@@ -0,0 +1,49 @@
+#pragma once
+#include <WorkerPool.h>
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Compiler for a set of message files.
+// Each file is parsed and compiled on its own worker. An error in one file does not stop the compilation of the others.
+class CBatchCompiler {
+public:
+	// Create a compiler with the given number of workers. Zero means one worker per hardware thread.
+	CBatchCompiler( int workerCount, const CCompilerOptions& options );
+
+	// Add all the jobs from a manifest file.
+	// Each non-empty line of the manifest contains a .msg file name, a source output name and a binary output name separated by '|'.
+	// Lines starting with ; are comments.
+	void AddManifest( CUnicodeView manifestName );
+	void AddJob( CUnicodeView msgFile, CUnicodeView srcOutputName, CUnicodeView binOutputName );
+
+	int JobCount() const
+		{ return jobs.Size(); }
+
+	// Compile all the jobs and log the errors. Return the number of failed jobs.
+	int Compile();
+
+private:
+	struct CJob {
+		CUnicodeString MsgFile;
+		CUnicodeString SrcOutputName;
+		CUnicodeString BinOutputName;
+		// Exception that stopped the job compilation.
+		std::exception_ptr Error;
+	};
+
+	CWorkerPool workers;
+	CCompilerOptions options;
+	CArray<CJob> jobs;
+
+	void addManifestLine( CUnicodeView manifestName, CUnicodePart line );
+	void compileJob( CJob& job ) const;
+	static void logJobError( const CJob& job );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
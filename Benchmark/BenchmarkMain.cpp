@@ -0,0 +1,153 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <BenchmarkRunner.h>
+#include <CorpusGenerator.h>
+#include <CommandLine.h>
+
+// Message compiler benchmark.
+// Usage: MessageBenchmark [corpus options] [compiler options] [--input <file.msg>] [--corpus-file <file.msg>] [--iterations <count>] [--output <report.json>] [--generate-only]
+// [--skewed-lookups <count>]
+// Without --input a corpus is generated into the corpus file, benchmark.msg by default.
+// --skewed-lookups compares the page faults and the lookup latency of the file order and of the layout by an access profile
+// for the given number of lookups skewed towards a few messages. The lookups depend on the seed. Mapped format only.
+// Corpus options:
+// --messages <count> - number of messages.
+// --min-length <length>, --max-length <length> - range of value lengths in characters.
+// --escapes <percent> - percentage of value characters written as escape sequences.
+// --fragments <count> - maximum number of quoted fragments in a value.
+// --comments <percent> - percentage of messages preceded by a comment.
+// --named <percent> - percentage of named sections.
+// --section-size <count> - number of messages in a section.
+// --param-messages <percent> - percentage of messages with parameters.
+// --seed <value> - generator seed.
+// Compiler options are the same as in the compiler command line. The report is printed to the standard output unless --output is given.
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+static const CUnicodeView inputFlag = L"--input";
+static const CUnicodeView corpusFileFlag = L"--corpus-file";
+static const CUnicodeView iterationsFlag = L"--iterations";
+static const CUnicodeView outputFlag = L"--output";
+static const CUnicodeView generateOnlyFlag = L"--generate-only";
+static const CUnicodeView messagesFlag = L"--messages";
+static const CUnicodeView minLengthFlag = L"--min-length";
+static const CUnicodeView maxLengthFlag = L"--max-length";
+static const CUnicodeView escapesFlag = L"--escapes";
+static const CUnicodeView fragmentsFlag = L"--fragments";
+static const CUnicodeView commentsFlag = L"--comments";
+static const CUnicodeView namedFlag = L"--named";
+static const CUnicodeView sectionSizeFlag = L"--section-size";
+static const CUnicodeView paramMessagesFlag = L"--param-messages";
+static const CUnicodeView seedFlag = L"--seed";
+static const CUnicodeView skewedLookupsFlag = L"--skewed-lookups";
+
+struct CBenchmarkArguments {
+	CCorpusSettings Corpus;
+	CCompilerOptions Options;
+	CUnicodeView InputName;
+	CUnicodeView CorpusName = L"benchmark.msg";
+	CUnicodeView OutputName;
+	int IterationCount = 5;
+	int SkewedLookupCount = 0;
+	bool GenerateOnly = false;
+};
+
+extern const CError Err_BadBenchmarkValue( L"Invalid value of %0: %1. Expected a non-negative number." );
+static int parseNumber( int argc, wchar_t* argv[], int& pos )
+{
+	const CUnicodeView flag = argv[pos];
+	const CUnicodeView value = CCommandLine::GetFlagValue( argc, argv, pos );
+	const int result = _wtoi( value.Ptr() );
+	check( result >= 0 && ( result > 0 || value == L"0" ), Err_BadBenchmarkValue, flag, value );
+	return result;
+}
+
+extern const CError Err_UnknownBenchmarkArgument( L"Unknown benchmark argument: %0." );
+extern const CError Err_BadLengthRange( L"Minimum value length exceeds the maximum." );
+extern const CError Err_BadSkewedLookupOptions( L"Skewed lookups require the mapped format and can't be used with --streaming." );
+static CBenchmarkArguments parseArguments( int argc, wchar_t* argv[] )
+{
+	CBenchmarkArguments result;
+	for( int i = 1; i < argc; i++ ) {
+		const CUnicodeView arg = argv[i];
+		if( arg == inputFlag ) {
+			result.InputName = CCommandLine::GetFlagValue( argc, argv, i );
+		} else if( arg == corpusFileFlag ) {
+			result.CorpusName = CCommandLine::GetFlagValue( argc, argv, i );
+		} else if( arg == iterationsFlag ) {
+			result.IterationCount = parseNumber( argc, argv, i );
+		} else if( arg == outputFlag ) {
+			result.OutputName = CCommandLine::GetFlagValue( argc, argv, i );
+		} else if( arg == generateOnlyFlag ) {
+			result.GenerateOnly = true;
+		} else if( arg == messagesFlag ) {
+			result.Corpus.MessageCount = parseNumber( argc, argv, i );
+		} else if( arg == minLengthFlag ) {
+			result.Corpus.MinValueLength = parseNumber( argc, argv, i );
+		} else if( arg == maxLengthFlag ) {
+			result.Corpus.MaxValueLength = parseNumber( argc, argv, i );
+		} else if( arg == escapesFlag ) {
+			result.Corpus.EscapePercent = parseNumber( argc, argv, i );
+		} else if( arg == fragmentsFlag ) {
+			result.Corpus.MaxFragmentCount = parseNumber( argc, argv, i );
+		} else if( arg == commentsFlag ) {
+			result.Corpus.CommentPercent = parseNumber( argc, argv, i );
+		} else if( arg == namedFlag ) {
+			result.Corpus.NamedSectionPercent = parseNumber( argc, argv, i );
+		} else if( arg == sectionSizeFlag ) {
+			result.Corpus.MessagesPerSection = parseNumber( argc, argv, i );
+		} else if( arg == paramMessagesFlag ) {
+			result.Corpus.ParamPercent = parseNumber( argc, argv, i );
+		} else if( arg == seedFlag ) {
+			result.Corpus.Seed = parseNumber( argc, argv, i );
+		} else if( arg == skewedLookupsFlag ) {
+			result.SkewedLookupCount = parseNumber( argc, argv, i );
+		} else {
+			check( CCommandLine::ParseOptionFlag( argc, argv, i, result.Options ), Err_UnknownBenchmarkArgument, arg );
+		}
+	}
+	check( result.Corpus.MinValueLength <= result.Corpus.MaxValueLength, Err_BadLengthRange );
+	CCommandLine::CheckOptions( result.Options );
+	check( result.SkewedLookupCount == 0 || ( result.Options.BinaryFormat == BF_Mapped && !result.Options.Streaming ), Err_BadSkewedLookupOptions );
+	return result;
+}
+
+static int runBenchmark( int argc, wchar_t* argv[] )
+{
+	const CBenchmarkArguments arguments = parseArguments( argc, argv );
+	const bool isGenerated = arguments.InputName.IsEmpty();
+	if( isGenerated ) {
+		CCorpusGenerator( arguments.Corpus ).WriteFile( arguments.CorpusName );
+		if( arguments.GenerateOnly ) {
+			return 0;
+		}
+	}
+
+	CBenchmarkRunner runner( isGenerated ? arguments.CorpusName : arguments.InputName, arguments.Options, arguments.IterationCount );
+	runner.SetSkewedLookups( arguments.SkewedLookupCount, arguments.Corpus.Seed );
+	runner.Run();
+	const CString report = runner.CreateReport( isGenerated ? &arguments.Corpus : nullptr );
+	if( arguments.OutputName.IsEmpty() ) {
+		fputs( report.Ptr(), stdout );
+	} else {
+		File::WriteText( arguments.OutputName, report );
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
+int wmain( int argc, wchar_t* argv[] )
+{
+	try {
+		return Msg::runBenchmark( argc, argv );
+	} catch( CException& e ) {
+		Log::Exception( e );
+		return -1;
+	}
+}
@@ -0,0 +1,511 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <BenchmarkRunner.h>
+#include <CorpusGenerator.h>
+#include <MessageCompiler.h>
+#include <MessageReader.h>
+#include <MessageTableWriter.h>
+#include <AccessProfile.h>
+#include <MappedFile.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Version of the report layout. Changing the keys must change the version.
+static const int reportVersion = 8;
+static const CUnicodeView outputSuffix = L".bench";
+static const CUnicodeView profileSuffix = L".profile";
+static const CStringView phaseNames[BP_Count] = { "parse", "header", "source", "binary", "lookup", "format", "substParam" };
+static const CStringView layoutNames[BL_Count] = { "source", "profile" };
+static const CUnicodeView layoutSuffixes[BL_Count] = { L".source.bin", L".profile.bin" };
+static const CStringView blobNames[BB_Count] = { "compressed", "uncompressed" };
+static const CUnicodeView blobSuffixes[BB_Count] = { L".compressed.bin", L".uncompressed.bin" };
+static const CStringView editNames[BE_Count] = { "firstEditMilliseconds", "nextEditMilliseconds" };
+static const CUnicodeView watchSuffix = L".watch";
+// Values of the parameters in the format phase.
+static const CUnicodePart formatParams[] = { L"first", L"second parameter", L"3" };
+
+CBenchmarkRunner::CBenchmarkRunner( CUnicodeView _inputName, const CCompilerOptions& _options, int _iterationCount ) :
+	inputName( _inputName ),
+	outputName( _inputName ),
+	options( _options ),
+	iterationCount( _iterationCount )
+{
+	outputName += outputSuffix;
+	// The benchmark measures the full work of every stage.
+	options.Incremental = false;
+	options.Verify = false;
+}
+
+void CBenchmarkRunner::SetSkewedLookups( int lookupCount, uint64_t seed )
+{
+	skewedLookupCount = lookupCount;
+	skewedSeed = seed;
+}
+
+void CBenchmarkRunner::Run()
+{
+	inputSize = CCompileStats::GetFileSize( inputName );
+	if( !options.Streaming ) {
+		findWatchEditPos();
+	}
+	runIteration( false );
+	for( int i = 0; i < iterationCount; i++ ) {
+		runIteration( true );
+	}
+}
+
+void CBenchmarkRunner::runIteration( bool isMeasured )
+{
+	typedef std::chrono::steady_clock TClock;
+	double times[BP_Count] = {};
+	auto start = TClock::now();
+	const auto takeTime = [&]( TBenchmarkPhase phase ) {
+		const auto end = TClock::now();
+		times[phase] = std::chrono::duration<double>( end - start ).count();
+		start = end;
+	};
+
+	const CMessageCompiler compiler( inputName, options );
+	takeTime( BP_Parse );
+	compiler.CreateHeader( outputName );
+	takeTime( BP_Header );
+	if( hasPhase( BP_Source ) ) {
+		compiler.CreateSource( outputName );
+	}
+	takeTime( BP_Source );
+	const CUnicodeString binName = outputName + L".bin";
+	compiler.CreateBinary( binName );
+	takeTime( BP_Binary );
+	if( hasPhase( BP_Lookup ) ) {
+		const CMessageReader reader( binName );
+		for( int id = 0; id < reader.MessageCount(); id++ ) {
+			lookupLength += reader.GetString( id ).Length();
+		}
+	}
+	takeTime( BP_Lookup );
+	if( hasPhase( BP_Format ) ) {
+		const CMessageReader reader( binName );
+		CArray<wchar_t> buffer;
+		for( int id = 0; id < reader.MessageCount(); id++ ) {
+			formatLength += reader.Format( id, CArrayView<CUnicodePart>( formatParams, _countof( formatParams ) ), buffer );
+		}
+	}
+	takeTime( BP_Format );
+	if( hasPhase( BP_SubstParam ) ) {
+		times[BP_SubstParam] = formatBySubstParam( binName );
+	}
+	if( skewedLookupCount > 0 ) {
+		measureLayouts( compiler, isMeasured );
+	}
+	if( hasCompressionComparison() ) {
+		measureCompression( compiler, isMeasured );
+	}
+	if( watchEditPos != NotFound ) {
+		measureWatch( isMeasured );
+	}
+
+	messageCount = compiler.GetInput().MessageCount();
+	sectionCount = compiler.GetInput().GetUnnamedSections().Size() + compiler.GetInput().GetNamedSections().Size();
+	if( isMeasured ) {
+		for( int phase = 0; phase < BP_Count; phase++ ) {
+			phaseTimes[phase].Add( times[phase] );
+		}
+	}
+}
+
+bool CBenchmarkRunner::hasPhase( TBenchmarkPhase phase ) const
+{
+	switch( phase ) {
+		case BP_Source:
+			return CMessageCompiler::HasSrcOutput( options );
+		case BP_Lookup:
+			return options.BinaryFormat == BF_Mapped;
+		case BP_Format:
+		case BP_SubstParam:
+			return options.BinaryFormat == BF_Mapped && options.MaxParamCount > 0;
+		default:
+			return true;
+	}
+}
+
+static const CUnicodeView substParamValues[] = { L"first", L"second parameter", L"3" };
+// A program without precompiled parameters keeps its messages as strings and substitutes the parameters on every call.
+// The strings are copied from the table before the phase starts, so only the substitution is timed. Return the time in seconds.
+double CBenchmarkRunner::formatBySubstParam( CUnicodeView binName )
+{
+	static_assert( _countof( substParamValues ) == _countof( formatParams ), "Both format phases take the same parameters." );
+	CArray<CUnicodeString> messages;
+	{
+		const CMessageReader reader( binName );
+		messages.ReserveBuffer( reader.MessageCount() );
+		for( int id = 0; id < reader.MessageCount(); id++ ) {
+			messages.Add( UnicodeStr( reader.GetString( id ) ) );
+		}
+	}
+	const auto start = std::chrono::steady_clock::now();
+	for( const auto& message : messages ) {
+		const CUnicodeView messageView = message;
+		substParamLength += messageView.SubstParam( substParamValues[0], substParamValues[1], substParamValues[2] ).Length();
+	}
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// Both layouts are written by the table writer from the parsed file, so the comparison doesn't depend on the profile option.
+void CBenchmarkRunner::measureLayouts( const CMessageCompiler& compiler, bool isMeasured )
+{
+	const CUnicodeString profileName = outputName + profileSuffix;
+	if( skewedIds.IsEmpty() ) {
+		createSkewedLookups( compiler, profileName );
+	}
+	const CAccessProfile profile( profileName );
+	for( int layout = 0; layout < BL_Count; layout++ ) {
+		const CUnicodeString binName = outputName + layoutSuffixes[layout];
+		CMessageTableWriter writer( compiler.GetInput(), compiler.GetIds(), options );
+		writer.SetProfile( layout == BL_Profile ? &profile : nullptr );
+		writer.Write( binName );
+
+		double time = 0;
+		int64_t pageFaults = 0;
+		replayLookups( binName, time, pageFaults );
+		if( isMeasured ) {
+			layoutTimes[layout].Add( time );
+			layoutPageFaults[layout].Add( static_cast<double>( pageFaults ) );
+		}
+	}
+}
+
+static const CStringView profileHeader = "; Access profile of the skewed benchmark lookups.\r\n";
+static const CStringView profileLineTemplate = "%0 %1\r\n";
+void CBenchmarkRunner::createSkewedLookups( const CMessageCompiler& compiler, CUnicodeView profileName )
+{
+	const CMessageIds& ids = compiler.GetIds();
+	CCorpusSettings settings;
+	settings.Seed = skewedSeed;
+	CArray<int> positions;
+	CCorpusGenerator( settings ).CreateSkewedLookups( ids.MessageIds.Size(), skewedLookupCount, positions );
+
+	CArray<int> counts;
+	counts.IncreaseSize( ids.MessageIdLimit );
+	for( int& count : counts ) {
+		count = 0;
+	}
+	skewedIds.ReserveBuffer( positions.Size() );
+	for( const int pos : positions ) {
+		skewedIds.Add( ids.MessageIds[pos] );
+		counts[ids.MessageIds[pos]]++;
+	}
+	CString profileText = Str( profileHeader );
+	for( int id = 0; id < counts.Size(); id++ ) {
+		if( counts[id] > 0 ) {
+			profileText += profileLineTemplate.SubstParam( id, counts[id] );
+		}
+	}
+	File::WriteText( profileName, profileText );
+}
+
+// Only the lookups are measured. The file is mapped anew, so every page the lookups touch is faulted in once.
+void CBenchmarkRunner::replayLookups( CUnicodeView binName, double& time, int64_t& pageFaults )
+{
+	typedef std::chrono::steady_clock TClock;
+	const CMessageReader reader( binName );
+	const int64_t startPageFaults = CCompileStats::GetPageFaultCount();
+	const auto start = TClock::now();
+	for( const int id : skewedIds ) {
+		skewedHash = HashString( reader.GetString( id ), skewedHash );
+	}
+	time = std::chrono::duration<double>( TClock::now() - start ).count();
+	pageFaults = CCompileStats::GetPageFaultCount() - startPageFaults;
+}
+
+// The tables are written by the table writer from the parsed file, which the streaming mode doesn't keep.
+bool CBenchmarkRunner::hasCompressionComparison() const
+{
+	return options.BinaryFormat == BF_Mapped && options.CompressionBlockSize > 0 && !options.Streaming;
+}
+
+// Opening a table maps it and validates the tables. The first lookup of a compressed table also decompresses a block.
+// The message in the middle of the ID range is looked up, so that the block is not the first one.
+void CBenchmarkRunner::measureCompression( const CMessageCompiler& compiler, bool isMeasured )
+{
+	typedef std::chrono::steady_clock TClock;
+	for( int blob = 0; blob < BB_Count; blob++ ) {
+		CCompilerOptions blobOptions = options;
+		blobOptions.CompressionBlockSize = blob == BB_Compressed ? options.CompressionBlockSize : 0;
+		const CUnicodeString binName = outputName + blobSuffixes[blob];
+		CMessageTableWriter( compiler.GetInput(), compiler.GetIds(), blobOptions ).Write( binName );
+		blobTableSizes[blob] = CCompileStats::GetFileSize( binName );
+
+		const auto start = TClock::now();
+		const CMessageReader reader( binName );
+		const auto loadEnd = TClock::now();
+		if( reader.MessageCount() > 0 ) {
+			lookupLength += reader.GetString( reader.MessageCount() / 2 ).Length();
+		}
+		const auto lookupEnd = TClock::now();
+		if( isMeasured ) {
+			loadTimes[blob].Add( std::chrono::duration<double>( loadEnd - start ).count() );
+			firstLookupTimes[blob].Add( std::chrono::duration<double>( lookupEnd - loadEnd ).count() );
+		}
+	}
+}
+
+static const CStringView watchEditMarker = ": \"";
+// The edit goes to the first value after the middle of the file, so that the parts in front of it and after it are reused.
+// Inputs that are not UTF-8 or have no such value are not measured.
+void CBenchmarkRunner::findWatchEditPos()
+{
+	const CMappedFile input( inputName );
+	const char* data = reinterpret_cast<const char*>( input.Data() );
+	const char* end = data + input.Size();
+	const char* markerPos = std::search( data + input.Size() / 2, end, watchEditMarker.Ptr(), watchEditMarker.Ptr() + watchEditMarker.Length() );
+	watchEditPos = markerPos == end ? NotFound : markerPos - data + watchEditMarker.Length();
+}
+
+// A copy of the input is compiled as the watch mode does it, then every edit inserts a character into the same value.
+// An edit is timed from the update of the parsed file to the written outputs, like a save of the watched file.
+void CBenchmarkRunner::measureWatch( bool isMeasured )
+{
+	typedef std::chrono::steady_clock TClock;
+	const CUnicodeString watchOutputName = outputName + watchSuffix;
+	const CUnicodeString watchInputName = watchOutputName + L".msg";
+	const CUnicodeString watchBinName = watchOutputName + L".bin";
+	const CMappedFile input( inputName );
+	writeWatchInput( watchInputName, input, 0 );
+	CCompilerOptions watchOptions = options;
+	watchOptions.Watch = true;
+
+	auto start = TClock::now();
+	CMessageCompiler compiler( watchInputName, watchOptions );
+	compiler.CompileChanges( watchOutputName, watchBinName );
+	const double startTime = std::chrono::duration<double>( TClock::now() - start ).count();
+	double editTimes[BE_Count] = {};
+	for( int edit = 0; edit < BE_Count; edit++ ) {
+		writeWatchInput( watchInputName, input, edit + 1 );
+		start = TClock::now();
+		compiler.Update();
+		compiler.CompileChanges( watchOutputName, watchBinName );
+		editTimes[edit] = std::chrono::duration<double>( TClock::now() - start ).count();
+	}
+	if( isMeasured ) {
+		watchStartTimes.Add( startTime );
+		for( int edit = 0; edit < BE_Count; edit++ ) {
+			watchEditTimes[edit].Add( editTimes[edit] );
+		}
+	}
+}
+
+void CBenchmarkRunner::writeWatchInput( CUnicodeView name, const CMappedFile& input, int editLength ) const
+{
+	CFileWriter file( name, FCM_CreateAlways );
+	file.Write( input.Data(), static_cast<int>( watchEditPos ) );
+	for( int i = 0; i < editLength; i++ ) {
+		file.Write( "x", 1 );
+	}
+	file.Write( input.Data() + watchEditPos, static_cast<int>( input.Size() - watchEditPos ) );
+}
+
+static CString getJsonNumber( double value )
+{
+	char buffer[64];
+	sprintf_s( buffer, "%.6f", value );
+	return Str( CStringView( buffer ) );
+}
+
+static CString getJsonInteger( int64_t value )
+{
+	char buffer[32];
+	sprintf_s( buffer, "%lld", value );
+	return Str( CStringView( buffer ) );
+}
+
+static CStringView getJsonBool( bool value )
+{
+	return value ? "true" : "false";
+}
+
+static const CStringView fieldTemplate = "%0\"%1\": %2%3\r\n";
+static void addJsonField( CStringView indent, CStringView name, CStringPart value, bool isLast, CString& result )
+{
+	result += fieldTemplate.SubstParam( indent, name, value, isLast ? "" : "," );
+}
+
+CString CBenchmarkRunner::CreateReport( const CCorpusSettings* corpus ) const
+{
+	CString result = "{\r\n";
+	addJsonField( "\t", "version", Str( reportVersion ), false, result );
+	if( corpus != nullptr ) {
+		addCorpusReport( *corpus, result );
+	} else {
+		addJsonField( "\t", "corpus", "null", false, result );
+	}
+	addOptionsReport( result );
+	result += "\t\"input\": {\r\n";
+	addJsonField( "\t\t", "bytes", getJsonInteger( inputSize ), false, result );
+	addJsonField( "\t\t", "messages", Str( messageCount ), false, result );
+	addJsonField( "\t\t", "sections", Str( sectionCount ), true, result );
+	result += "\t},\r\n";
+	addJsonField( "\t", "iterations", Str( iterationCount ), false, result );
+	result += "\t\"phases\": {\r\n";
+	int lastPhase = BP_Count - 1;
+	while( lastPhase > 0 && !hasPhase( static_cast<TBenchmarkPhase>( lastPhase ) ) ) {
+		lastPhase--;
+	}
+	for( int phase = 0; phase <= lastPhase; phase++ ) {
+		if( hasPhase( static_cast<TBenchmarkPhase>( phase ) ) ) {
+			addPhaseReport( static_cast<TBenchmarkPhase>( phase ), phase == lastPhase, result );
+		}
+	}
+	result += "\t},\r\n";
+	addLayoutsReport( result );
+	addCompressionReport( result );
+	addWatchReport( result );
+	result += "}\r\n";
+	return result;
+}
+
+void CBenchmarkRunner::addCorpusReport( const CCorpusSettings& corpus, CString& result ) const
+{
+	result += "\t\"corpus\": {\r\n";
+	addJsonField( "\t\t", "messageCount", Str( corpus.MessageCount ), false, result );
+	addJsonField( "\t\t", "minValueLength", Str( corpus.MinValueLength ), false, result );
+	addJsonField( "\t\t", "maxValueLength", Str( corpus.MaxValueLength ), false, result );
+	addJsonField( "\t\t", "escapePercent", Str( corpus.EscapePercent ), false, result );
+	addJsonField( "\t\t", "maxFragmentCount", Str( corpus.MaxFragmentCount ), false, result );
+	addJsonField( "\t\t", "commentPercent", Str( corpus.CommentPercent ), false, result );
+	addJsonField( "\t\t", "namedSectionPercent", Str( corpus.NamedSectionPercent ), false, result );
+	addJsonField( "\t\t", "messagesPerSection", Str( corpus.MessagesPerSection ), false, result );
+	addJsonField( "\t\t", "paramPercent", Str( corpus.ParamPercent ), false, result );
+	addJsonField( "\t\t", "seed", Str( static_cast<int>( corpus.Seed ) ), true, result );
+	result += "\t},\r\n";
+}
+
+void CBenchmarkRunner::addOptionsReport( CString& result ) const
+{
+	static const CStringView idForms[] = { "\"extern\"", "\"constexpr\"", "\"enum\"" };
+	result += "\t\"options\": {\r\n";
+	addJsonField( "\t\t", "format", options.BinaryFormat == BF_Mapped ? "\"mapped\"" : "\"stream\"", false, result );
+	addJsonField( "\t\t", "encoding", options.Encoding == MTE_Utf8 ? "\"utf8\"" : "\"wide\"", false, result );
+	addJsonField( "\t\t", "mergeStrings", getJsonBool( options.MergeStrings ), false, result );
+	addJsonField( "\t\t", "compressionBlockSize", Str( options.CompressionBlockSize ), false, result );
+	addJsonField( "\t\t", "idForm", idForms[options.IdForm], false, result );
+	addJsonField( "\t\t", "embed", getJsonBool( options.EmbedMessages ), false, result );
+	addJsonField( "\t\t", "parseJobs", Str( options.ParseWorkerCount ), false, result );
+	addJsonField( "\t\t", "streaming", getJsonBool( options.Streaming ), false, result );
+	addJsonField( "\t\t", "maxParamCount", Str( options.MaxParamCount ), true, result );
+	result += "\t},\r\n";
+}
+
+// Throughput is computed from the median time and is relative to the input file: bytes of the .msg file and messages in it.
+void CBenchmarkRunner::addPhaseReport( TBenchmarkPhase phase, bool isLast, CString& result ) const
+{
+	const double medianTime = getMedian( phaseTimes[phase] );
+	const double megabytes = inputSize / 1e6;
+	result += "\t\t\"";
+	result += phaseNames[phase];
+	result += "\": {\r\n";
+	addJsonField( "\t\t\t", "minSeconds", getJsonNumber( getMin( phaseTimes[phase] ) ), false, result );
+	addJsonField( "\t\t\t", "medianSeconds", getJsonNumber( medianTime ), false, result );
+	addJsonField( "\t\t\t", "mbPerSecond", getJsonNumber( medianTime > 0 ? megabytes / medianTime : 0 ), false, result );
+	addJsonField( "\t\t\t", "messagesPerSecond", getJsonNumber( medianTime > 0 ? messageCount / medianTime : 0 ), true, result );
+	result += isLast ? "\t\t}\r\n" : "\t\t},\r\n";
+}
+
+// Page faults are the median number of faults during the lookups. Lookup latency is computed from the median time.
+void CBenchmarkRunner::addLayoutsReport( CString& result ) const
+{
+	if( skewedLookupCount == 0 ) {
+		addJsonField( "\t", "layouts", "null", false, result );
+		return;
+	}
+	result += "\t\"layouts\": {\r\n";
+	addJsonField( "\t\t", "lookups", Str( skewedLookupCount ), false, result );
+	addJsonField( "\t\t", "seed", Str( static_cast<int>( skewedSeed ) ), false, result );
+	for( int layout = 0; layout < BL_Count; layout++ ) {
+		addLayoutReport( static_cast<TBenchmarkLayout>( layout ), layout == BL_Count - 1, result );
+	}
+	result += "\t},\r\n";
+}
+
+void CBenchmarkRunner::addLayoutReport( TBenchmarkLayout layout, bool isLast, CString& result ) const
+{
+	const double medianTime = getMedian( layoutTimes[layout] );
+	result += "\t\t\"";
+	result += layoutNames[layout];
+	result += "\": {\r\n";
+	addJsonField( "\t\t\t", "minSeconds", getJsonNumber( getMin( layoutTimes[layout] ) ), false, result );
+	addJsonField( "\t\t\t", "medianSeconds", getJsonNumber( medianTime ), false, result );
+	addJsonField( "\t\t\t", "nsPerLookup", getJsonNumber( medianTime * 1e9 / skewedLookupCount ), false, result );
+	addJsonField( "\t\t\t", "pageFaults", getJsonInteger( static_cast<int64_t>( getMedian( layoutPageFaults[layout] ) ) ), true, result );
+	result += isLast ? "\t\t}\r\n" : "\t\t},\r\n";
+}
+
+// Latencies are median times in microseconds.
+void CBenchmarkRunner::addCompressionReport( CString& result ) const
+{
+	if( !hasCompressionComparison() ) {
+		addJsonField( "\t", "compression", "null", false, result );
+		return;
+	}
+	result += "\t\"compression\": {\r\n";
+	for( int blob = 0; blob < BB_Count; blob++ ) {
+		addBlobReport( static_cast<TBenchmarkBlob>( blob ), blob == BB_Count - 1, result );
+	}
+	result += "\t},\r\n";
+}
+
+void CBenchmarkRunner::addBlobReport( TBenchmarkBlob blob, bool isLast, CString& result ) const
+{
+	result += "\t\t\"";
+	result += blobNames[blob];
+	result += "\": {\r\n";
+	addJsonField( "\t\t\t", "bytes", getJsonInteger( blobTableSizes[blob] ), false, result );
+	addJsonField( "\t\t\t", "loadMicroseconds", getJsonNumber( getMedian( loadTimes[blob] ) * 1e6 ), false, result );
+	addJsonField( "\t\t\t", "firstLookupMicroseconds", getJsonNumber( getMedian( firstLookupTimes[blob] ) * 1e6 ), true, result );
+	result += isLast ? "\t\t}\r\n" : "\t\t},\r\n";
+}
+
+// Latencies are median times in milliseconds. The start is the first compilation of the watch mode.
+void CBenchmarkRunner::addWatchReport( CString& result ) const
+{
+	if( watchEditPos == NotFound ) {
+		addJsonField( "\t", "watch", "null", true, result );
+		return;
+	}
+	result += "\t\"watch\": {\r\n";
+	addJsonField( "\t\t", "startMilliseconds", getJsonNumber( getMedian( watchStartTimes ) * 1e3 ), false, result );
+	for( int edit = 0; edit < BE_Count; edit++ ) {
+		addJsonField( "\t\t", editNames[edit], getJsonNumber( getMedian( watchEditTimes[edit] ) * 1e3 ),
+			edit == BE_Count - 1, result );
+	}
+	result += "\t}\r\n";
+}
+
+double CBenchmarkRunner::getMedian( CArrayView<double> values )
+{
+	if( values.IsEmpty() ) {
+		return 0;
+	}
+	CArray<double> sorted;
+	sorted.ReserveBuffer( values.Size() );
+	for( double value : values ) {
+		sorted.Add( value );
+	}
+	std::sort( sorted.begin(), sorted.end() );
+	const int middle = sorted.Size() / 2;
+	return sorted.Size() % 2 == 1 ? sorted[middle] : ( sorted[middle - 1] + sorted[middle] ) / 2;
+}
+
+double CBenchmarkRunner::getMin( CArrayView<double> values )
+{
+	if( values.IsEmpty() ) {
+		return 0;
+	}
+	return *std::min_element( values.begin(), values.end() );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
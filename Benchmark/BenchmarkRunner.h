@@ -0,0 +1,124 @@
+#pragma once
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+struct CCorpusSettings;
+class CMessageCompiler;
+class CMappedFile;
+//////////////////////////////////////////////////////////////////////////
+
+// Measured stages of a compilation.
+enum TBenchmarkPhase {
+	BP_Parse,
+	BP_Header,
+	BP_Source,
+	BP_Binary,
+	// Opening the binary output with a message reader and reading every message. Mapped format only.
+	BP_Lookup,
+	// Formatting every message with precompiled parameters. Mapped format with --params only.
+	BP_Format,
+	// Formatting the same messages with the same parameters by SubstParam, the baseline of the format phase.
+	BP_SubstParam,
+	BP_Count
+};
+
+// Layouts of the mapped binary output that are compared by the skewed lookups.
+enum TBenchmarkLayout {
+	// Values in the file order.
+	BL_Source,
+	// Values laid out by the access profile of the skewed lookups.
+	BL_Profile,
+	BL_Count
+};
+
+// Tables that are compared by the latency of opening and of the first lookup when the blob is compressed.
+enum TBenchmarkBlob {
+	BB_Compressed,
+	BB_Uncompressed,
+	BB_Count
+};
+
+// Edits of a value that are compiled in the watch mode. The first edit creates the binary image that the next edit patches.
+enum TBenchmarkEdit {
+	BE_First,
+	BE_Next,
+	BE_Count
+};
+
+// Runner of the compiler stages on a single message file.
+// Every stage is timed separately. Each iteration parses the file anew and writes all the outputs next to the input.
+// A warm-up iteration is run first and is not measured, so that the results don't depend on the file system cache.
+class CBenchmarkRunner {
+public:
+	CBenchmarkRunner( CUnicodeView inputName, const CCompilerOptions& options, int iterationCount );
+
+	// Compare the file order of the binary output with the layout by an access profile. The lookups are skewed towards
+	// a few messages, see CCorpusGenerator::CreateSkewedLookups, and the profile is created from them. Mapped format only.
+	void SetSkewedLookups( int lookupCount, uint64_t seed );
+
+	void Run();
+
+	// Create the JSON report. Keys always come in the same order and numbers have a fixed format, so reports can be compared as text.
+	// Corpus settings are included if the input was generated.
+	CString CreateReport( const CCorpusSettings* corpus ) const;
+
+private:
+	CUnicodeString inputName;
+	CUnicodeString outputName;
+	CCompilerOptions options;
+	int iterationCount;
+	// Input size in bytes.
+	int64_t inputSize = 0;
+	int messageCount = 0;
+	int sectionCount = 0;
+	// Total length of the messages read in the lookup phase. Keeps the reads from being optimized away.
+	int64_t lookupLength = 0;
+	// Total length of the formatted messages.
+	int64_t formatLength = 0;
+	// Total length of the messages formatted by SubstParam.
+	int64_t substParamLength = 0;
+	CArray<double> phaseTimes[BP_Count];
+	// Number of lookups in the layout comparison. Zero disables the comparison.
+	int skewedLookupCount = 0;
+	uint64_t skewedSeed = 0;
+	// Message IDs in the lookup order. Created in the first iteration, when the IDs are known.
+	CArray<int> skewedIds;
+	// Hash of the strings read by the skewed lookups. Keeps the reads from being optimized away.
+	uint64_t skewedHash = 0;
+	CArray<double> layoutTimes[BL_Count];
+	CArray<double> layoutPageFaults[BL_Count];
+	CArray<double> loadTimes[BB_Count];
+	CArray<double> firstLookupTimes[BB_Count];
+	int64_t blobTableSizes[BB_Count] = {};
+	// Position in the input where the watch edits insert a character into a value. NotFound disables the watch measurement.
+	int64_t watchEditPos = NotFound;
+	CArray<double> watchStartTimes;
+	CArray<double> watchEditTimes[BE_Count];
+
+	void runIteration( bool isMeasured );
+	bool hasPhase( TBenchmarkPhase phase ) const;
+	double formatBySubstParam( CUnicodeView binName );
+	void measureLayouts( const CMessageCompiler& compiler, bool isMeasured );
+	void createSkewedLookups( const CMessageCompiler& compiler, CUnicodeView profileName );
+	void replayLookups( CUnicodeView binName, double& time, int64_t& pageFaults );
+	bool hasCompressionComparison() const;
+	void measureCompression( const CMessageCompiler& compiler, bool isMeasured );
+	void findWatchEditPos();
+	void measureWatch( bool isMeasured );
+	void writeWatchInput( CUnicodeView name, const CMappedFile& input, int editLength ) const;
+	void addCorpusReport( const CCorpusSettings& corpus, CString& result ) const;
+	void addOptionsReport( CString& result ) const;
+	void addPhaseReport( TBenchmarkPhase phase, bool isLast, CString& result ) const;
+	void addLayoutsReport( CString& result ) const;
+	void addLayoutReport( TBenchmarkLayout layout, bool isLast, CString& result ) const;
+	void addCompressionReport( CString& result ) const;
+	void addBlobReport( TBenchmarkBlob blob, bool isLast, CString& result ) const;
+	void addWatchReport( CString& result ) const;
+	static double getMedian( CArrayView<double> values );
+	static double getMin( CArrayView<double> values );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,182 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <CorpusGenerator.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+static const char valueAlphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789     .,!?-";
+static const CStringView escapes[] = { "\\n", "\\r", "\\\"", "\\\\" };
+
+CCorpusGenerator::CCorpusGenerator( const CCorpusSettings& _settings ) :
+	settings( _settings ),
+	randomState( _settings.Seed )
+{
+}
+
+void CCorpusGenerator::CreateSkewedLookups( int messageCount, int lookupCount, CArray<int>& result )
+{
+	randomState = settings.Seed;
+	result.Empty();
+	if( messageCount == 0 ) {
+		return;
+	}
+	CArray<int> rankPositions;
+	rankPositions.IncreaseSize( messageCount );
+	for( int i = 0; i < messageCount; i++ ) {
+		rankPositions[i] = i;
+	}
+	for( int i = messageCount - 1; i > 0; i-- ) {
+		std::swap( rankPositions[i], rankPositions[getRandom( 0, i )] );
+	}
+	// Sums of the rank weights up to every rank.
+	CArray<double> rankLimits;
+	rankLimits.IncreaseSize( messageCount );
+	double totalWeight = 0;
+	for( int rank = 0; rank < messageCount; rank++ ) {
+		totalWeight += 1.0 / ( rank + 1 );
+		rankLimits[rank] = totalWeight;
+	}
+
+	result.ReserveBuffer( lookupCount );
+	for( int i = 0; i < lookupCount; i++ ) {
+		const double point = ( nextRandom() >> 11 ) * ( totalWeight / ( UINT64_C( 1 ) << 53 ) );
+		const double* limit = std::upper_bound( rankLimits.Ptr(), rankLimits.Ptr() + messageCount, point );
+		const int rank = std::min( static_cast<int>( limit - rankLimits.Ptr() ), messageCount - 1 );
+		result.Add( rankPositions[rank] );
+	}
+}
+
+static const CStringView fileHeader = "; Synthetic message file. Messages: %0, seed: %1.\r\n\r\n";
+// The batch is written when it reaches this size in characters.
+static const int writeBatchSize = 1 << 20;
+void CCorpusGenerator::WriteFile( CUnicodeView fileName )
+{
+	randomState = settings.Seed;
+	CFileWriter file( fileName, FCM_CreateAlways );
+	CString batch;
+	batch.ReserveBuffer( writeBatchSize );
+	batch += fileHeader.SubstParam( settings.MessageCount, static_cast<int>( settings.Seed ) );
+
+	const int messagesPerSection = settings.MessagesPerSection > 0 ? settings.MessagesPerSection : 1;
+	int messageId = 0;
+	for( int sectionId = 0; messageId < settings.MessageCount; sectionId++ ) {
+		int sectionSize = settings.MessageCount - messageId;
+		if( sectionSize > messagesPerSection ) {
+			sectionSize = messagesPerSection;
+		}
+		addSection( sectionId, getRandomChance( settings.NamedSectionPercent ), batch );
+		for( int i = 0; i < sectionSize; i++ ) {
+			addMessage( messageId, batch );
+			messageId++;
+			if( batch.Length() >= writeBatchSize ) {
+				flushBatch( file, batch );
+			}
+		}
+		batch += "\r\n";
+	}
+	flushBatch( file, batch );
+}
+
+void CCorpusGenerator::flushBatch( CFileWriter& file, CString& batch )
+{
+	file.Write( batch.Ptr(), batch.Length() );
+	batch.Empty();
+}
+
+static const CStringView sectionTemplate = "[Section%0]\r\n";
+static const CStringView namedSectionTemplate = "{Named%0}\r\n";
+void CCorpusGenerator::addSection( int sectionId, bool isNamed, CString& result )
+{
+	result += ( isNamed ? namedSectionTemplate : sectionTemplate ).SubstParam( sectionId );
+}
+
+static const CStringView keyTemplate = "Message%0:";
+void CCorpusGenerator::addMessage( int messageId, CString& result )
+{
+	if( getRandomChance( settings.CommentPercent ) ) {
+		addComment( result );
+	}
+	result += keyTemplate.SubstParam( messageId );
+
+	const int length = getRandom( settings.MinValueLength, settings.MaxValueLength );
+	const int maxFragmentCount = settings.MaxFragmentCount > 0 ? settings.MaxFragmentCount : 1;
+	int fragmentCount = getRandom( 1, maxFragmentCount );
+	if( fragmentCount > length && length > 0 ) {
+		fragmentCount = length;
+	}
+	int lengthLeft = length;
+	for( int i = fragmentCount; i > 0; i-- ) {
+		const int fragmentLength = i == 1 ? lengthLeft : getRandom( 0, lengthLeft );
+		result += " \"";
+		addValueText( fragmentLength, result );
+		result += "\"";
+		lengthLeft -= fragmentLength;
+	}
+	// The random sequence of a corpus without parameters doesn't change.
+	if( settings.ParamPercent > 0 && getRandomChance( settings.ParamPercent ) ) {
+		addParams( getRandom( 1, 3 ), result );
+	}
+	result += "\r\n";
+}
+
+// Parameters are quoted fragments of their own, so they don't change the escape and fragment statistics.
+void CCorpusGenerator::addParams( int paramCount, CString& result )
+{
+	for( int i = 0; i < paramCount; i++ ) {
+		result += " \" %";
+		result += Str( i );
+		result += "\"";
+	}
+}
+
+void CCorpusGenerator::addComment( CString& result )
+{
+	result += getRandomChance( 50 ) ? "; " : "// ";
+	addValueText( getRandom( 0, 40 ), result );
+	result += "\r\n";
+}
+
+// An escape sequence counts as a single character of the value.
+void CCorpusGenerator::addValueText( int length, CString& result )
+{
+	const int alphabetSize = _countof( valueAlphabet ) - 1;
+	const int escapeCount = _countof( escapes );
+	for( int i = 0; i < length; i++ ) {
+		if( getRandomChance( settings.EscapePercent ) ) {
+			result += escapes[getRandom( 0, escapeCount - 1 )];
+		} else {
+			result += valueAlphabet[getRandom( 0, alphabetSize - 1 )];
+		}
+	}
+}
+
+// SplitMix64. The generator is fully specified here, so the corpus doesn't depend on the standard library implementation.
+uint64_t CCorpusGenerator::nextRandom()
+{
+	randomState += 0x9E3779B97F4A7C15ULL;
+	uint64_t result = randomState;
+	result = ( result ^ ( result >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	result = ( result ^ ( result >> 27 ) ) * 0x94D049BB133111EBULL;
+	return result ^ ( result >> 31 );
+}
+
+int CCorpusGenerator::getRandom( int minValue, int maxValue )
+{
+	if( maxValue <= minValue ) {
+		return minValue;
+	}
+	const uint64_t range = static_cast<uint64_t>( maxValue - minValue ) + 1;
+	return minValue + static_cast<int>( nextRandom() % range );
+}
+
+bool CCorpusGenerator::getRandomChance( int percent )
+{
+	return getRandom( 0, 99 ) < percent;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
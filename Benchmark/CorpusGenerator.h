@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Shape of a synthetic message file.
+struct CCorpusSettings {
+	int MessageCount = 100000;
+	// Length range of a message value in characters, before escaping.
+	int MinValueLength = 8;
+	int MaxValueLength = 120;
+	// Percentage of value characters that are written as escape sequences.
+	int EscapePercent = 2;
+	// Values are split into one to this number of quoted fragments.
+	int MaxFragmentCount = 3;
+	// Percentage of messages that are preceded by a comment line.
+	int CommentPercent = 10;
+	// Percentage of sections that are named sections.
+	int NamedSectionPercent = 20;
+	int MessagesPerSection = 200;
+	// Percentage of messages with parameters. Such a message has one to three parameters, %0 first, after its fragments.
+	int ParamPercent = 0;
+	uint64_t Seed = 1;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Generator of message files for benchmarking.
+// The output depends only on the settings, so the same settings give the same file on every run and every machine.
+class CCorpusGenerator {
+public:
+	explicit CCorpusGenerator( const CCorpusSettings& settings );
+
+	// Write the file. The text is pure ASCII. It is written in batches, so its size is limited only by the disk.
+	void WriteFile( CUnicodeView fileName );
+	// Create the message positions of a skewed sequence of lookups. The message of rank r is looked up with a probability
+	// proportional to 1 / r. Ranks are given to the messages at random, so the frequently used messages are spread over the file.
+	void CreateSkewedLookups( int messageCount, int lookupCount, CArray<int>& result );
+
+private:
+	const CCorpusSettings settings;
+	uint64_t randomState;
+
+	static void flushBatch( CFileWriter& file, CString& batch );
+	void addSection( int sectionId, bool isNamed, CString& result );
+	void addMessage( int messageId, CString& result );
+	void addParams( int paramCount, CString& result );
+	void addComment( CString& result );
+	void addValueText( int length, CString& result );
+
+	uint64_t nextRandom();
+	int getRandom( int minValue, int maxValue );
+	bool getRandomChance( int percent );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
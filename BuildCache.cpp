@@ -0,0 +1,242 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <BuildCache.h>
+#include <HashUtils.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Changing the cache format or the content of any output must change the version, so that old caches are ignored.
+static const CUnicodeView cacheVersion = L"4";
+static const CUnicodeView versionKey = L"version";
+static const CUnicodeView inputKey = L"input";
+static const CUnicodeView outputKeys[BO_Count] = { L"header", L"source", L"binary", L"ids" };
+static const CUnicodeView shardKey = L"shard";
+static const wchar_t fieldSeparator = L'|';
+
+CBuildCache::CBuildCache( CUnicodeView _fileName ) :
+	fileName( _fileName )
+{
+	load();
+}
+
+// The cache is only an optimization, so a damaged file is silently discarded.
+void CBuildCache::load()
+{
+	if( !FileSystem::FileExists( fileName ) ) {
+		return;
+	}
+
+	const CUnicodeString contents = File::ReadUnicodeText( fileName );
+	const int length = contents.Length();
+	bool hasVersion = false;
+	for( int lineStart = 0; lineStart < length; ) {
+		int lineEnd = contents.Find( L'\n', lineStart );
+		if( lineEnd == NotFound ) {
+			lineEnd = length;
+		}
+		const CUnicodePart line = contents.Mid( lineStart, lineEnd - lineStart ).TrimSpaces();
+		lineStart = lineEnd + 1;
+
+		if( line.IsEmpty() || line[0] == L';' ) {
+			continue;
+		}
+		if( !parseLine( line, hasVersion ) ) {
+			return;
+		}
+	}
+	isLoaded = hasVersion;
+}
+
+bool CBuildCache::parseLine( CUnicodePart line, bool& hasVersion )
+{
+	const int separatorPos = line.Find( fieldSeparator );
+	if( separatorPos == NotFound ) {
+		return false;
+	}
+	const CUnicodePart key = line.Mid( 0, separatorPos );
+	const CUnicodePart value = line.Mid( separatorPos + 1 );
+	if( key == versionKey ) {
+		hasVersion = value == cacheVersion;
+		return hasVersion;
+	}
+	if( key == inputKey ) {
+		return parseHash( value, inputHash );
+	}
+	if( key == shardKey ) {
+		return parseShardOutput( value );
+	}
+	for( int i = 0; i < BO_Count; i++ ) {
+		if( key == outputKeys[i] ) {
+			return parseOutput( value, outputHashes[i], outputStamps[i] );
+		}
+	}
+	return false;
+}
+
+// Output format: <content hash>|<file stamp>.
+bool CBuildCache::parseOutput( CUnicodePart str, uint64_t& hash, uint64_t& stamp )
+{
+	const int separatorPos = str.Find( fieldSeparator );
+	return separatorPos != NotFound && parseHash( str.Mid( 0, separatorPos ), hash ) && parseHash( str.Mid( separatorPos + 1 ), stamp );
+}
+
+// Shard format: <file name>|<content hash>|<file stamp>. File names can't contain the separator.
+bool CBuildCache::parseShardOutput( CUnicodePart str )
+{
+	const int separatorPos = str.Find( fieldSeparator );
+	if( separatorPos == NotFound ) {
+		return false;
+	}
+	CShardOutput shard;
+	shard.Name = str.Mid( 0, separatorPos );
+	if( !parseOutput( str.Mid( separatorPos + 1 ), shard.Hash, shard.Stamp ) || shardPositions.Get( shard.Name ) != nullptr ) {
+		return false;
+	}
+	shardPositions.Add( shard.Name, shardOutputs.Size() );
+	shardOutputs.Add( move( shard ) );
+	return true;
+}
+
+bool CBuildCache::parseHash( CUnicodePart str, uint64_t& result )
+{
+	if( str.Length() != 16 ) {
+		return false;
+	}
+	result = 0;
+	for( int i = 0; i < str.Length(); i++ ) {
+		const wchar_t ch = str[i];
+		int digit = 0;
+		if( ch >= L'0' && ch <= L'9' ) {
+			digit = ch - L'0';
+		} else if( ch >= L'a' && ch <= L'f' ) {
+			digit = ch - L'a' + 10;
+		} else {
+			return false;
+		}
+		result = ( result << 4 ) | digit;
+	}
+	return true;
+}
+
+bool CBuildCache::IsUpToDate( uint64_t newInputHash, CArrayView<CUnicodeString> outputNames ) const
+{
+	if( !isLoaded || newInputHash != inputHash ) {
+		return false;
+	}
+	for( const auto& name : outputNames ) {
+		if( !FileSystem::FileExists( name ) ) {
+			return false;
+		}
+	}
+	for( const auto& shard : shardOutputs ) {
+		if( !FileSystem::FileExists( shard.Name ) ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CBuildCache::UpdateOutput( TBuildOutput output, CUnicodeView outputName, uint64_t contentHash )
+{
+	const uint64_t stamp = getFileStamp( outputName );
+	const bool isChanged = !isLoaded || outputHashes[output] != contentHash || stamp == 0 || stamp != outputStamps[output];
+	outputHashes[output] = contentHash;
+	outputNames[output] = outputName;
+	return isChanged;
+}
+
+bool CBuildCache::UpdateShardOutput( CUnicodeView outputName, uint64_t contentHash )
+{
+	const uint64_t stamp = getFileStamp( outputName );
+	const int* position = shardPositions.Get( outputName );
+	if( position == nullptr ) {
+		CShardOutput shard;
+		shard.Name = outputName;
+		shard.Hash = contentHash;
+		shard.IsUpdated = true;
+		shardPositions.Add( shard.Name, shardOutputs.Size() );
+		shardOutputs.Add( move( shard ) );
+		return true;
+	}
+	CShardOutput& shard = shardOutputs[*position];
+	const bool isChanged = !isLoaded || shard.Hash != contentHash || stamp == 0 || stamp != shard.Stamp;
+	shard.Hash = contentHash;
+	shard.IsUpdated = true;
+	return isChanged;
+}
+
+// Hash of the size and the last write time of a file. Zero if the file doesn't exist.
+uint64_t CBuildCache::getFileStamp( CUnicodeView fileName )
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if( !::GetFileAttributesExW( fileName.Ptr(), GetFileExInfoStandard, &attributes ) ) {
+		return 0;
+	}
+	uint64_t hash = HashValue( attributes.nFileSizeHigh );
+	hash = HashValue( attributes.nFileSizeLow, hash );
+	hash = HashValue( attributes.ftLastWriteTime.dwHighDateTime, hash );
+	return HashValue( attributes.ftLastWriteTime.dwLowDateTime, hash );
+}
+
+static const CStringView cacheHeader = "; MessageCompiler build cache. Delete the file to force a rebuild.\r\n";
+static const CStringView cacheLineTemplate = "%0|%1\r\n";
+static const CStringView outputLineTemplate = "%0|%1|%2\r\n";
+void CBuildCache::Save()
+{
+	CString result = Str( cacheHeader );
+	result += cacheLineTemplate.SubstParam( Str( versionKey ), Str( cacheVersion ) );
+	result += cacheLineTemplate.SubstParam( Str( inputKey ), getHashText( inputHash ) );
+	for( int i = 0; i < BO_Count; i++ ) {
+		if( !outputNames[i].IsEmpty() ) {
+			outputStamps[i] = getFileStamp( outputNames[i] );
+			outputNames[i].Empty();
+		}
+		result += outputLineTemplate.SubstParam( Str( outputKeys[i] ), getHashText( outputHashes[i] ), getHashText( outputStamps[i] ) );
+	}
+	saveShardOutputs( result );
+	File::WriteText( fileName, result );
+}
+
+static const CStringView shardLineTemplate = "%0|%1|%2|%3\r\n";
+// A compilation that updated some shards has created all of them, so the shards of removed sections are dropped.
+// A compilation without shard updates, like a watch update of values, keeps them all.
+void CBuildCache::saveShardOutputs( CString& result )
+{
+	bool hasUpdates = false;
+	for( const auto& shard : shardOutputs ) {
+		hasUpdates = hasUpdates || shard.IsUpdated;
+	}
+	CArray<CShardOutput> keptShards;
+	shardPositions.Empty();
+	for( auto& shard : shardOutputs ) {
+		if( hasUpdates && !shard.IsUpdated ) {
+			continue;
+		}
+		if( shard.IsUpdated ) {
+			shard.Stamp = getFileStamp( shard.Name );
+			shard.IsUpdated = false;
+		}
+		result += shardLineTemplate.SubstParam( Str( shardKey ), Str( shard.Name ), getHashText( shard.Hash ), getHashText( shard.Stamp ) );
+		shardPositions.Add( shard.Name, keptShards.Size() );
+		keptShards.Add( move( shard ) );
+	}
+	shardOutputs = move( keptShards );
+}
+
+CString CBuildCache::getHashText( uint64_t hash )
+{
+	const char digits[] = "0123456789abcdef";
+	char text[16];
+	for( int i = 15; i >= 0; i-- ) {
+		text[i] = digits[hash & 0xF];
+		hash >>= 4;
+	}
+	return Str( CStringPart( text, 16 ) );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,69 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Files produced by a compilation.
+enum TBuildOutput {
+	BO_Header,
+	BO_Source,
+	BO_Binary,
+	BO_IdMap,
+	BO_Count
+};
+
+// Content hashes of the last compilation of a message file.
+// Every output also has a stamp of its size and last write time, taken when the cache is saved. An output whose stamp has changed
+// since then has been edited or replaced by someone else, so it is written again even if its content hash is the same.
+// Shard outputs are tracked by their file names, because their number depends on the sections.
+// The cache is stored in a text file next to the binary output. A missing or damaged cache file gives an empty cache,
+// so the next compilation rebuilds everything.
+class CBuildCache {
+public:
+	explicit CBuildCache( CUnicodeView fileName );
+
+	// Check that the input hash matches the last compilation and all the given outputs and the shards of the last compilation exist.
+	bool IsUpToDate( uint64_t inputHash, CArrayView<CUnicodeString> outputNames ) const;
+	void SetInputHash( uint64_t newValue )
+		{ inputHash = newValue; }
+
+	// Remember the content hash of an output. Return true if the output file must be written:
+	// the file doesn't exist, its last written content has a different hash or it has been changed since the last compilation.
+	bool UpdateOutput( TBuildOutput output, CUnicodeView outputName, uint64_t contentHash );
+	// The same for a shard output. If any shard is updated, the shards that are not updated before the next save are dropped.
+	bool UpdateShardOutput( CUnicodeView outputName, uint64_t contentHash );
+
+	// The stamps of the outputs updated since the last save are taken from their files, so the outputs must have been written.
+	void Save();
+
+private:
+	struct CShardOutput {
+		CUnicodeString Name;
+		uint64_t Hash = 0;
+		uint64_t Stamp = 0;
+		bool IsUpdated = false;
+	};
+
+	CUnicodeString fileName;
+	bool isLoaded = false;
+	uint64_t inputHash = 0;
+	uint64_t outputHashes[BO_Count] = {};
+	uint64_t outputStamps[BO_Count] = {};
+	CUnicodeString outputNames[BO_Count];
+	CArray<CShardOutput> shardOutputs;
+	CMap<CUnicodeString, int> shardPositions;
+
+	void load();
+	bool parseLine( CUnicodePart line, bool& hasVersion );
+	static bool parseOutput( CUnicodePart str, uint64_t& hash, uint64_t& stamp );
+	bool parseShardOutput( CUnicodePart str );
+	void saveShardOutputs( CString& result );
+	static bool parseHash( CUnicodePart str, uint64_t& result );
+	static uint64_t getFileStamp( CUnicodeView fileName );
+	static CString getHashText( uint64_t hash );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
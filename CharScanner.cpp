@@ -0,0 +1,182 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <CharScanner.h>
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+#include <intrin.h>
+#include <immintrin.h>
+#define MSG_VECTOR_SCAN
+#endif
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Number of characters compared at once.
+const int scanTargetCount = 4;
+
+// Search function. The search always stops at the terminating null, whatever the targets are.
+typedef int ( *TScanFunction )( const wchar_t* str, int pos, const wchar_t* targets );
+
+template<bool isInverted>
+static int scanScalar( const wchar_t* str, int pos, const wchar_t* targets )
+{
+	for( ;; pos++ ) {
+		const wchar_t ch = str[pos];
+		const bool isTarget = ch == targets[0] || ch == targets[1] || ch == targets[2] || ch == targets[3];
+		if( isTarget != isInverted || ch == 0 ) {
+			return pos;
+		}
+	}
+}
+
+#ifdef MSG_VECTOR_SCAN
+
+static_assert( sizeof( wchar_t ) == 2, "Vector scan expects 16-bit characters." );
+
+struct CSse2Vector {
+	typedef __m128i TVector;
+	static const int Size = 16;
+	static const unsigned FullMask = 0xFFFF;
+
+	static TVector Load( const BYTE* ptr )
+		{ return _mm_load_si128( reinterpret_cast<const __m128i*>( ptr ) ); }
+	static TVector Broadcast( wchar_t ch )
+		{ return _mm_set1_epi16( static_cast<short>( ch ) ); }
+	static TVector Equal( TVector left, TVector right )
+		{ return _mm_cmpeq_epi16( left, right ); }
+	static TVector Or( TVector left, TVector right )
+		{ return _mm_or_si128( left, right ); }
+	static unsigned Mask( TVector vector )
+		{ return static_cast<unsigned>( _mm_movemask_epi8( vector ) ); }
+};
+
+struct CAvx2Vector {
+	typedef __m256i TVector;
+	static const int Size = 32;
+	static const unsigned FullMask = 0xFFFFFFFF;
+
+	static TVector Load( const BYTE* ptr )
+		{ return _mm256_load_si256( reinterpret_cast<const __m256i*>( ptr ) ); }
+	static TVector Broadcast( wchar_t ch )
+		{ return _mm256_set1_epi16( static_cast<short>( ch ) ); }
+	static TVector Equal( TVector left, TVector right )
+		{ return _mm256_cmpeq_epi16( left, right ); }
+	static TVector Or( TVector left, TVector right )
+		{ return _mm256_or_si256( left, right ); }
+	static unsigned Mask( TVector vector )
+		{ return static_cast<unsigned>( _mm256_movemask_epi8( vector ) ); }
+};
+
+// Byte mask of the characters in the block that stop the search. Each character gives two bits.
+// The terminating null stops every search, so a search with four non-null targets never runs past the end of the string.
+template<class Vector, bool isInverted>
+static unsigned getStopMask( const BYTE* block, const typename Vector::TVector* targets )
+{
+	const auto data = Vector::Load( block );
+	auto matches = Vector::Equal( data, targets[0] );
+	for( int i = 1; i < scanTargetCount; i++ ) {
+		matches = Vector::Or( matches, Vector::Equal( data, targets[i] ) );
+	}
+	const unsigned nullMask = Vector::Mask( Vector::Equal( data, Vector::Broadcast( 0 ) ) );
+	const unsigned matchMask = isInverted ? ~Vector::Mask( matches ) & Vector::FullMask : Vector::Mask( matches );
+	return matchMask | nullMask;
+}
+
+template<class Vector, bool isInverted>
+static int scanVector( const wchar_t* str, int pos, const wchar_t* targets )
+{
+	typename Vector::TVector targetVectors[scanTargetCount];
+	for( int i = 0; i < scanTargetCount; i++ ) {
+		targetVectors[i] = Vector::Broadcast( targets[i] );
+	}
+
+	const BYTE* start = reinterpret_cast<const BYTE*>( str + pos );
+	const unsigned misalignment = static_cast<unsigned>( reinterpret_cast<uintptr_t>( start ) & ( Vector::Size - 1 ) );
+	const BYTE* block = start - misalignment;
+	// Ignore the characters in front of the start position.
+	unsigned mask = getStopMask<Vector, isInverted>( block, targetVectors ) & ( Vector::FullMask << misalignment );
+	while( mask == 0 ) {
+		block += Vector::Size;
+		mask = getStopMask<Vector, isInverted>( block, targetVectors );
+	}
+
+	unsigned long byteIndex;
+	_BitScanForward( &byteIndex, mask );
+	return static_cast<int>( ( block + byteIndex - reinterpret_cast<const BYTE*>( str ) ) / sizeof( wchar_t ) );
+}
+
+static bool isCpuFeatureSupported( int leaf, int registerIndex, int bit )
+{
+	int info[4];
+	__cpuid( info, 0 );
+	if( info[0] < leaf ) {
+		return false;
+	}
+	__cpuidex( info, leaf, 0 );
+	return ( info[registerIndex] & ( 1 << bit ) ) != 0;
+}
+
+static bool isAvx2Supported()
+{
+	// The OS must save the AVX registers on context switches.
+	const bool osSupportsAvx = isCpuFeatureSupported( 1, 2, 27 ) && isCpuFeatureSupported( 1, 2, 28 )
+		&& ( _xgetbv( 0 ) & 6 ) == 6;
+	return osSupportsAvx && isCpuFeatureSupported( 7, 1, 5 );
+}
+
+static bool isSse2Supported()
+{
+	return isCpuFeatureSupported( 1, 3, 26 );
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+
+struct CScanImplementation {
+	TScanFunction Find;
+	TScanFunction FindNot;
+	CStringView Name;
+};
+
+static CScanImplementation selectScanImplementation()
+{
+#ifdef MSG_VECTOR_SCAN
+	if( isAvx2Supported() ) {
+		return CScanImplementation{ scanVector<CAvx2Vector, false>, scanVector<CAvx2Vector, true>, "AVX2" };
+	}
+	if( isSse2Supported() ) {
+		return CScanImplementation{ scanVector<CSse2Vector, false>, scanVector<CSse2Vector, true>, "SSE2" };
+	}
+#endif
+	return CScanImplementation{ scanScalar<false>, scanScalar<true>, "Scalar" };
+}
+
+static const CScanImplementation scanImplementation = selectScanImplementation();
+
+int CCharScanner::FindAnyOf( const wchar_t* str, int pos, wchar_t first, wchar_t second, wchar_t third, wchar_t fourth )
+{
+	const wchar_t targets[scanTargetCount] = { first, second, third, fourth };
+	const int result = scanImplementation.Find( str, pos, targets );
+	// The search stops at the terminating null even if all four targets are used.
+	assert( str[result] == 0 || str[result] == first || str[result] == second || str[result] == third || str[result] == fourth );
+	return result;
+}
+
+int CCharScanner::SkipAsciiWhitespace( const wchar_t* str, int pos )
+{
+	const wchar_t targets[scanTargetCount] = { L' ', L'\t', L'\r', L'\n' };
+	return scanImplementation.FindNot( str, pos, targets );
+}
+
+CStringView CCharScanner::ImplementationName()
+{
+	return scanImplementation.Name;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Vectorized search for characters in null-terminated wide strings.
+// The implementation is chosen at runtime: AVX2, SSE2 or a scalar fallback.
+// Vector searches read whole aligned blocks, so they may read past the terminating null up to the end of its block.
+// Aligned blocks never cross a page boundary so this is always safe.
+class CCharScanner {
+public:
+	// Find the first character starting from pos that is equal to one of the given characters or to the terminating null.
+	static int FindAnyOf( const wchar_t* str, int pos, wchar_t first, wchar_t second = 0, wchar_t third = 0, wchar_t fourth = 0 );
+	// Find the first character starting from pos that is not a space, a tab or a newline symbol.
+	// The terminating null is never skipped.
+	static int SkipAsciiWhitespace( const wchar_t* str, int pos );
+
+	// Name of the selected implementation.
+	static CStringView ImplementationName();
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
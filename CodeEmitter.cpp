@@ -0,0 +1,172 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <CodeEmitter.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+CEmitterArg::CEmitterArg( CStringPart _str, CStringPart _suffix ) :
+	type( AT_String ),
+	str( _str ),
+	suffix( _suffix )
+{
+}
+
+CEmitterArg::CEmitterArg( CStringView _str ) :
+	type( AT_String ),
+	str( _str )
+{
+}
+
+CEmitterArg::CEmitterArg( CUnicodePart _str ) :
+	type( AT_UnicodeString ),
+	unicodeStr( _str )
+{
+}
+
+CEmitterArg::CEmitterArg( int _number ) :
+	type( AT_Number ),
+	number( _number )
+{
+}
+
+int CEmitterArg::Length() const
+{
+	switch( type ) {
+		case AT_String:
+			return str.Length() + suffix.Length();
+		case AT_UnicodeString:
+			return isAscii( unicodeStr ) ? unicodeStr.Length() : Str( unicodeStr ).Length();
+		case AT_Number:
+			return getNumberLength( number );
+		default:
+			assert( false );
+			return 0;
+	}
+}
+
+bool CEmitterArg::isAscii( CUnicodePart str )
+{
+	for( int i = 0; i < str.Length(); i++ ) {
+		if( str[i] >= 0x80 ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int CEmitterArg::getNumberLength( int value )
+{
+	unsigned absValue = value < 0 ? 0u - static_cast<unsigned>( value ) : static_cast<unsigned>( value );
+	int result = value < 0 ? 2 : 1;
+	while( absValue >= 10 ) {
+		absValue /= 10;
+		result++;
+	}
+	return result;
+}
+
+void CEmitterArg::Write( char* dest ) const
+{
+	switch( type ) {
+		case AT_String:
+			memcpy( dest, str.Ptr(), str.Length() );
+			memcpy( dest + str.Length(), suffix.Ptr(), suffix.Length() );
+			break;
+		case AT_UnicodeString:
+			// ASCII strings are copied directly. Other strings are converted like the rest of the generated code.
+			if( isAscii( unicodeStr ) ) {
+				for( int i = 0; i < unicodeStr.Length(); i++ ) {
+					dest[i] = static_cast<char>( unicodeStr[i] );
+				}
+			} else {
+				const CString converted = Str( unicodeStr );
+				memcpy( dest, converted.Ptr(), converted.Length() );
+			}
+			break;
+		case AT_Number:
+		{
+			// Digits are written from the end.
+			unsigned absValue = number < 0 ? 0u - static_cast<unsigned>( number ) : static_cast<unsigned>( number );
+			char* digit = dest + getNumberLength( number );
+			do {
+				digit--;
+				*digit = static_cast<char>( '0' + absValue % 10 );
+				absValue /= 10;
+			} while( absValue > 0 );
+			if( number < 0 ) {
+				dest[0] = '-';
+			}
+			break;
+		}
+		default:
+			assert( false );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void CCodeEmitter::Emit( const std::function<void( CCodeEmitter& )>& fill )
+{
+	isMeasuring = true;
+	pos = 0;
+	fill( *this );
+
+	buffer.Empty();
+	buffer.IncreaseSize( pos );
+	isMeasuring = false;
+	pos = 0;
+	fill( *this );
+	assert( pos == buffer.Size() );
+}
+
+void CCodeEmitter::Append( CStringPart str )
+{
+	appendChars( str.Ptr(), str.Length() );
+}
+
+void CCodeEmitter::Append( CUnicodePart str )
+{
+	const CEmitterArg arg( str );
+	if( !isMeasuring ) {
+		arg.Write( buffer.Ptr() + pos );
+	}
+	pos += arg.Length();
+}
+
+void CCodeEmitter::appendChars( const char* chars, int length )
+{
+	if( !isMeasuring ) {
+		memcpy( buffer.Ptr() + pos, chars, length );
+	}
+	pos += length;
+}
+
+// Runs of the format between the parameters are copied whole.
+void CCodeEmitter::appendTemplate( CStringPart format, const CEmitterArg* args, int argCount )
+{
+	const int length = format.Length();
+	int runStart = 0;
+	for( int i = 0; i + 1 < length; i++ ) {
+		if( format[i] != '%' || format[i + 1] < '0' || format[i + 1] > '9' ) {
+			continue;
+		}
+		const int argIndex = format[i + 1] - '0';
+		assert( argIndex < argCount );
+		appendChars( format.Ptr() + runStart, i - runStart );
+		const CEmitterArg& arg = args[argIndex];
+		if( !isMeasuring ) {
+			arg.Write( buffer.Ptr() + pos );
+		}
+		pos += arg.Length();
+		i++;
+		runStart = i + 1;
+	}
+	appendChars( format.Ptr() + runStart, length - runStart );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
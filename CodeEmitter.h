@@ -0,0 +1,74 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// A template parameter of the code emitter: a narrow string with an optional suffix, a wide string or a number.
+// Wide strings are converted by Str, so identifiers that are not ASCII come out as in the rest of the generated code.
+class CEmitterArg {
+public:
+	CEmitterArg( CStringPart str, CStringPart suffix = CStringPart() );
+	CEmitterArg( CStringView str );
+	CEmitterArg( CUnicodePart str );
+	CEmitterArg( int number );
+
+	int Length() const;
+	// Write the parameter text. The destination must have room for Length() characters.
+	void Write( char* dest ) const;
+
+private:
+	enum TArgType {
+		AT_String,
+		AT_UnicodeString,
+		AT_Number
+	};
+
+	TArgType type;
+	CStringPart str;
+	CStringPart suffix;
+	CUnicodePart unicodeStr;
+	int number = 0;
+
+	static bool isAscii( CUnicodePart str );
+	static int getNumberLength( int value );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Writer of generated code into a single buffer of the exact output size.
+// The code is produced by running the same fill function twice. The first pass only counts the characters,
+// the second pass writes them into a buffer that is allocated once. Templates are expanded in place:
+// parameters %0 to %9 are written directly to the buffer, no temporary strings are created.
+class CCodeEmitter {
+public:
+	// Run both passes of a fill function.
+	void Emit( const std::function<void( CCodeEmitter& )>& fill );
+
+	// Emitted text. Valid after Emit.
+	CStringPart Text() const
+		{ return CStringPart( buffer.Ptr(), buffer.Size() ); }
+
+	void Append( CStringPart str );
+	// Wide strings are converted like CEmitterArg does.
+	void Append( CUnicodePart str );
+	void AppendTemplate( CStringPart format, const CEmitterArg& arg0 )
+		{ appendTemplate( format, &arg0, 1 ); }
+	void AppendTemplate( CStringPart format, const CEmitterArg& arg0, const CEmitterArg& arg1 )
+		{ const CEmitterArg args[] = { arg0, arg1 }; appendTemplate( format, args, 2 ); }
+	void AppendTemplate( CStringPart format, const CEmitterArg& arg0, const CEmitterArg& arg1, const CEmitterArg& arg2 )
+		{ const CEmitterArg args[] = { arg0, arg1, arg2 }; appendTemplate( format, args, 3 ); }
+
+private:
+	CArray<char> buffer;
+	bool isMeasuring = true;
+	// Measured length in the first pass, write position in the second pass.
+	int pos = 0;
+
+	void appendTemplate( CStringPart format, const CEmitterArg* args, int argCount );
+	void appendChars( const char* chars, int length );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
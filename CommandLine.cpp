@@ -0,0 +1,220 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <CommandLine.h>
+#include <MessageParams.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+static const CUnicodeView batchFlag = L"--batch";
+static const CUnicodeView localesFlag = L"--locales";
+static const CUnicodeView watchFlag = L"--watch";
+static const CUnicodeView jobsFlag = L"--jobs";
+static const CUnicodeView formatFlag = L"--format";
+static const CUnicodeView encodingFlag = L"--encoding";
+static const CUnicodeView mergeStringsFlag = L"--merge-strings";
+static const CUnicodeView compressBlocksFlag = L"--compress-blocks";
+static const CUnicodeView stableIdsFlag = L"--stable-ids";
+static const CUnicodeView compactIdsFlag = L"--compact-ids";
+static const CUnicodeView incrementalFlag = L"--incremental";
+static const CUnicodeView idFormFlag = L"--id-form";
+static const CUnicodeView embedFlag = L"--embed";
+static const CUnicodeView verifyFlag = L"--verify";
+static const CUnicodeView statsFlag = L"--stats";
+static const CUnicodeView shardsFlag = L"--shards";
+static const CUnicodeView parseJobsFlag = L"--parse-jobs";
+static const CUnicodeView streamingFlag = L"--streaming";
+static const CUnicodeView paramsFlag = L"--params";
+static const CUnicodeView deltaFlag = L"--delta";
+static const CUnicodeView profileFlag = L"--profile";
+
+extern const CError Err_UnknownFlag( L"Unknown command line flag: %0." );
+extern const CError Err_BadFileCount( L"Invalid command line. Expected arguments: <input.msg> <source output> <binary output>\n"
+	L"or --batch <manifest> [<manifest>...]\nor --locales <locale manifest> <source output> <binary output>\n"
+	L"or --watch <input.msg> <source output> <binary output>." );
+extern const CError Err_BadLocaleOptions( L"The locale mode requires the mapped format and can't be used with --batch, --streaming, --embed or --incremental." );
+extern const CError Err_BadWatchOptions( L"The watch mode can't be used with --batch, --locales, --streaming or --stats." );
+extern const CError Err_BadDeltaOptions( L"The delta output requires the mapped format and --stable-ids and can't be used with --batch or --incremental." );
+extern const CError Err_BadProfileOptions( L"The access profile requires the mapped format and can't be used with --batch or --streaming." );
+CCommandLine::CCommandLine( int argc, wchar_t* argv[] )
+{
+	for( int i = 1; i < argc; i++ ) {
+		const CUnicodeView arg = argv[i];
+		if( arg == batchFlag ) {
+			isBatchMode = true;
+		} else if( arg == localesFlag ) {
+			isLocaleMode = true;
+		} else if( arg == watchFlag ) {
+			options.Watch = true;
+		} else if( arg == jobsFlag ) {
+			workerCount = _wtoi( GetFlagValue( argc, argv, i ).Ptr() );
+		} else if( !ParseOptionFlag( argc, argv, i, options ) ) {
+			check( arg.IsEmpty() || arg[0] != L'-' || arg[1] != L'-', Err_UnknownFlag, arg );
+			fileNames.Add( arg );
+		}
+	}
+
+	check( isBatchMode ? !fileNames.IsEmpty() : fileNames.Size() == 3, Err_BadFileCount );
+	CheckOptions( options );
+	check( !isLocaleMode || ( !isBatchMode && options.BinaryFormat == BF_Mapped && !options.Streaming && !options.EmbedMessages && !options.Incremental ),
+		Err_BadLocaleOptions );
+	check( !options.Watch || ( !isBatchMode && !isLocaleMode && !options.Streaming && options.Stats == SF_None ), Err_BadWatchOptions );
+	check( options.DeltaBaseName.IsEmpty() || ( !isBatchMode && options.BinaryFormat == BF_Mapped && options.StableIds && !options.Incremental ),
+		Err_BadDeltaOptions );
+	check( options.ProfileName.IsEmpty() || !isBatchMode, Err_BadProfileOptions );
+}
+
+extern const CError Err_VerifyNeedsMappedFormat( L"Binary output verification requires the mapped format." );
+extern const CError Err_BadStreamingOptions( L"The streaming mode requires the mapped format and can't be used with --merge-strings, --embed, --verify or --params." );
+void CCommandLine::CheckOptions( const CCompilerOptions& options )
+{
+	check( !options.Verify || options.BinaryFormat == BF_Mapped, Err_VerifyNeedsMappedFormat );
+	check( !options.Streaming || ( options.BinaryFormat == BF_Mapped && !options.MergeStrings && !options.EmbedMessages && !options.Verify
+		&& options.MaxParamCount == 0 ),
+		Err_BadStreamingOptions );
+	check( options.ProfileName.IsEmpty() || ( options.BinaryFormat == BF_Mapped && !options.Streaming ), Err_BadProfileOptions );
+}
+
+bool CCommandLine::ParseOptionFlag( int argc, wchar_t* argv[], int& pos, CCompilerOptions& options )
+{
+	const CUnicodeView arg = argv[pos];
+	if( arg == formatFlag ) {
+		options.BinaryFormat = parseBinaryFormat( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == encodingFlag ) {
+		options.Encoding = parseEncoding( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == mergeStringsFlag ) {
+		options.MergeStrings = true;
+	} else if( arg == compressBlocksFlag ) {
+		options.CompressionBlockSize = parseBlockSize( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == stableIdsFlag ) {
+		options.StableIds = true;
+	} else if( arg == compactIdsFlag ) {
+		options.StableIds = true;
+		options.CompactIds = true;
+	} else if( arg == incrementalFlag ) {
+		options.Incremental = true;
+	} else if( arg == idFormFlag ) {
+		options.IdForm = parseIdForm( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == embedFlag ) {
+		options.EmbedMessages = true;
+	} else if( arg == verifyFlag ) {
+		options.Verify = true;
+	} else if( arg == shardsFlag ) {
+		parseShardMode( GetFlagValue( argc, argv, pos ), options );
+	} else if( arg == parseJobsFlag ) {
+		options.ParseWorkerCount = parseParseJobs( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == streamingFlag ) {
+		options.Streaming = true;
+	} else if( arg == paramsFlag ) {
+		options.MaxParamCount = parseParamCount( GetFlagValue( argc, argv, pos ) );
+	} else if( arg == deltaFlag ) {
+		options.DeltaBaseName = GetFlagValue( argc, argv, pos );
+	} else if( arg == profileFlag ) {
+		options.ProfileName = GetFlagValue( argc, argv, pos );
+	} else if( arg == statsFlag ) {
+		options.Stats = parseStatsFormat( GetFlagValue( argc, argv, pos ) );
+	} else {
+		return false;
+	}
+	return true;
+}
+
+extern const CError Err_MissingFlagValue( L"Command line flag %0 requires a value." );
+CUnicodeView CCommandLine::GetFlagValue( int argc, wchar_t* argv[], int& pos )
+{
+	check( pos + 1 < argc, Err_MissingFlagValue, CUnicodeView( argv[pos] ) );
+	pos++;
+	return argv[pos];
+}
+
+extern const CError Err_UnknownFormat( L"Unknown binary format: %0. Supported formats: stream, mapped." );
+TBinaryFormat CCommandLine::parseBinaryFormat( CUnicodeView value )
+{
+	if( value == L"stream" ) {
+		return BF_Stream;
+	}
+	check( value == L"mapped", Err_UnknownFormat, value );
+	return BF_Mapped;
+}
+
+extern const CError Err_UnknownEncoding( L"Unknown string encoding: %0. Supported encodings: wide, utf8." );
+TMessageTableEncoding CCommandLine::parseEncoding( CUnicodeView value )
+{
+	if( value == L"wide" ) {
+		return MTE_Wide;
+	}
+	check( value == L"utf8", Err_UnknownEncoding, value );
+	return MTE_Utf8;
+}
+
+extern const CError Err_UnknownIdForm( L"Unknown ID form: %0. Supported forms: extern, constexpr, enum." );
+TIdForm CCommandLine::parseIdForm( CUnicodeView value )
+{
+	if( value == L"extern" ) {
+		return IF_Extern;
+	}
+	if( value == L"constexpr" ) {
+		return IF_Constexpr;
+	}
+	check( value == L"enum", Err_UnknownIdForm, value );
+	return IF_Enum;
+}
+
+extern const CError Err_UnknownStatsFormat( L"Unknown statistics format: %0. Supported formats: text, json." );
+TStatsFormat CCommandLine::parseStatsFormat( CUnicodeView value )
+{
+	if( value == L"text" ) {
+		return SF_Text;
+	}
+	check( value == L"json", Err_UnknownStatsFormat, value );
+	return SF_Json;
+}
+
+extern const CError Err_BadShardMode( L"Invalid shard mode: %0. Expected section or a positive number of keys." );
+void CCommandLine::parseShardMode( CUnicodeView value, CCompilerOptions& options )
+{
+	if( value == L"section" ) {
+		options.ShardMode = SM_Section;
+		return;
+	}
+	const int keyCount = _wtoi( value.Ptr() );
+	check( keyCount > 0, Err_BadShardMode, value );
+	options.ShardMode = SM_KeyCount;
+	options.ShardKeyCount = keyCount;
+}
+
+extern const CError Err_BadBlockSize( L"Invalid compression block size: %0. Expected a positive number of bytes." );
+int CCommandLine::parseBlockSize( CUnicodeView value )
+{
+	const int result = _wtoi( value.Ptr() );
+	check( result > 0, Err_BadBlockSize, value );
+	return result;
+}
+
+extern const CError Err_BadParamCount( L"Invalid parameter count: %0. Expected a number from 1 to %1." );
+int CCommandLine::parseParamCount( CUnicodeView value )
+{
+	const int result = _wtoi( value.Ptr() );
+	check( result > 0 && result <= CMessageParams::MaxParamCount, Err_BadParamCount, value, CMessageParams::MaxParamCount );
+	return result;
+}
+
+extern const CError Err_BadParseJobs( L"Invalid parse thread count: %0. Expected a positive number." );
+// _wtoi accepts signs and trailing garbage, so the digits are checked first. Four digits are enough for any machine.
+int CCommandLine::parseParseJobs( CUnicodeView value )
+{
+	bool isNumber = !value.IsEmpty() && value.Length() <= 4;
+	for( int i = 0; isNumber && i < value.Length(); i++ ) {
+		isNumber = CUnicodeString::IsCharDigit( value[i] );
+	}
+	const int result = isNumber ? _wtoi( value.Ptr() ) : 0;
+	check( result > 0, Err_BadParseJobs, value );
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,83 @@
+#pragma once
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Parsed compiler arguments.
+// Single file mode: <input.msg> <source output> <binary output> [options]
+// Batch mode: --batch <manifest> [<manifest>...] [--jobs <workerCount>] [options]
+// Locale mode: --locales <locale manifest> <source output> <binary output> [--jobs <workerCount>] [options]
+// Watch mode: --watch <input.msg> <source output> <binary output> [options]
+// Options:
+// --format stream|mapped - binary output layout.
+// --encoding wide|utf8 - string encoding of the mapped format.
+// --merge-strings - deduplicate strings of the mapped format.
+// --compress-blocks <size> - compress the mapped format blob in blocks of the given size.
+// --stable-ids - keep message IDs in a .ids map file next to the message file.
+// --compact-ids - same as --stable-ids, additionally removes deleted names from the map and renumbers the IDs.
+// --incremental - skip unchanged inputs and leave unchanged outputs untouched.
+// --id-form extern|constexpr|enum - form of the generated ID constants.
+// --embed - put the message texts in the generated source.
+// --shards section|<keyCount> - split the generated message IDs into a header and source pair per section or per group of sections.
+// --verify - read the mapped binary output back and compare it to the message file.
+// --parse-jobs <count> - number of threads that parse a large message file. One disables parallel parsing.
+// --streaming - parse the message file in windows and write the mapped binary output while parsing.
+// --params <count> - check the message parameters and precompile them into the mapped format.
+// --delta <previous binary output> - write a delta from the previous version of the mapped binary output next to the binary output.
+// --profile <file> - lay out the mapped format by the message access counts from the file, most accessed messages first.
+// --stats text|json - report time, data sizes, allocations and memory of every compilation phase.
+class CCommandLine {
+public:
+	CCommandLine( int argc, wchar_t* argv[] );
+
+	bool IsBatchMode() const
+		{ return isBatchMode; }
+	// Compile the locales of a manifest into a single binary output. See CLocaleCompiler.
+	bool IsLocaleMode() const
+		{ return isLocaleMode; }
+	// Compile a single file again after every change. See CMessageCompiler::WatchFile.
+	bool IsWatchMode() const
+		{ return options.Watch; }
+	// Number of batch or locale workers. Zero means one worker per hardware thread.
+	int WorkerCount() const
+		{ return workerCount; }
+	const CCompilerOptions& Options() const
+		{ return options; }
+
+	// In single file mode: input file, source output name and binary output name.
+	// In batch mode: manifest names.
+	// In locale mode: locale manifest name, source output name and binary output name.
+	CArrayView<CUnicodeView> FileNames() const
+		{ return fileNames; }
+
+	// Parse a compiler option at the given position. Options with values advance the position past the value.
+	// Return false if the argument is not a compiler option.
+	static bool ParseOptionFlag( int argc, wchar_t* argv[], int& pos, CCompilerOptions& options );
+	// Get the value that follows a flag and advance the position to it.
+	static CUnicodeView GetFlagValue( int argc, wchar_t* argv[], int& pos );
+	// Check that the options can be used together.
+	static void CheckOptions( const CCompilerOptions& options );
+
+private:
+	bool isBatchMode = false;
+	bool isLocaleMode = false;
+	int workerCount = 0;
+	CCompilerOptions options;
+	CArray<CUnicodeView> fileNames;
+
+	static TBinaryFormat parseBinaryFormat( CUnicodeView value );
+	static TMessageTableEncoding parseEncoding( CUnicodeView value );
+	static TIdForm parseIdForm( CUnicodeView value );
+	static TStatsFormat parseStatsFormat( CUnicodeView value );
+	static void parseShardMode( CUnicodeView value, CCompilerOptions& options );
+	static int parseBlockSize( CUnicodeView value );
+	static int parseParamCount( CUnicodeView value );
+	static int parseParseJobs( CUnicodeView value );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
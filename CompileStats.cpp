@@ -0,0 +1,217 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <CompileStats.h>
+#include <Psapi.h>
+#include <malloc.h>
+
+//////////////////////////////////////////////////////////////////////////
+
+// Every thread counts into the scope of the phase it works for, so concurrent phases and compilations don't count each other's calls.
+// The flag is only written before the worker threads start, so a plain bool is enough.
+// Block sizes are taken from the heap, so that the unsized delete can subtract them too.
+static bool isAllocationCountingEnabled = false;
+static thread_local Msg::CAllocationScope* allocationScope = nullptr;
+
+void* operator new( size_t size )
+{
+	void* result = malloc( size == 0 ? 1 : size );
+	if( result == nullptr ) {
+		throw std::bad_alloc();
+	}
+	if( isAllocationCountingEnabled && allocationScope != nullptr ) {
+		allocationScope->Count.fetch_add( 1, std::memory_order_relaxed );
+		allocationScope->AddLiveBytes( static_cast<int64_t>( _msize( result ) ) );
+	}
+	return result;
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	if( isAllocationCountingEnabled && allocationScope != nullptr && ptr != nullptr ) {
+		allocationScope->LiveBytes.fetch_sub( static_cast<int64_t>( _msize( ptr ) ), std::memory_order_relaxed );
+	}
+	free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+	operator delete( ptr );
+}
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+static const CStringView phaseNames[CP_Count] = { "read", "parse", "ids", "header", "source", "shards", "binary", "verify" };
+
+CCompileStats::CCompileStats( CUnicodeView _fileName ) :
+	fileName( _fileName )
+{
+}
+
+void CCompileStats::EnableAllocationCounting()
+{
+	isAllocationCountingEnabled = true;
+}
+
+CAllocationScope* CCompileStats::GetAllocationScope()
+{
+	return allocationScope;
+}
+
+void CCompileStats::SetAllocationScope( CAllocationScope* newValue )
+{
+	allocationScope = newValue;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void CAllocationScope::AddLiveBytes( int64_t size )
+{
+	UpdatePeak( LiveBytes.fetch_add( size, std::memory_order_relaxed ) + size );
+}
+
+void CAllocationScope::UpdatePeak( int64_t bytes )
+{
+	int64_t peak = PeakBytes.load( std::memory_order_relaxed );
+	while( bytes > peak && !PeakBytes.compare_exchange_weak( peak, bytes, std::memory_order_relaxed ) ) {
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int64_t CCompileStats::GetPeakMemory()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if( !::GetProcessMemoryInfo( ::GetCurrentProcess(), &counters, sizeof( counters ) ) ) {
+		return 0;
+	}
+	return static_cast<int64_t>( counters.PeakPagefileUsage );
+}
+
+int64_t CCompileStats::GetPageFaultCount()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if( !::GetProcessMemoryInfo( ::GetCurrentProcess(), &counters, sizeof( counters ) ) ) {
+		return 0;
+	}
+	return static_cast<int64_t>( counters.PageFaultCount );
+}
+
+int64_t CCompileStats::GetFileSize( CUnicodeView fileName )
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if( !::GetFileAttributesExW( fileName.Ptr(), GetFileExInfoStandard, &attributes ) ) {
+		return 0;
+	}
+	return ( static_cast<int64_t>( attributes.nFileSizeHigh ) << 32 ) | attributes.nFileSizeLow;
+}
+
+void CCompileStats::SetTotals( int _messageCount, int _sectionCount, int _escapeCount )
+{
+	messageCount = _messageCount;
+	sectionCount = _sectionCount;
+	escapeCount = _escapeCount;
+}
+
+static CString getNumberText( int64_t value )
+{
+	char buffer[32];
+	sprintf_s( buffer, "%lld", value );
+	return Str( CStringView( buffer ) );
+}
+
+CString CCompileStats::CreateReport( TStatsFormat format ) const
+{
+	assert( format != SF_None );
+	return format == SF_Json ? createJsonReport() : createTextReport();
+}
+
+static const CStringView textHeaderTemplate = "Compilation statistics of %0:\r\n"
+	"phase       time, ms     bytes in    bytes out  allocations   peak, KB\r\n";
+static const CStringView textTotalsTemplate = "Messages: %0, sections: %1, escapes decoded: %2, peak memory of the process: %3 KB.";
+CString CCompileStats::createTextReport() const
+{
+	CString result = textHeaderTemplate.SubstParam( fileName );
+	for( int i = 0; i < CP_Count; i++ ) {
+		const CPhaseStats& phase = phases[i];
+		if( !phase.IsMeasured ) {
+			continue;
+		}
+		char line[256];
+		sprintf_s( line, "%-8s %11.3f %12lld %12lld %12lld %10lld\r\n", phaseNames[i].Ptr(), phase.Seconds * 1000,
+			phase.BytesIn, phase.BytesOut, phase.AllocationCount, phase.PeakMemory / 1024 );
+		result += line;
+	}
+	result += textTotalsTemplate.SubstParam( messageCount, sectionCount, escapeCount, getNumberText( GetPeakMemory() / 1024 ) );
+	return result;
+}
+
+// A single line object, so that reports of several files form a JSON lines stream.
+static const CStringView jsonPhaseTemplate = "\"%0\":{\"seconds\":%1,\"bytesIn\":%2,\"bytesOut\":%3,\"allocations\":%4,\"peakMemory\":%5}";
+static const CStringView jsonTotalsTemplate = "},\"messages\":%0,\"sections\":%1,\"escapes\":%2,\"processPeakMemory\":%3}";
+CString CCompileStats::createJsonReport() const
+{
+	CString result = "{\"file\":\"";
+	for( int i = 0; i < fileName.Length(); i++ ) {
+		const wchar_t ch = fileName[i];
+		if( ch == L'\\' || ch == L'"' ) {
+			result += '\\';
+		}
+		result += ch < 0x80 ? static_cast<char>( ch ) : '?';
+	}
+	result += "\",\"phases\":{";
+	bool isFirst = true;
+	for( int i = 0; i < CP_Count; i++ ) {
+		const CPhaseStats& phase = phases[i];
+		if( !phase.IsMeasured ) {
+			continue;
+		}
+		if( !isFirst ) {
+			result += ",";
+		}
+		isFirst = false;
+		char seconds[64];
+		sprintf_s( seconds, "%.6f", phase.Seconds );
+		result += jsonPhaseTemplate.SubstParam( phaseNames[i], seconds, getNumberText( phase.BytesIn ), getNumberText( phase.BytesOut ),
+			getNumberText( phase.AllocationCount ), getNumberText( phase.PeakMemory ) );
+	}
+	result += jsonTotalsTemplate.SubstParam( messageCount, sectionCount, escapeCount, getNumberText( GetPeakMemory() ) );
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CPhaseTimer::CPhaseTimer( CCompileStats* stats, TCompilePhase phase ) :
+	phaseStats( stats == nullptr ? nullptr : &stats->Phase( phase ) )
+{
+	if( phaseStats != nullptr ) {
+		parentScope = CCompileStats::GetAllocationScope();
+		CCompileStats::SetAllocationScope( &allocations );
+		startTime = std::chrono::steady_clock::now();
+	}
+}
+
+CPhaseTimer::~CPhaseTimer()
+{
+	if( phaseStats == nullptr ) {
+		return;
+	}
+	phaseStats->Seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+	CCompileStats::SetAllocationScope( parentScope );
+	const int64_t count = allocations.Count.load( std::memory_order_relaxed );
+	const int64_t peakBytes = allocations.PeakBytes.load( std::memory_order_relaxed );
+	phaseStats->AllocationCount += count;
+	phaseStats->PeakMemory = std::max( phaseStats->PeakMemory, peakBytes );
+	phaseStats->IsMeasured = true;
+	if( parentScope != nullptr ) {
+		parentScope->Count.fetch_add( count, std::memory_order_relaxed );
+		parentScope->UpdatePeak( parentScope->LiveBytes.load( std::memory_order_relaxed ) + peakBytes );
+		parentScope->LiveBytes.fetch_add( allocations.LiveBytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,110 @@
+#pragma once
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Measured phases of a compilation.
+enum TCompilePhase {
+	// Reading and decoding the message file.
+	CP_Read,
+	CP_Parse,
+	// Loading and updating the ID map.
+	CP_Ids,
+	CP_Header,
+	CP_Source,
+	// Header and source pairs of the shards.
+	CP_Shards,
+	CP_Binary,
+	CP_Verify,
+	CP_Count
+};
+
+// Measurements of a single phase.
+struct CPhaseStats {
+	double Seconds = 0;
+	int64_t BytesIn = 0;
+	int64_t BytesOut = 0;
+	// Number of operator new calls made by the phase, including the calls of the worker threads that run its tasks.
+	int64_t AllocationCount = 0;
+	// Largest number of bytes allocated by the phase and not yet freed.
+	int64_t PeakMemory = 0;
+	bool IsMeasured = false;
+};
+
+// Allocations of a measured phase. The thread that runs the phase and the workers that run its tasks count into it.
+// Memory freed by the phase is subtracted, so the peak is the largest net allocation of the phase.
+struct CAllocationScope {
+	std::atomic<int64_t> Count{ 0 };
+	std::atomic<int64_t> LiveBytes{ 0 };
+	std::atomic<int64_t> PeakBytes{ 0 };
+
+	void AddLiveBytes( int64_t size );
+	void UpdatePeak( int64_t bytes );
+};
+
+// Statistics of the compilation of a single file.
+// Statistics are collected only if an object exists, so compilations without the stats option do no extra work.
+class CCompileStats {
+public:
+	explicit CCompileStats( CUnicodeView fileName );
+
+	// Start counting allocations. Must be called before any worker threads are started.
+	// Without it the allocation counts are zero.
+	static void EnableAllocationCounting();
+	// Scope of the phase that the calling thread works for. Null outside of measured phases.
+	// Worker threads take the scope of the thread that started them.
+	static CAllocationScope* GetAllocationScope();
+	static void SetAllocationScope( CAllocationScope* newValue );
+	// Peak committed memory of the process since its start. The value never decreases, so it is reported once per compilation.
+	static int64_t GetPeakMemory();
+	// Number of page faults of the process, including the faults that are resolved without reading the disk.
+	static int64_t GetPageFaultCount();
+	// Size of a file in bytes. Zero if the file doesn't exist.
+	static int64_t GetFileSize( CUnicodeView fileName );
+
+	CPhaseStats& Phase( TCompilePhase phase )
+		{ return phases[phase]; }
+	const CPhaseStats& Phase( TCompilePhase phase ) const
+		{ return phases[phase]; }
+
+	void SetTotals( int messageCount, int sectionCount, int escapeCount );
+
+	CString CreateReport( TStatsFormat format ) const;
+
+private:
+	CUnicodeString fileName;
+	CPhaseStats phases[CP_Count];
+	int messageCount = 0;
+	int sectionCount = 0;
+	int escapeCount = 0;
+
+	CString createTextReport() const;
+	CString createJsonReport() const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Measurement of a phase from the construction to the destruction of the timer.
+// A timer without statistics does nothing.
+class CPhaseTimer {
+public:
+	CPhaseTimer( CCompileStats* stats, TCompilePhase phase );
+	~CPhaseTimer();
+
+private:
+	CPhaseStats* phaseStats;
+	std::chrono::steady_clock::time_point startTime;
+	CAllocationScope allocations;
+	// Scope of an enclosing phase on the same thread. It counts the allocations of this phase too.
+	CAllocationScope* parentScope = nullptr;
+
+	// Copying is prohibited.
+	CPhaseTimer( CPhaseTimer& ) = delete;
+	void operator=( CPhaseTimer& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
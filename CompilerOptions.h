@@ -0,0 +1,109 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Layout of the binary output file.
+enum TBinaryFormat {
+	// Serialized section names followed by serialized message strings. The file has to be read sequentially.
+	BF_Stream,
+	// Memory-mappable message table. The layout is described in MessageTableFormat.h.
+	BF_Mapped
+};
+
+// Form of the generated ID constants.
+enum TIdForm {
+	// extern const int declarations in the header, definitions in a separate source file.
+	// IDs can change without recompiling the code that uses them.
+	IF_Extern,
+	// inline constexpr int definitions in the header. No source file is generated.
+	IF_Constexpr,
+	// enum class per section and for the section IDs in the header. No source file is generated.
+	IF_Enum
+};
+
+// Splitting of the generated code into several header and source pairs.
+enum TShardMode {
+	// A single header and source.
+	SM_None,
+	// A pair per section.
+	SM_Section,
+	// A pair per group of consecutive sections with at least the given number of keys.
+	SM_KeyCount
+};
+
+// Form of the compilation statistics report.
+enum TStatsFormat {
+	SF_None,
+	SF_Text,
+	SF_Json
+};
+
+// Settings shared by all the compiled files.
+// Settings that change the outputs must be included in GetOptionsHash.
+struct CCompilerOptions {
+	TBinaryFormat BinaryFormat = BF_Stream;
+	// String encoding of the mapped format.
+	TMessageTableEncoding Encoding = MTE_Wide;
+	// Share the bytes of identical strings and strings that end other strings in the mapped format.
+	bool MergeStrings = false;
+	// Target size of independently compressed blob blocks in the mapped format. Zero disables compression.
+	int CompressionBlockSize = 0;
+	// Keep message and section IDs in a map file next to the message file instead of numbering them by position.
+	bool StableIds = false;
+	// Remove the tombstones of the deleted names from the ID map and renumber the IDs densely.
+	bool CompactIds = false;
+	TIdForm IdForm = IF_Extern;
+	// Put the message texts in the generated source as string literals. Uses the encoding and merging settings.
+	bool EmbedMessages = false;
+	// Put the message IDs in shards. The main header and source keep only the section IDs and the embedded texts.
+	TShardMode ShardMode = SM_None;
+	// Minimum number of keys in a shard in the key count mode.
+	int ShardKeyCount = 0;
+	// Read the mapped binary output back after compilation and check that every lookup gives the parsed value.
+	bool Verify = false;
+	// Skip the compilation if the input hasn't changed and write only the changed outputs.
+	// Content hashes are stored in a .cache file next to the binary output.
+	bool Incremental = false;
+	// Number of threads that parse a large message file. Zero means one thread per hardware thread.
+	int ParseWorkerCount = 0;
+	// Read and parse the message file in windows and write the messages to the mapped binary output while parsing.
+	// Only the keys are kept in memory. Can't be combined with string merging, embedding and verification.
+	bool Streaming = false;
+	// Check that every message has at most this many parameters numbered from zero without gaps,
+	// and put the messages split into literal spans and parameter slots in the mapped format. Zero disables the parameter checks.
+	int MaxParamCount = 0;
+	// Previous version of the mapped binary output. If set, a delta from it to the new version is written next to the binary output.
+	// The delta doesn't change the other outputs.
+	CUnicodeString DeltaBaseName;
+	// Access profile of the messages. If set, the values in the mapped format are laid out from the most accessed to the least accessed,
+	// so that the frequently used messages share a few pages. See CAccessProfile.
+	CUnicodeString ProfileName;
+	// Keep the parsed message file in memory and parse only its changed parts when it is compiled again. Used by the watch mode.
+	bool Watch = false;
+	// Measure the compilation phases and report the results for every compiled file.
+	TStatsFormat Stats = SF_None;
+};
+
+inline uint64_t GetOptionsHash( const CCompilerOptions& options )
+{
+	uint64_t hash = HashValue( options.BinaryFormat );
+	hash = HashValue( options.Encoding, hash );
+	hash = HashValue( options.MergeStrings, hash );
+	hash = HashValue( options.CompressionBlockSize, hash );
+	hash = HashValue( options.StableIds, hash );
+	hash = HashValue( options.CompactIds, hash );
+	hash = HashValue( options.IdForm, hash );
+	hash = HashValue( options.ShardMode, hash );
+	hash = HashValue( options.ShardKeyCount, hash );
+	hash = HashValue( options.Streaming, hash );
+	hash = HashValue( options.MaxParamCount, hash );
+	return HashValue( options.EmbedMessages, hash );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,261 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <EmbeddedTableWriter.h>
+#include <MessageFile.h>
+#include <MessageIdMap.h>
+#include <StringBlob.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// MSVC limits a string literal to 64K bytes after concatenation and a single literal piece to 16K characters.
+static const int maxChunkSize = 32 * 1024;
+static const int maxLiteralLineLength = 2048;
+static const int arrayValuesPerLine = 16;
+
+CEmbeddedTableWriter::CEmbeddedTableWriter( const CMessageFile& _input, const CMessageIds& _ids, const CCompilerOptions& _options ) :
+	input( _input ),
+	ids( _ids ),
+	options( _options )
+{
+}
+
+static const CStringView wideCharType = "wchar_t";
+static const CStringView utf8CharType = "char";
+static const CStringView declarationTemplate = "namespace %0 {\r\n\r\n"
+	"// Embedded message texts. The strings are null-terminated and stay valid for the lifetime of the program.\r\n"
+	"extern const int MessageCount;\r\n"
+	"const %1* GetString( int messageId );\r\n"
+	"int GetLength( int messageId );\r\n\r\n"
+	"}	// namespace %0.\r\n\r\n";
+void CEmbeddedTableWriter::FillDeclaration( CStringPart tableName, CString& result ) const
+{
+	result += declarationTemplate.SubstParam( tableName, options.Encoding == MTE_Utf8 ? utf8CharType : wideCharType );
+}
+
+static const CStringView tablePrefixTemplate = "namespace %0 {\r\n\r\n";
+static const CStringView chunkListPrefixTemplate = "static const %0* const chunks[] = {\r\n";
+static const CStringView chunkListItemTemplate = "\tchunk%0,\r\n";
+static const CStringView entryListPrefix = "// Chunk, offset and length of each message.\r\nstatic const int entries[][3] = {\r\n";
+static const CStringView entryTemplate = "\t{ %0, %1, %2 },\r\n";
+static const CStringView listSuffix = "};\r\n\r\n";
+static const CStringView tableSuffixTemplate = "extern const int MessageCount = %1;\r\n\r\n"
+	"const %2* GetString( int messageId )\r\n"
+	"{\r\n"
+	"	return chunks[entries[messageId][0]] + entries[messageId][1];\r\n"
+	"}\r\n\r\n"
+	"int GetLength( int messageId )\r\n"
+	"{\r\n"
+	"	return entries[messageId][2];\r\n"
+	"}\r\n\r\n"
+	"}	// namespace %0.\r\n\r\n";
+void CEmbeddedTableWriter::FillDefinition( CStringPart tableName, CString& result ) const
+{
+	const TMessageTableEncoding encoding = options.Encoding;
+	const int charSize = GetEncodingCharSize( encoding );
+	const int messageCount = ids.MessageIdLimit;
+	CStringBlobBuilder blob( encoding, static_cast<int>( ( input.MessageBinarySize() / sizeof( wchar_t ) + messageCount + 1 ) * charSize ) );
+	// Message IDs that are not used by the file point to an empty string.
+	const int emptyHandle = messageCount > input.MessageCount() ? blob.Add( CUnicodePart() ) : NotFound;
+	CArray<int> handles;
+	handles.IncreaseSize( messageCount );
+	for( int& handle : handles ) {
+		handle = emptyHandle;
+	}
+	int messagePos = 0;
+	addMessages( input.GetUnnamedSections(), messagePos, blob, handles );
+	addMessages( input.GetNamedSections(), messagePos, blob, handles );
+	blob.Build( options.MergeStrings );
+
+	CArray<CChunk> chunks;
+	splitChunks( blob, chunks );
+	const CStringView charType = encoding == MTE_Utf8 ? utf8CharType : wideCharType;
+	result += tablePrefixTemplate.SubstParam( tableName );
+	const BYTE* blobData = blob.GetBlob().Ptr();
+	for( int i = 0; i < chunks.Size(); i++ ) {
+		fillChunk( blobData, chunks[i], i, result );
+	}
+	result += chunkListPrefixTemplate.SubstParam( charType );
+	for( int i = 0; i < chunks.Size(); i++ ) {
+		result += chunkListItemTemplate.SubstParam( i );
+	}
+	result += listSuffix;
+
+	result += entryListPrefix;
+	for( int id = 0; id < messageCount; id++ ) {
+		// Chunks are sorted by offset, find the last one that starts before the string.
+		const int offset = blob.GetOffset( handles[id] );
+		const int chunkId = static_cast<int>( std::upper_bound( chunks.begin(), chunks.end(), offset,
+			[]( int value, const CChunk& chunk ) { return value < chunk.Offset; } ) - chunks.begin() ) - 1;
+		result += entryTemplate.SubstParam( chunkId, ( offset - chunks[chunkId].Offset ) / charSize, blob.GetLength( handles[id] ) );
+	}
+	if( messageCount == 0 ) {
+		// Arrays can't be empty.
+		result += entryTemplate.SubstParam( 0, 0, 0 );
+	}
+	result += listSuffix;
+	result += tableSuffixTemplate.SubstParam( tableName, messageCount, charType );
+}
+
+void CEmbeddedTableWriter::addMessages( CArrayView<CMessageSection> sections, int& messagePos, CStringBlobBuilder& blob, CArray<int>& handles ) const
+{
+	for( const auto& section : sections ) {
+		for( const auto& value : section.GetKeyValues() ) {
+			handles[ids.MessageIds[messagePos]] = blob.Add( value );
+			messagePos++;
+		}
+	}
+}
+
+// Chunks end on stored string boundaries, so every string lies in a single chunk.
+// A string that is larger than the chunk limit gets a chunk of its own.
+void CEmbeddedTableWriter::splitChunks( const CStringBlobBuilder& blob, CArray<CChunk>& chunks ) const
+{
+	const auto stringEnds = blob.GetStoredStringEnds();
+	int chunkStart = 0;
+	int chunkEnd = 0;
+	for( int end : stringEnds ) {
+		if( end - chunkStart > maxChunkSize && chunkEnd > chunkStart ) {
+			chunks.Add( CChunk{ chunkStart, chunkEnd - chunkStart } );
+			chunkStart = chunkEnd;
+		}
+		chunkEnd = end;
+	}
+	if( chunkEnd > chunkStart || chunks.IsEmpty() ) {
+		chunks.Add( CChunk{ chunkStart, chunkEnd - chunkStart } );
+	}
+}
+
+static const CStringView chunkPrefixTemplate = "static const %0 chunk%1[] =";
+void CEmbeddedTableWriter::fillChunk( const BYTE* blobData, const CChunk& chunk, int chunkId, CString& result ) const
+{
+	const int charSize = GetEncodingCharSize( options.Encoding );
+	result += chunkPrefixTemplate.SubstParam( options.Encoding == MTE_Utf8 ? utf8CharType : wideCharType, chunkId );
+	// The last terminator of a literal is implicit.
+	const int length = chunk.Size / charSize;
+	if( chunk.Size <= maxChunkSize ) {
+		fillChunkLiteral( blobData + chunk.Offset, length > 0 ? length - 1 : 0, result );
+	} else {
+		fillChunkArray( blobData + chunk.Offset, length, result );
+	}
+}
+
+// Each message starts on a new line. Long messages are split into several literal pieces.
+void CEmbeddedTableWriter::fillChunkLiteral( const BYTE* data, int length, CString& result ) const
+{
+	const CStringView literalStart = options.Encoding == MTE_Utf8 ? "\r\n\t\"" : "\r\n\tL\"";
+	const CStringView literalBreak = options.Encoding == MTE_Utf8 ? "\" \"" : "\" L\"";
+	result += literalStart;
+	bool isAfterNumericEscape = false;
+	int lineLength = 0;
+	for( int i = 0; i < length; i++ ) {
+		const unsigned unit = getCodeUnit( data, i );
+		// A numeric escape would consume the following hex digits.
+		if( isAfterNumericEscape && isHexDigit( unit ) ) {
+			result += literalBreak;
+		}
+		isAfterNumericEscape = appendEscapedUnit( unit, result );
+		lineLength++;
+		if( ( unit == 0 || lineLength >= maxLiteralLineLength ) && i + 1 < length ) {
+			result += "\"";
+			result += literalStart;
+			isAfterNumericEscape = false;
+			lineLength = 0;
+		}
+	}
+	result += "\";\r\n\r\n";
+}
+
+static const CStringView charCastTemplate = "static_cast<char>( 0x%0 )";
+// Chunks that are too large for a literal are emitted as arrays of code units.
+// UTF-8 bytes above 0x7F don't fit a signed char, so they are cast explicitly to avoid a narrowing conversion in the initializer.
+void CEmbeddedTableWriter::fillChunkArray( const BYTE* data, int length, CString& result ) const
+{
+	result += " {";
+	for( int i = 0; i < length; i++ ) {
+		result += i % arrayValuesPerLine == 0 ? "\r\n\t" : " ";
+		const unsigned unit = getCodeUnit( data, i );
+		if( options.Encoding == MTE_Utf8 && unit >= 0x80 ) {
+			char buffer[8];
+			sprintf_s( buffer, "%X", unit );
+			result += charCastTemplate.SubstParam( CStringView( buffer ) );
+		} else {
+			result += Str( static_cast<int>( unit ) );
+		}
+		result += ",";
+	}
+	result += "\r\n};\r\n\r\n";
+}
+
+unsigned CEmbeddedTableWriter::getCodeUnit( const BYTE* data, int pos ) const
+{
+	if( options.Encoding == MTE_Utf8 ) {
+		return data[pos];
+	}
+	return reinterpret_cast<const wchar_t*>( data )[pos];
+}
+
+// Append a code unit in the source form. Return true if a numeric escape was used.
+bool CEmbeddedTableWriter::appendEscapedUnit( unsigned unit, CString& result )
+{
+	switch( unit ) {
+		case L'"':
+			result += "\\\"";
+			return false;
+		case L'\\':
+			result += "\\\\";
+			return false;
+		case L'?':
+			// Prevents trigraphs.
+			result += "\\?";
+			return false;
+		case L'\n':
+			result += "\\n";
+			return false;
+		case L'\r':
+			result += "\\r";
+			return false;
+		case L'\t':
+			result += "\\t";
+			return false;
+		default:
+			break;
+	}
+	if( unit >= 0x20 && unit < 0x7F ) {
+		result += static_cast<char>( unit );
+		return false;
+	}
+	char buffer[16];
+	sprintf_s( buffer, "\\x%x", unit );
+	result += buffer;
+	return true;
+}
+
+bool CEmbeddedTableWriter::isHexDigit( unsigned unit )
+{
+	return ( unit >= L'0' && unit <= L'9' ) || ( unit >= L'a' && unit <= L'f' ) || ( unit >= L'A' && unit <= L'F' );
+}
+
+static const CStringView tableNameSuffix = "Table";
+// Characters that can't be used in an identifier are replaced by underscores.
+CString CEmbeddedTableWriter::GetTableName( CUnicodeView srcOutputName )
+{
+	const CUnicodeString name = FileSystem::GetNameExt( srcOutputName );
+	CString result;
+	if( name.IsEmpty() || CUnicodeString::IsCharDigit( name[0] ) ) {
+		result += '_';
+	}
+	for( int i = 0; i < name.Length(); i++ ) {
+		const wchar_t ch = name[i];
+		const bool isValid = ( ch >= L'a' && ch <= L'z' ) || ( ch >= L'A' && ch <= L'Z' ) || ( ch >= L'0' && ch <= L'9' ) || ch == L'_';
+		result += isValid ? static_cast<char>( ch ) : '_';
+	}
+	result += tableNameSuffix;
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,51 @@
+#pragma once
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+class CMessageFile;
+class CMessageSection;
+class CStringBlobBuilder;
+struct CMessageIds;
+//////////////////////////////////////////////////////////////////////////
+
+// Generator of C++ code that contains the message texts, so that a program can use them without loading a binary file.
+// Messages are put in the same string blob as in the mapped table, using the same encoding and merging options.
+// The blob is split on string boundaries into chunks that are emitted as string literals within the compiler limits.
+// An entry table gives the chunk, the offset in code units and the length of every message.
+class CEmbeddedTableWriter {
+public:
+	CEmbeddedTableWriter( const CMessageFile& input, const CMessageIds& ids, const CCompilerOptions& options );
+
+	// Add the declarations of the table accessors to a header.
+	void FillDeclaration( CStringPart tableName, CString& result ) const;
+	// Add the table data and the accessors to a source file.
+	void FillDefinition( CStringPart tableName, CString& result ) const;
+
+	// Create a table name from the name of the generated source file.
+	static CString GetTableName( CUnicodeView srcOutputName );
+
+private:
+	// Byte range of a chunk in the blob.
+	struct CChunk {
+		int Offset;
+		int Size;
+	};
+
+	const CMessageFile& input;
+	const CMessageIds& ids;
+	const CCompilerOptions& options;
+
+	void addMessages( CArrayView<CMessageSection> sections, int& messagePos, CStringBlobBuilder& blob, CArray<int>& handles ) const;
+	void splitChunks( const CStringBlobBuilder& blob, CArray<CChunk>& chunks ) const;
+	void fillChunk( const BYTE* blobData, const CChunk& chunk, int chunkId, CString& result ) const;
+	void fillChunkLiteral( const BYTE* data, int length, CString& result ) const;
+	void fillChunkArray( const BYTE* data, int length, CString& result ) const;
+	unsigned getCodeUnit( const BYTE* data, int pos ) const;
+	static bool appendEscapedUnit( unsigned unit, CString& result );
+	static bool isHexDigit( unsigned unit );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,129 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <FileWatcher.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Size of the notification buffer in DWORDs. If the notifications overflow it, a change of the file is assumed.
+static const int notificationBufferSize = 16 * 1024;
+// Time without changes that ends the wait for a change, in milliseconds.
+static const DWORD settleTime = 50;
+
+extern const CError Err_CannotWatchFile( L"Failed to watch the changes of a file.\nFile name: %0. Error code: %1." );
+CFileWatcher::CFileWatcher( CUnicodeView _fileName ) :
+	fileName( _fileName )
+{
+	int nameStart = fileName.Length();
+	while( nameStart > 0 && fileName[nameStart - 1] != L'\\' && fileName[nameStart - 1] != L'/' && fileName[nameStart - 1] != L':' ) {
+		nameStart--;
+	}
+	name = UnicodeStr( fileName.Mid( nameStart ) );
+	const CUnicodeString directoryName = nameStart == 0 ? CUnicodeString( L"." ) : UnicodeStr( fileName.Mid( 0, nameStart ) );
+
+	directory = ::CreateFileW( directoryName.Ptr(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+	check( directory != INVALID_HANDLE_VALUE, Err_CannotWatchFile, fileName, static_cast<int>( ::GetLastError() ) );
+	event = ::CreateEventW( nullptr, TRUE, FALSE, nullptr );
+	if( event == nullptr ) {
+		const DWORD errorCode = ::GetLastError();
+		close();
+		check( false, Err_CannotWatchFile, fileName, static_cast<int>( errorCode ) );
+	}
+	overlapped.hEvent = event;
+	buffer.IncreaseSize( notificationBufferSize );
+	try {
+		startRead();
+	} catch( CException& ) {
+		close();
+		throw;
+	}
+}
+
+CFileWatcher::~CFileWatcher()
+{
+	close();
+}
+
+void CFileWatcher::WaitForChange()
+{
+	waitForFileChange( INFINITE );
+	while( waitForFileChange( settleTime ) ) {
+	}
+}
+
+// Changes that happen between two reads are kept by the system until the next read.
+void CFileWatcher::startRead()
+{
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+	const BOOL isStarted = ::ReadDirectoryChangesW( directory, buffer.Ptr(), static_cast<DWORD>( buffer.Size() * sizeof( DWORD ) ), FALSE,
+		filter, nullptr, &overlapped, nullptr );
+	check( isStarted != FALSE, Err_CannotWatchFile, fileName, static_cast<int>( ::GetLastError() ) );
+	isReading = true;
+}
+
+// Wait for a notification about the file. Return false if the timeout expires first.
+bool CFileWatcher::waitForFileChange( DWORD timeout )
+{
+	for( ;; ) {
+		const DWORD waitResult = ::WaitForSingleObject( event, timeout );
+		if( waitResult == WAIT_TIMEOUT ) {
+			return false;
+		}
+		check( waitResult == WAIT_OBJECT_0, Err_CannotWatchFile, fileName, static_cast<int>( ::GetLastError() ) );
+		DWORD size = 0;
+		isReading = false;
+		check( ::GetOverlappedResult( directory, &overlapped, &size, FALSE ) != FALSE, Err_CannotWatchFile, fileName,
+			static_cast<int>( ::GetLastError() ) );
+		const bool isFileChanged = hasFileChange( size );
+		startRead();
+		if( isFileChanged ) {
+			return true;
+		}
+	}
+}
+
+// Zero size means that the notifications didn't fit in the buffer.
+bool CFileWatcher::hasFileChange( DWORD size ) const
+{
+	if( size == 0 ) {
+		return true;
+	}
+	const BYTE* notifications = reinterpret_cast<const BYTE*>( buffer.Ptr() );
+	for( DWORD offset = 0; ; ) {
+		const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>( notifications + offset );
+		const int nameLength = static_cast<int>( info->FileNameLength / sizeof( wchar_t ) );
+		if( ::CompareStringOrdinal( info->FileName, nameLength, name.Ptr(), name.Length(), TRUE ) == CSTR_EQUAL ) {
+			return true;
+		}
+		if( info->NextEntryOffset == 0 ) {
+			return false;
+		}
+		offset += info->NextEntryOffset;
+	}
+}
+
+// A pending read is cancelled and waited for, because the system writes to the buffer until the read completes.
+void CFileWatcher::close()
+{
+	if( isReading ) {
+		DWORD size = 0;
+		::CancelIoEx( directory, &overlapped );
+		::GetOverlappedResult( directory, &overlapped, &size, TRUE );
+		isReading = false;
+	}
+	if( event != nullptr ) {
+		::CloseHandle( event );
+		event = nullptr;
+	}
+	if( directory != INVALID_HANDLE_VALUE ) {
+		::CloseHandle( directory );
+		directory = INVALID_HANDLE_VALUE;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,42 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Watcher of the changes of a single file.
+// The directory of the file is watched, because editors often save a file by writing a temporary file and renaming it.
+// Changes of the other files in the directory are ignored.
+class CFileWatcher {
+public:
+	explicit CFileWatcher( CUnicodeView fileName );
+	~CFileWatcher();
+
+	// Wait until the file changes. Saving a file usually changes it several times in a row,
+	// so the wait ends when the file hasn't changed for a short time after a change.
+	void WaitForChange();
+
+private:
+	CUnicodeString fileName;
+	// Name of the file without the directory.
+	CUnicodeString name;
+	HANDLE directory = INVALID_HANDLE_VALUE;
+	HANDLE event = nullptr;
+	OVERLAPPED overlapped{};
+	// Change notifications. They are aligned to DWORD boundaries.
+	CArray<DWORD> buffer;
+	bool isReading = false;
+
+	void startRead();
+	bool waitForFileChange( DWORD timeout );
+	bool hasFileChange( DWORD size ) const;
+	void close();
+
+	// Copying is prohibited.
+	CFileWatcher( CFileWatcher& ) = delete;
+	void operator=( CFileWatcher& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,49 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Hash functions with a fixed definition. Their values are stored in the generated files and must never change.
+
+const uint64_t HashOffsetBasis = 0xCBF29CE484222325ULL;
+const uint64_t HashPrime = 0x100000001B3ULL;
+
+// 64-bit FNV-1a hash of a byte range.
+inline uint64_t HashBytes( const void* data, size_t size, uint64_t hash = HashOffsetBasis )
+{
+	const BYTE* bytes = static_cast<const BYTE*>( data );
+	for( size_t i = 0; i < size; i++ ) {
+		hash = ( hash ^ bytes[i] ) * HashPrime;
+	}
+	return hash;
+}
+
+inline uint64_t HashString( CUnicodePart str, uint64_t hash = HashOffsetBasis )
+{
+	return HashBytes( str.Ptr(), str.Length() * sizeof( wchar_t ), hash );
+}
+
+// Hash of a plain value's bytes.
+template <class T>
+inline uint64_t HashValue( const T& value, uint64_t hash = HashOffsetBasis )
+{
+	static_assert( std::is_trivially_copyable<T>::value, "Only plain values can be hashed by their bytes." );
+	return HashBytes( &value, sizeof( value ), hash );
+}
+
+// Avalanche finalizer. Spreads the input bits evenly over the result.
+inline uint64_t MixHash( uint64_t value )
+{
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ULL;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBULL;
+	value ^= value >> 31;
+	return value;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,215 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <LocaleCompiler.h>
+#include <MessageCompiler.h>
+#include <MessageFile.h>
+#include <MessageIdMap.h>
+#include <WorkerPool.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_EmptyLocaleManifest( L"Locale manifest doesn't contain any locales.\nManifest name: %0." );
+// Every file is parsed on a single thread, the locales are parsed in parallel instead.
+CLocaleCompiler::CLocaleCompiler( CUnicodeView manifestName, int _workerCount, const CCompilerOptions& _options ) :
+	workerCount( _workerCount ),
+	options( _options )
+{
+	options.ParseWorkerCount = 1;
+	const CUnicodeString manifest = File::ReadUnicodeText( manifestName );
+	const int length = manifest.Length();
+	for( int lineStart = 0; lineStart < length; ) {
+		int lineEnd = manifest.Find( L'\n', lineStart );
+		if( lineEnd == NotFound ) {
+			lineEnd = length;
+		}
+		const CUnicodePart line = manifest.Mid( lineStart, lineEnd - lineStart ).TrimSpaces();
+		lineStart = lineEnd + 1;
+
+		if( !line.IsEmpty() && line[0] != L';' ) {
+			addManifestLine( manifestName, line );
+		}
+	}
+	check( !locales.IsEmpty(), Err_EmptyLocaleManifest, manifestName );
+}
+
+CLocaleCompiler::~CLocaleCompiler()
+{
+}
+
+extern const CError Err_BadLocaleManifestLine( L"Locale manifest line must contain a locale name and a file name separated by '|'.\nManifest name: %0. Line: %1." );
+extern const CError Err_DuplicateLocale( L"Locale manifest contains a locale twice.\nManifest name: %0. Locale: %1." );
+void CLocaleCompiler::addManifestLine( CUnicodeView manifestName, CUnicodePart line )
+{
+	const int separator = line.Find( L'|' );
+	check( separator != NotFound, Err_BadLocaleManifestLine, manifestName, line );
+	const CUnicodeString name = UnicodeStr( line.Mid( 0, separator ).TrimSpaces() );
+	const CUnicodeString fileName = UnicodeStr( line.Mid( separator + 1 ).TrimSpaces() );
+	check( !name.IsEmpty() && !fileName.IsEmpty(), Err_BadLocaleManifestLine, manifestName, line );
+	for( const auto& locale : locales ) {
+		check( locale.Name != name, Err_DuplicateLocale, manifestName, name );
+	}
+
+	locales.IncreaseSize( locales.Size() + 1 );
+	locales.Last().Name = name;
+	inputs.IncreaseSize( inputs.Size() + 1 );
+	inputs.Last().FileName = fileName;
+}
+
+int CLocaleCompiler::Compile( CUnicodeView srcOutputName, CUnicodeView binOutputName )
+{
+	// The reference locale is parsed by the compiler that generates the outputs.
+	const auto stats = options.Stats == SF_None ? nullptr : std::make_unique<CCompileStats>( inputs[0].FileName );
+	std::unique_ptr<CMessageCompiler> compiler;
+	CWorkerPool( workerCount ).Run( inputs.Size(), [&]( int localeId ) {
+		CLocaleInput& input = inputs[localeId];
+		try {
+			if( localeId == 0 ) {
+				compiler = std::make_unique<CMessageCompiler>( input.FileName, options, nullptr, stats.get() );
+			} else {
+				input.File = std::make_unique<CMessageFile>( input.FileName, nullptr, options.ParseWorkerCount );
+				locales[localeId].File = input.File.get();
+			}
+		} catch( CException& ) {
+			input.Error = std::current_exception();
+		}
+	} );
+
+	if( compiler != nullptr ) {
+		CArray<CString> referenceKeys;
+		getKeySequence( compiler->GetInput(), referenceKeys );
+		CMap<CString, int> referencePositions;
+		referencePositions.ReserveBuffer( referenceKeys.Size() );
+		for( int i = 0; i < referenceKeys.Size(); i++ ) {
+			referencePositions.Add( referenceKeys[i], i );
+		}
+		for( int localeId = 1; localeId < inputs.Size(); localeId++ ) {
+			if( inputs[localeId].Error == nullptr ) {
+				try {
+					checkKeyParity( localeId, referenceKeys, referencePositions );
+					if( options.MaxParamCount > 0 ) {
+						checkParamParity( localeId, compiler->GetInput() );
+					}
+				} catch( CException& ) {
+					inputs[localeId].Error = std::current_exception();
+				}
+			}
+		}
+	}
+
+	int failedCount = 0;
+	for( const auto& input : inputs ) {
+		if( input.Error != nullptr ) {
+			try {
+				std::rethrow_exception( input.Error );
+			} catch( CException& e ) {
+				Log::Exception( e );
+			}
+			failedCount++;
+		}
+	}
+	if( failedCount > 0 ) {
+		return failedCount;
+	}
+
+	compiler->SetLocales( locales );
+	compiler->Compile( srcOutputName, binOutputName );
+	if( stats != nullptr ) {
+		Log::Message( UnicodeStr( stats->CreateReport( options.Stats ) ) );
+	}
+	return 0;
+}
+
+static const CStringView extraKeyTemplate = "extra %0";
+static const CStringView missingKeyTemplate = "missing %0";
+static const CStringView reorderedKeyTemplate = "out of order %0";
+extern const CError Err_LocaleKeyMismatch( L"Locale doesn't have the sections and keys of the reference locale in the same order.\n"
+	L"Locale: %0. File name: %1. Missing: %2. Extra: %3. Out of order: %4. First difference: %5." );
+// A key is out of order if it comes after a key that follows it in the reference locale.
+void CLocaleCompiler::checkKeyParity( int localeId, CArrayView<CString> referenceKeys, const CMap<CString, int>& referencePositions ) const
+{
+	CArray<CString> keys;
+	getKeySequence( *locales[localeId].File, keys );
+	CMap<CString, int> positions;
+	positions.ReserveBuffer( keys.Size() );
+	int extraCount = 0;
+	int reorderedCount = 0;
+	int lastReferencePos = NotFound;
+	CString firstDifference;
+	for( int i = 0; i < keys.Size(); i++ ) {
+		positions.Add( keys[i], i );
+		const int* referencePos = referencePositions.Get( keys[i] );
+		if( referencePos == nullptr ) {
+			extraCount++;
+			setFirstDifference( extraKeyTemplate, keys[i], firstDifference );
+		} else if( *referencePos < lastReferencePos ) {
+			reorderedCount++;
+			setFirstDifference( reorderedKeyTemplate, keys[i], firstDifference );
+		} else {
+			lastReferencePos = *referencePos;
+		}
+	}
+	int missingCount = 0;
+	for( const auto& key : referenceKeys ) {
+		if( positions.Get( key ) == nullptr ) {
+			missingCount++;
+			setFirstDifference( missingKeyTemplate, key, firstDifference );
+		}
+	}
+	check( extraCount == 0 && reorderedCount == 0 && missingCount == 0, Err_LocaleKeyMismatch, locales[localeId].Name, inputs[localeId].FileName,
+		missingCount, extraCount, reorderedCount, UnicodeStr( firstDifference ) );
+}
+
+// The keys are already known to match, so the messages are compared by position.
+void CLocaleCompiler::checkParamParity( int localeId, const CMessageFile& reference ) const
+{
+	const CMessageFile& file = *locales[localeId].File;
+	checkParamParity( localeId, reference.GetUnnamedSections(), file.GetUnnamedSections() );
+	checkParamParity( localeId, reference.GetNamedSections(), file.GetNamedSections() );
+}
+
+extern const CError Err_LocaleParamMismatch( L"Locale message doesn't have the parameters of the reference locale message.\n"
+	L"Locale: %0. File name: %1. Section: %2. Key: %3." );
+void CLocaleCompiler::checkParamParity( int localeId, CArrayView<CMessageSection> referenceSections, CArrayView<CMessageSection> sections ) const
+{
+	for( int sectionPos = 0; sectionPos < sections.Size(); sectionPos++ ) {
+		const auto referenceMasks = referenceSections[sectionPos].GetParamMasks();
+		const auto masks = sections[sectionPos].GetParamMasks();
+		for( int i = 0; i < masks.Size(); i++ ) {
+			check( masks[i] == referenceMasks[i], Err_LocaleParamMismatch, locales[localeId].Name, inputs[localeId].FileName,
+				UnicodeStr( sections[sectionPos].GetName() ), sections[sectionPos].GetKeyNames()[i] );
+		}
+	}
+}
+
+// Sections and keys of a file in the file order. They are named as in the ID map, so names of different sections don't clash.
+// Sections are included, so that the section IDs match too.
+void CLocaleCompiler::getKeySequence( const CMessageFile& file, CArray<CString>& result )
+{
+	result.Empty();
+	addKeySequence( file.GetUnnamedSections(), false, result );
+	addKeySequence( file.GetNamedSections(), true, result );
+}
+
+void CLocaleCompiler::addKeySequence( CArrayView<CMessageSection> sections, bool isNamed, CArray<CString>& result )
+{
+	for( const auto& section : sections ) {
+		result.Add( CMessageIdMap::GetMessageEntryName( section.GetName(), isNamed, CUnicodePart() ) );
+		for( const auto& key : section.GetKeyNames() ) {
+			result.Add( CMessageIdMap::GetMessageEntryName( section.GetName(), isNamed, key ) );
+		}
+	}
+}
+
+void CLocaleCompiler::setFirstDifference( CStringView differenceTemplate, const CString& key, CString& result )
+{
+	if( result.IsEmpty() ) {
+		result = differenceTemplate.SubstParam( key );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
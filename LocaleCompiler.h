@@ -0,0 +1,58 @@
+#pragma once
+#include <CompilerOptions.h>
+#include <MessageTableWriter.h>
+
+namespace Msg {
+
+class CMessageFile;
+//////////////////////////////////////////////////////////////////////////
+
+// Compiler of a reference message file and its translations into a single mapped table with shared IDs.
+// The header and the source are generated from the reference locale only. Every translation must have the sections
+// and the keys of the reference locale in the same order, so the IDs of all the locales are the same.
+// With precompiled parameters every translated message must use the parameters of its reference message.
+// All the files are parsed concurrently and the translations are checked before any output is written.
+// Manifest format: one locale per line, <locale name>|<file.msg>. Lines starting with ; are comments.
+// The first locale of the manifest is the reference locale.
+class CLocaleCompiler {
+public:
+	// Create a compiler with the given number of workers. Zero means one worker per hardware thread.
+	CLocaleCompiler( CUnicodeView manifestName, int workerCount, const CCompilerOptions& options );
+	~CLocaleCompiler();
+
+	int LocaleCount() const
+		{ return locales.Size(); }
+
+	// Parse and check all the locales and create the outputs. The errors of every locale are logged.
+	// Return the number of failed locales. Nothing is written if any locale fails.
+	int Compile( CUnicodeView srcOutputName, CUnicodeView binOutputName );
+
+private:
+	struct CLocaleInput {
+		CUnicodeString FileName;
+		std::unique_ptr<CMessageFile> File;
+		// Exception that stopped parsing or checking the locale.
+		std::exception_ptr Error;
+	};
+
+	int workerCount;
+	CCompilerOptions options;
+	CArray<CMessageLocale> locales;
+	CArray<CLocaleInput> inputs;
+
+	void addManifestLine( CUnicodeView manifestName, CUnicodePart line );
+	void checkKeyParity( int localeId, CArrayView<CString> referenceKeys, const CMap<CString, int>& referencePositions ) const;
+	void checkParamParity( int localeId, const CMessageFile& reference ) const;
+	void checkParamParity( int localeId, CArrayView<CMessageSection> referenceSections, CArrayView<CMessageSection> sections ) const;
+	static void getKeySequence( const CMessageFile& file, CArray<CString>& result );
+	static void addKeySequence( CArrayView<CMessageSection> sections, bool isNamed, CArray<CString>& result );
+	static void setFirstDifference( CStringView differenceTemplate, const CString& key, CString& result );
+
+	// Copying is prohibited.
+	CLocaleCompiler( CLocaleCompiler& ) = delete;
+	void operator=( CLocaleCompiler& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,158 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <LzCodec.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+const int minMatchLength = 4;
+const int maxMatchDistance = 0xFFFF;
+const int lzHashBits = 14;
+// Matches are not searched at the very end of the block so that the match check can read four bytes safely.
+const int lastLiteralCount = minMatchLength;
+const int lengthHalfLimit = 15;
+
+static uint32_t readUint32( const BYTE* ptr )
+{
+	uint32_t result;
+	memcpy( &result, ptr, sizeof( result ) );
+	return result;
+}
+
+static int getLzHash( uint32_t sequence )
+{
+	return static_cast<int>( ( sequence * 2654435761U ) >> ( 32 - lzHashBits ) );
+}
+
+void CLzCodec::Compress( const BYTE* data, int size, CArray<BYTE>& result )
+{
+	CArray<int> lastPositions;
+	lastPositions.IncreaseSize( 1 << lzHashBits );
+	for( int i = 0; i < lastPositions.Size(); i++ ) {
+		lastPositions[i] = NotFound;
+	}
+
+	int literalStart = 0;
+	int pos = 0;
+	const int matchLimit = size - lastLiteralCount;
+	while( pos < matchLimit ) {
+		const uint32_t sequence = readUint32( data + pos );
+		const int hash = getLzHash( sequence );
+		const int candidate = lastPositions[hash];
+		lastPositions[hash] = pos;
+
+		if( candidate == NotFound || pos - candidate > maxMatchDistance || readUint32( data + candidate ) != sequence ) {
+			pos++;
+			continue;
+		}
+
+		int matchLength = minMatchLength;
+		while( pos + matchLength < size && data[candidate + matchLength] == data[pos + matchLength] ) {
+			matchLength++;
+		}
+		writeCommand( data + literalStart, pos - literalStart, pos - candidate, matchLength, result );
+		pos += matchLength;
+		literalStart = pos;
+	}
+
+	writeCommand( data + literalStart, size - literalStart, 0, 0, result );
+}
+
+void CLzCodec::writeCommand( const BYTE* literals, int literalCount, int distance, int matchLength, CArray<BYTE>& result )
+{
+	const int literalHalf = literalCount < lengthHalfLimit ? literalCount : lengthHalfLimit;
+	const int matchExtra = matchLength > 0 ? matchLength - minMatchLength : 0;
+	const int matchHalf = matchExtra < lengthHalfLimit ? matchExtra : lengthHalfLimit;
+	result.Add( static_cast<BYTE>( ( literalHalf << 4 ) | matchHalf ) );
+	if( literalHalf == lengthHalfLimit ) {
+		writeLength( literalCount - lengthHalfLimit, result );
+	}
+
+	const int literalPos = result.Size();
+	result.IncreaseSize( literalPos + literalCount );
+	memcpy( result.Ptr() + literalPos, literals, literalCount );
+
+	if( matchLength == 0 ) {
+		// The last command.
+		return;
+	}
+	result.Add( static_cast<BYTE>( distance & 0xFF ) );
+	result.Add( static_cast<BYTE>( distance >> 8 ) );
+	if( matchHalf == lengthHalfLimit ) {
+		writeLength( matchExtra - lengthHalfLimit, result );
+	}
+}
+
+void CLzCodec::writeLength( int length, CArray<BYTE>& result )
+{
+	for( ; length >= 255; length -= 255 ) {
+		result.Add( 255 );
+	}
+	result.Add( static_cast<BYTE>( length ) );
+}
+
+bool CLzCodec::Decompress( const BYTE* data, int size, BYTE* result, int resultSize )
+{
+	const BYTE* end = data + size;
+	BYTE* out = result;
+	BYTE* const outEnd = result + resultSize;
+	while( data < end ) {
+		const int token = *data++;
+		int literalCount = token >> 4;
+		if( literalCount == lengthHalfLimit && !readLength( data, end, literalCount ) ) {
+			return false;
+		}
+		if( literalCount > end - data || literalCount > outEnd - out ) {
+			return false;
+		}
+		memcpy( out, data, literalCount );
+		out += literalCount;
+		data += literalCount;
+		if( data == end ) {
+			break;
+		}
+
+		if( end - data < 2 ) {
+			return false;
+		}
+		const int distance = data[0] | ( data[1] << 8 );
+		data += 2;
+		int matchLength = token & 0x0F;
+		if( matchLength == lengthHalfLimit && !readLength( data, end, matchLength ) ) {
+			return false;
+		}
+		matchLength += minMatchLength;
+		if( distance == 0 || distance > out - result || matchLength > outEnd - out ) {
+			return false;
+		}
+		// Matches may overlap their own output, so the copy goes byte by byte.
+		const BYTE* match = out - distance;
+		for( int i = 0; i < matchLength; i++ ) {
+			out[i] = match[i];
+		}
+		out += matchLength;
+	}
+	return out == outEnd;
+}
+
+// Add the extra length bytes to length.
+bool CLzCodec::readLength( const BYTE*& data, const BYTE* end, int& length )
+{
+	for( ;; ) {
+		if( data == end ) {
+			return false;
+		}
+		const int extra = *data++;
+		length += extra;
+		if( extra < 255 ) {
+			return true;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Byte-oriented LZ77 codec for independent blocks of data.
+// A compressed block is a sequence of commands. Each command starts with a token byte:
+// the high half is the literal count, the low half is the match length minus minimum match length.
+// A half equal to 15 is followed by extra length bytes that are added until a byte less than 255.
+// The literals follow the token, then a two byte little-endian match distance and the extra match length bytes.
+// The last command has literals only.
+class CLzCodec {
+public:
+	// Compress data and append it to result.
+	static void Compress( const BYTE* data, int size, CArray<BYTE>& result );
+	// Decompress a block into a buffer of the exact decompressed size. Return false if the block is corrupted.
+	static bool Decompress( const BYTE* data, int size, BYTE* result, int resultSize );
+
+private:
+	static void writeLength( int length, CArray<BYTE>& result );
+	static void writeCommand( const BYTE* literals, int literalCount, int distance, int matchLength, CArray<BYTE>& result );
+	static bool readLength( const BYTE*& data, const BYTE* end, int& length );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
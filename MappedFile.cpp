@@ -0,0 +1,68 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MappedFile.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_CannotMapFile( L"Failed to map a file to memory.\nFile name: %0. Error code: %1." );
+extern const CError Err_MappedFileTooLarge( L"File is too large to be mapped.\nFile name: %0." );
+CMappedFile::CMappedFile( CUnicodeView fileName )
+{
+	file = ::CreateFileW( fileName.Ptr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	check( file != INVALID_HANDLE_VALUE, Err_CannotMapFile, fileName, static_cast<int>( ::GetLastError() ) );
+
+	LARGE_INTEGER fileSize;
+	if( !::GetFileSizeEx( file, &fileSize ) ) {
+		const DWORD errorCode = ::GetLastError();
+		close();
+		check( false, Err_CannotMapFile, fileName, static_cast<int>( errorCode ) );
+	}
+	// The whole file is mapped at once, so it has to fit in the address space.
+	if( static_cast<unsigned __int64>( fileSize.QuadPart ) > SIZE_MAX ) {
+		close();
+		check( false, Err_MappedFileTooLarge, fileName );
+	}
+	size = fileSize.QuadPart;
+	// Empty files can't be mapped.
+	if( size == 0 ) {
+		return;
+	}
+
+	mapping = ::CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if( mapping != nullptr ) {
+		data = static_cast<const BYTE*>( ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+	}
+	if( data == nullptr ) {
+		const DWORD errorCode = ::GetLastError();
+		close();
+		check( false, Err_CannotMapFile, fileName, static_cast<int>( errorCode ) );
+	}
+}
+
+CMappedFile::~CMappedFile()
+{
+	close();
+}
+
+void CMappedFile::close()
+{
+	if( data != nullptr ) {
+		::UnmapViewOfFile( data );
+		data = nullptr;
+	}
+	if( mapping != nullptr ) {
+		::CloseHandle( mapping );
+		mapping = nullptr;
+	}
+	if( file != INVALID_HANDLE_VALUE ) {
+		::CloseHandle( file );
+		file = INVALID_HANDLE_VALUE;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Read-only memory mapping of a whole file.
+// The mapping starts on a page boundary, so it satisfies the alignment requirements of the message table.
+class CMappedFile {
+public:
+	explicit CMappedFile( CUnicodeView fileName );
+	~CMappedFile();
+
+	const BYTE* Data() const
+		{ return data; }
+	__int64 Size() const
+		{ return size; }
+
+private:
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+	const BYTE* data = nullptr;
+	__int64 size = 0;
+
+	void close();
+
+	// Copying is prohibited.
+	CMappedFile( CMappedFile& ) = delete;
+	void operator=( CMappedFile& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -2,57 +2,412 @@
 #pragma hdrstop
 
 #include <MessageCompiler.h>
+#include <MessageTableWriter.h>
+#include <MessageDeltaWriter.h>
+#include <MessageParams.h>
+#include <BuildCache.h>
+#include <EmbeddedTableWriter.h>
+#include <MessageReader.h>
+#include <CompileStats.h>
+#include <CodeEmitter.h>
+#include <WorkerPool.h>
+#include <MappedFile.h>
+#include <TextFileReader.h>
+#include <FileWatcher.h>
 
 namespace Msg {
 
 CError Err_MessageFileNotFound{ L"Message file not found!\r\nFile name: %0" };
 //////////////////////////////////////////////////////////////////////////
 
-CMessageCompiler::CMessageCompiler( CUnicodeView fileName ) :
-	input( fileName )
+CMessageCompiler::CMessageCompiler( CUnicodeView fileName, const CCompilerOptions& _options, CBuildCache* _cache, CCompileStats* _stats ) :
+	streamingWriter( _options.Streaming ? std::make_unique<CStreamingTableWriter>( _options ) : nullptr ),
+	input( fileName, _stats, _options.ParseWorkerCount, getValueHandler(), _options.Watch ),
+	options( _options ),
+	idMapName( getIdMapName( fileName ) ),
+	cache( _cache ),
+	stats( _stats )
 {
 	check( FileSystem::FileExists( fileName ), Err_MessageFileNotFound, fileName );
+	initialize();
+}
+
+CMessageCompiler::CMessageCompiler( CUnicodeView fileName, CUnicodeString text, const CCompilerOptions& _options, CBuildCache* _cache,
+		CCompileStats* _stats ) :
+	input( fileName, move( text ), _stats, _options.ParseWorkerCount, _options.Watch ),
+	options( _options ),
+	idMapName( getIdMapName( fileName ) ),
+	cache( _cache ),
+	stats( _stats )
+{
+	assert( !options.Streaming );
+	initialize();
+}
+
+void CMessageCompiler::initialize()
+{
+	if( !options.ProfileName.IsEmpty() ) {
+		profile = std::make_unique<CAccessProfile>( options.ProfileName );
+	}
+	updateIds();
+}
+
+// The map is loaded anew, so the IDs of an updated file are the same as in a new compilation.
+void CMessageCompiler::updateIds()
+{
+	CPhaseTimer timer( stats, CP_Ids );
+	idMap.Empty();
+	if( options.StableIds ) {
+		idMap.Load( idMapName );
+	}
+	idMap.Update( input, options.CompactIds, ids );
+	if( options.MaxParamCount > 0 ) {
+		checkParams();
+	}
+	if( stats != nullptr ) {
+		const int sectionCount = input.GetUnnamedSections().Size() + input.GetNamedSections().Size();
+		stats->SetTotals( input.MessageCount(), sectionCount, input.EscapeCount() );
+	}
 }
 
 void CMessageCompiler::Compile( CUnicodeView srcOutputName, CUnicodeView binOutputName ) const
 {
-	createIncOutput( srcOutputName );
-	createSrcOutput( srcOutputName );
-	createBinOutput( binOutputName );
+	if( options.StableIds ) {
+		writeTextOutput( BO_IdMap, idMapName, idMap.CreateFileText() );
+	}
+
+	// The outputs are independent, so they are created concurrently. The first error is thrown after all of them are done.
+	// Every exception is caught, because an exception that leaves a worker thread terminates the process.
+	CArray<std::function<void()>> tasks;
+	tasks.Add( [&]() { CreateBinary( binOutputName ); } );
+	tasks.Add( [&]() { CreateHeader( srcOutputName ); } );
+	if( HasSrcOutput( options ) ) {
+		tasks.Add( [&]() { CreateSource( srcOutputName ); } );
+	}
+	if( options.ShardMode != SM_None ) {
+		tasks.Add( [&]() { CreateShards( srcOutputName ); } );
+	}
+	CArray<std::exception_ptr> errors;
+	errors.IncreaseSize( tasks.Size() );
+	CWorkerPool( tasks.Size() ).Run( tasks.Size(), [&]( int taskIndex ) {
+		try {
+			tasks[taskIndex]();
+		} catch( ... ) {
+			errors[taskIndex] = std::current_exception();
+		}
+	} );
+	for( const auto& error : errors ) {
+		if( error != nullptr ) {
+			std::rethrow_exception( error );
+		}
+	}
+
+	if( options.Verify ) {
+		CPhaseTimer timer( stats, CP_Verify );
+		verifyBinOutput( binOutputName );
+	}
+}
+
+static const CUnicodeView cacheFileSuffix = L".cache";
+void CMessageCompiler::CompileFile( CUnicodeView fileName, CUnicodeView srcOutputName, CUnicodeView binOutputName, const CCompilerOptions& options )
+{
+	const auto stats = options.Stats == SF_None ? nullptr : std::make_unique<CCompileStats>( fileName );
+	if( !options.Incremental ) {
+		CMessageCompiler( fileName, options, nullptr, stats.get() ).Compile( srcOutputName, binOutputName );
+		reportStats( stats.get(), options.Stats );
+		return;
+	}
+
+	CBuildCache cache( getCacheName( binOutputName ) );
+	CArray<CUnicodeString> outputNames;
+	outputNames.Add( getOutputName( srcOutputName, L"h" ) );
+	if( HasSrcOutput( options ) ) {
+		outputNames.Add( getOutputName( srcOutputName, L"cpp" ) );
+	}
+	outputNames.Add( UnicodeStr( binOutputName ) );
+	if( options.StableIds ) {
+		outputNames.Add( getIdMapName( fileName ) );
+	}
+	// The text that is hashed is the text that is parsed, so the file is read once.
+	// A streamed file is never held in memory, so it is hashed a part at a time and read again by the parser.
+	check( FileSystem::FileExists( fileName ), Err_MessageFileNotFound, fileName );
+	CUnicodeString text;
+	uint64_t fileHash = 0;
+	if( options.Streaming ) {
+		fileHash = getFileHash( fileName );
+	} else {
+		CPhaseTimer timer( stats.get(), CP_Read );
+		text = File::ReadUnicodeText( fileName );
+		fileHash = HashString( text );
+	}
+	if( cache.IsUpToDate( getInputHash( fileHash, fileName, srcOutputName, options ), outputNames ) ) {
+		return;
+	}
+
+	const auto compiler = options.Streaming ? std::make_unique<CMessageCompiler>( fileName, options, &cache, stats.get() )
+		: std::make_unique<CMessageCompiler>( fileName, move( text ), options, &cache, stats.get() );
+	compiler->Compile( srcOutputName, binOutputName );
+	// The ID map is an input too. Its hash is taken after the compilation has updated it.
+	cache.SetInputHash( getInputHash( fileHash, fileName, srcOutputName, options ) );
+	cache.Save();
+	reportStats( stats.get(), options.Stats );
+}
+
+// A failed update keeps the key changes pending, so that the next update assigns the IDs and the next compilation creates every output.
+void CMessageCompiler::Update()
+{
+	assert( options.Watch );
+	input.Update( stats, options.ParseWorkerCount );
+	hasKeyChanges = hasKeyChanges || input.HaveKeysChanged();
+	if( hasKeyChanges ) {
+		updateIds();
+	} else if( options.MaxParamCount > 0 ) {
+		checkParams();
+	}
+}
+
+void CMessageCompiler::CompileChanges( CUnicodeView srcOutputName, CUnicodeView binOutputName )
+{
+	if( hasKeyChanges ) {
+		watchImage.Empty();
+		Compile( srcOutputName, binOutputName );
+	} else {
+		updateWatchBinary( binOutputName );
+		if( options.EmbedMessages ) {
+			CreateSource( srcOutputName );
+		}
+	}
+	hasKeyChanges = false;
+}
+
+static const int minWatchBlobGrowth = 1 << 16;
+// Changed values are patched into the image of the last compilation, so the tables are not built again for every change.
+// Only the sections that the last update parsed are compared with the image.
+// The image is created anew when the replaced values would make the blob more than twice as large as a new one.
+// An image that fails to be written is dropped, because the next update compares only its own changes with it.
+void CMessageCompiler::updateWatchBinary( CUnicodeView name )
+{
+	const bool isPatchable = CMessageTableWriter::IsPatchable( options ) && streamingWriter == nullptr && locales.IsEmpty()
+		&& options.DeltaBaseName.IsEmpty();
+	if( !isPatchable ) {
+		CreateBinary( name );
+		return;
+	}
+
+	CPhaseTimer timer( stats, CP_Binary );
+	if( stats != nullptr ) {
+		stats->Phase( CP_Binary ).BytesIn = input.MessageBinarySize();
+	}
+	CMessageTableWriter writer( input, ids, options );
+	writer.SetProfile( profile.get() );
+	try {
+		int patchedCount = 0;
+		if( watchImage.IsEmpty() || !writer.PatchImage( maxWatchBlobSize, watchImage, watchBlobHash, patchedCount ) ) {
+			CMessageTableStats tableStats;
+			watchImage.Empty();
+			writer.CreateImage( watchImage, tableStats );
+			maxWatchBlobSize = 2 * tableStats.BlobSize + minWatchBlobGrowth;
+			const auto& header = *reinterpret_cast<const CMessageTableHeader*>( watchImage.Ptr() );
+			watchBlobHash = HashBytes( watchImage.Ptr() + header.BlobOffset, static_cast<size_t>( header.BlobSize ) );
+		} else if( patchedCount == 0 ) {
+			return;
+		}
+		addOutputSize( CP_Binary, watchImage.Size() );
+		writeBinaryImage( name, watchImage );
+	} catch( ... ) {
+		watchImage.Empty();
+		throw;
+	}
+}
+
+static const CStringView watchReportTemplate = "Compiled %0 in %1 ms. Parsed parts: %2 of %3.";
+// The file is watched before the first compilation, so that the changes made during the compilation are not missed.
+// The build cache keeps the outputs that haven't changed untouched. It is saved without the input hash,
+// because the hash would take reading the whole file. The next incremental compilation then compiles the file once.
+void CMessageCompiler::WatchFile( CUnicodeView fileName, CUnicodeView srcOutputName, CUnicodeView binOutputName, const CCompilerOptions& options )
+{
+	assert( options.Watch );
+	CFileWatcher watcher( fileName );
+	CBuildCache cache( getCacheName( binOutputName ) );
+	std::unique_ptr<CMessageCompiler> compiler;
+	for( ;; ) {
+		const auto start = std::chrono::steady_clock::now();
+		try {
+			if( compiler == nullptr ) {
+				compiler = std::make_unique<CMessageCompiler>( fileName, options, &cache );
+			} else {
+				compiler->Update();
+			}
+			compiler->CompileChanges( srcOutputName, binOutputName );
+			cache.SetInputHash( 0 );
+			cache.Save();
+			const auto time = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+			const CMessageFile& input = compiler->GetInput();
+			Log::Message( UnicodeStr( watchReportTemplate.SubstParam( Str( fileName ), static_cast<int>( time.count() ),
+				input.ParsedPartCount(), input.PartCount() ) ) );
+		} catch( CException& e ) {
+			Log::Exception( e );
+		}
+		watcher.WaitForChange();
+	}
+}
+
+// The streaming writer encodes the values as they are parsed.
+TMessageValueHandler CMessageCompiler::getValueHandler() const
+{
+	if( streamingWriter == nullptr ) {
+		return TMessageValueHandler();
+	}
+	CStreamingTableWriter* writer = streamingWriter.get();
+	return [writer]( bool isNamedSection, CUnicodePart value ) { writer->AddMessage( isNamedSection, value ); };
+}
+
+void CMessageCompiler::reportStats( const CCompileStats* stats, TStatsFormat format )
+{
+	if( stats != nullptr ) {
+		Log::Message( UnicodeStr( stats->CreateReport( format ) ) );
+	}
+}
+
+static const int inputHashReadSize = 1 << 20;
+// Everything that affects the outputs: the message file, the ID map, the access profile, the source output name used in the include directive
+// and the options.
+// The hash of the message file text is given.
+uint64_t CMessageCompiler::getInputHash( uint64_t fileHash, CUnicodeView fileName, CUnicodeView srcOutputName, const CCompilerOptions& options )
+{
+	uint64_t hash = HashString( srcOutputName, fileHash );
+	const CUnicodeString idMapName = getIdMapName( fileName );
+	if( options.StableIds && FileSystem::FileExists( idMapName ) ) {
+		hash = HashString( File::ReadUnicodeText( idMapName ), hash );
+	}
+	if( !options.ProfileName.IsEmpty() ) {
+		hash = HashString( File::ReadUnicodeText( options.ProfileName ), hash );
+	}
+	return HashValue( GetOptionsHash( options ), hash );
+}
+
+// The message file is hashed a part at a time, so a large file is never held in memory.
+// The hash is the same as the hash of the whole text.
+uint64_t CMessageCompiler::getFileHash( CUnicodeView fileName )
+{
+	uint64_t hash = HashOffsetBasis;
+	CTextFileReader reader( fileName );
+	CUnicodeString text;
+	for( bool hasMore = true; hasMore; ) {
+		hasMore = reader.Read( inputHashReadSize, text );
+		hash = HashString( text, hash );
+		text.Empty();
+	}
+	return hash;
+}
+
+// The source file holds the extern ID definitions and the embedded messages.
+bool CMessageCompiler::HasSrcOutput( const CCompilerOptions& options )
+{
+	return options.IdForm == IF_Extern || options.EmbedMessages;
+}
+
+CUnicodeString CMessageCompiler::getCacheName( CUnicodeView binOutputName )
+{
+	CUnicodeString result( binOutputName );
+	result += cacheFileSuffix;
+	return result;
+}
+
+CUnicodeString CMessageCompiler::getIdMapName( CUnicodeView fileName )
+{
+	return getOutputName( fileName, L"ids" );
+}
+
+CUnicodeString CMessageCompiler::getOutputName( CUnicodeView name, CUnicodeView ext )
+{
+	CUnicodeString result( name );
+	FileSystem::ReplaceExt( result, ext );
+	return result;
+}
+
+void CMessageCompiler::addOutputSize( TCompilePhase phase, int64_t size ) const
+{
+	if( stats != nullptr ) {
+		stats->Phase( phase ).BytesOut += size;
+	}
+}
+
+// Without a cache every output is written. The text is written with a single call.
+void CMessageCompiler::writeTextOutput( TBuildOutput output, CUnicodeView name, CStringPart text ) const
+{
+	if( cache == nullptr || cache->UpdateOutput( output, name, HashBytes( text.Ptr(), text.Length() ) ) ) {
+		CFileWriter outputFile( name, FCM_CreateAlways );
+		outputFile.Write( text.Ptr(), text.Length() );
+	}
 }
 
 static const CStringView fileGeneralPrefix = "// Automatically generated message ID definitions.\r\nnamespace Msg {\r\n\r\n";
 static const CStringView fileGeneralSuffix = "//////////////////////////////////////////////////////////////////////////\r\n\r\n}	// namespace Msg.\r\n";
-void CMessageCompiler::createIncOutput( CUnicodeView name ) const
+static const CStringView constexprDefTemplate = "inline constexpr int %0 = %1;\r\n";
+void CMessageCompiler::CreateHeader( CUnicodeView name ) const
 {
-	CString incOutput = Str( fileGeneralPrefix );
-	fillSectionDeclaration( incOutput );
-	fillIncOutput( incOutput );
-	incOutput += fileGeneralSuffix;
+	CPhaseTimer timer( stats, CP_Header );
+	CString embedDeclaration;
+	if( options.EmbedMessages ) {
+		CEmbeddedTableWriter( input, ids, options ).FillDeclaration( CEmbeddedTableWriter::GetTableName( name ), embedDeclaration );
+	}
 
-	CUnicodeString headerName( name );
-	FileSystem::ReplaceExt( headerName, L"h" );
-	File::WriteText( headerName, incOutput );
+	if( options.IdForm == IF_Enum ) {
+		checkEnumNames();
+	}
+	// Shards hold the message IDs, the main header keeps the section IDs.
+	const bool isSharded = options.ShardMode != SM_None;
+	CCodeEmitter incOutput;
+	incOutput.Emit( [&]( CCodeEmitter& result ) {
+		result.Append( fileGeneralPrefix );
+		switch( options.IdForm ) {
+			case IF_Extern:
+				fillSectionDeclaration( result );
+				if( !isSharded ) {
+					fillIncOutput( result );
+				}
+				break;
+			case IF_Constexpr:
+				fillSectionDefinition( constexprDefTemplate, result );
+				if( !isSharded ) {
+					fillSrcOutput( constexprDefTemplate, result );
+				}
+				break;
+			case IF_Enum:
+				fillSectionEnum( result );
+				if( !isSharded ) {
+					fillEnumIncOutput( result );
+				}
+				break;
+			default:
+				assert( false );
+		}
+		result.Append( embedDeclaration );
+		result.Append( fileGeneralSuffix );
+	} );
+	addOutputSize( CP_Header, incOutput.Text().Length() );
+	writeTextOutput( BO_Header, getOutputName( name, L"h" ), incOutput.Text() );
 }
 
 static const CStringView srcDeclTemplate = "extern const int %0;\r\n";
 static const CStringView sectionNameSuffix = "Section";
 static const CStringView sectionDeclarationSuffix = "//////////////////////////////////////////////////////////////////////////\r\n\r\n";
-void CMessageCompiler::fillSectionDeclaration( CString& result ) const
+void CMessageCompiler::fillSectionDeclaration( CCodeEmitter& result ) const
 {
 	for( const auto& section : input.GetUnnamedSections() ) {
 		if( !section.GetName().IsEmpty() ) {
-			result += srcDeclTemplate.SubstParam( section.GetName() + sectionNameSuffix );
+			result.AppendTemplate( srcDeclTemplate, CEmitterArg( section.GetName(), sectionNameSuffix ) );
 		}
 	}
 	for( const auto& section : input.GetNamedSections() ) {
-		result += srcDeclTemplate.SubstParam( section.GetName() + sectionNameSuffix );
+		result.AppendTemplate( srcDeclTemplate, CEmitterArg( section.GetName(), sectionNameSuffix ) );
 	}
-	result += sectionDeclarationSuffix;
+	result.Append( sectionDeclarationSuffix );
 }
 
 // Fill the key data in the header.
-void CMessageCompiler::fillIncOutput( CString& result ) const
+void CMessageCompiler::fillIncOutput( CCodeEmitter& result ) const
 {
 	fillIncOutput( input.GetUnnamedSections(), result );
 	fillIncOutput( input.GetNamedSections(), result );
@@ -60,89 +415,407 @@ void CMessageCompiler::fillIncOutput( CString& result ) const
 
 static const CStringView sectionPrefixTemplate = "namespace %0 {\r\n\r\n";
 static const CStringView sectionSuffixTemplate = "\r\n}	// namespace %0.\r\n\r\n";
-void CMessageCompiler::fillIncOutput( CArrayView<CMessageSection> sections, CString& result )
+void CMessageCompiler::fillIncOutput( CArrayView<CMessageSection> sections, CCodeEmitter& result )
 {
 	for( const auto& section : sections ) {
 		const auto sectionName = section.GetName();
 				
 		if( !sectionName.IsEmpty() ) {
-			result += sectionPrefixTemplate.SubstParam( sectionName );
+			result.AppendTemplate( sectionPrefixTemplate, sectionName );
 		}
 
 		for( const auto& key : section.GetKeyNames() ) {
-			result += srcDeclTemplate.SubstParam( key );
+			result.AppendTemplate( srcDeclTemplate, key );
 		}
 
 		if( !sectionName.IsEmpty() ) {
-			result += sectionSuffixTemplate.SubstParam( sectionName );
+			result.AppendTemplate( sectionSuffixTemplate, sectionName );
 		}
 	}
 }
 
+static const CStringView srcDefTemplate = "extern const int %0 = %1;\r\n";
 static const CStringView srcPrefixTemplate = "#include <common.h>\r\n#pragma hdrstop\r\n\r\n#include <%0.h>\r\n\r\n";
-void CMessageCompiler::createSrcOutput( CUnicodeView name ) const
+void CMessageCompiler::CreateSource( CUnicodeView name ) const
 {
-	const CUnicodeString nameExt = FileSystem::GetNameExt( name );
-	CString srcOutput = srcPrefixTemplate.SubstParam( nameExt ) + fileGeneralPrefix;
-	fillSectionDefinition( srcOutput );
-	fillSrcOutput( srcOutput );
-	srcOutput += fileGeneralSuffix;
+	CPhaseTimer timer( stats, CP_Source );
+	const CString srcPrefix = srcPrefixTemplate.SubstParam( FileSystem::GetNameExt( name ) );
+	CString embedDefinition;
+	if( options.EmbedMessages ) {
+		CEmbeddedTableWriter( input, ids, options ).FillDefinition( CEmbeddedTableWriter::GetTableName( name ), embedDefinition );
+	}
 
-	CUnicodeString nameCopy( name );
-	FileSystem::ReplaceExt( nameCopy, L"cpp" );
-	File::WriteText( nameCopy, srcOutput );
+	CCodeEmitter srcOutput;
+	srcOutput.Emit( [&]( CCodeEmitter& result ) {
+		result.Append( srcPrefix );
+		result.Append( fileGeneralPrefix );
+		if( options.IdForm == IF_Extern ) {
+			fillSectionDefinition( srcDefTemplate, result );
+			if( options.ShardMode == SM_None ) {
+				fillSrcOutput( srcDefTemplate, result );
+			}
+		}
+		result.Append( embedDefinition );
+		result.Append( fileGeneralSuffix );
+	} );
+	addOutputSize( CP_Source, srcOutput.Text().Length() );
+	writeTextOutput( BO_Source, getOutputName( name, L"cpp" ), srcOutput.Text() );
 }
 
-static const CStringView srcDefTemplate = "extern const int %0 = %1;\r\n";
-void CMessageCompiler::fillSectionDefinition( CString& result ) const
+void CMessageCompiler::fillSectionDefinition( CStringView defTemplate, CCodeEmitter& result ) const
 {
-	int sectionId = 0;
+	int sectionPos = 0;
 	for( const auto& section : input.GetUnnamedSections() ) {
 		if( !section.GetName().IsEmpty() ) {
-			result += srcDefTemplate.SubstParam( section.GetName() + sectionNameSuffix, sectionId );
-			sectionId++;
+			result.AppendTemplate( defTemplate, CEmitterArg( section.GetName(), sectionNameSuffix ), ids.SectionIds[sectionPos] );
+			sectionPos++;
 		}
 	}
 	for( const auto& section : input.GetNamedSections() ) {
-		result += srcDefTemplate.SubstParam( section.GetName() + sectionNameSuffix, sectionId );
-		sectionId++;
+		result.AppendTemplate( defTemplate, CEmitterArg( section.GetName(), sectionNameSuffix ), ids.SectionIds[sectionPos] );
+		sectionPos++;
 	}
-	result += sectionDeclarationSuffix;
+	result.Append( sectionDeclarationSuffix );
 }
 
-// Fill the key data in the source file and report that the result contains non-trivial data.
-void CMessageCompiler::fillSrcOutput( CString& result ) const
+// Fill the key definitions with the given template. The template takes the key name and the ID.
+void CMessageCompiler::fillSrcOutput( CStringView defTemplate, CCodeEmitter& result ) const
 {
-	int totalKeyCount = 0;
-	fillSrcOutput( input.GetUnnamedSections(), result, totalKeyCount );
-	fillSrcOutput( input.GetNamedSections(), result, totalKeyCount );
+	int messagePos = 0;
+	fillSrcOutput( input.GetUnnamedSections(), ids.MessageIds, defTemplate, result, messagePos );
+	fillSrcOutput( input.GetNamedSections(), ids.MessageIds, defTemplate, result, messagePos );
 }
 
-void CMessageCompiler::fillSrcOutput( CArrayView<CMessageSection> sections, CString& result, int& totalKeyCount )
+void CMessageCompiler::fillSrcOutput( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CStringView defTemplate, CCodeEmitter& result, int& messagePos )
 {
 	for( const auto& section : sections ) {
 		const auto sectionName = section.GetName();
 
 		if( !sectionName.IsEmpty() ) {
-			result += sectionPrefixTemplate.SubstParam( sectionName );
+			result.AppendTemplate( sectionPrefixTemplate, sectionName );
 		}
 
 		for( const auto& key : section.GetKeyNames() ) {
-			result += srcDefTemplate.SubstParam( key, totalKeyCount );
-			totalKeyCount++;
+			result.AppendTemplate( defTemplate, key, messageIds[messagePos] );
+			messagePos++;
 		}
 
 		if( !sectionName.IsEmpty() ) {
-			result += sectionSuffixTemplate.SubstParam( sectionName );
+			result.AppendTemplate( sectionSuffixTemplate, sectionName );
+		}
+	}
+}
+
+static const CStringView sectionEnumName = "TSectionId";
+static const CStringView globalEnumName = "TGlobalMessageId";
+static const CStringView enumPrefixTemplate = "enum class %0 : int {\r\n";
+static const CStringView enumValueTemplate = "\t%0 = %1,\r\n";
+static const CStringView enumSuffix = "};\r\n\r\n";
+extern const CError Err_EnumNameConflict( L"Sections [%1] and {%1} would both define the enumeration %1. Rename one of them or use another ID form.\nFile name: %0." );
+// Sections of both kinds are named by their plain names, so a name can't be shared between the kinds.
+// The names of each kind are unique, so a repeated name belongs to a named section that has the name of an unnamed one.
+void CMessageCompiler::checkEnumNames() const
+{
+	CHashTable<CString> enumNames;
+	for( const auto& section : input.GetUnnamedSections() ) {
+		enumNames.Set( Str( section.GetName() ) );
+	}
+	for( const auto& section : input.GetNamedSections() ) {
+		check( enumNames.Set( Str( section.GetName() ) ), Err_EnumNameConflict, input.GetFileName(), section.GetName() );
+	}
+}
+
+// Section IDs are values of a single enumeration.
+void CMessageCompiler::fillSectionEnum( CCodeEmitter& result ) const
+{
+	result.AppendTemplate( enumPrefixTemplate, sectionEnumName );
+	int sectionPos = 0;
+	for( const auto& section : input.GetUnnamedSections() ) {
+		if( !section.GetName().IsEmpty() ) {
+			result.AppendTemplate( enumValueTemplate, section.GetName(), ids.SectionIds[sectionPos] );
+			sectionPos++;
+		}
+	}
+	for( const auto& section : input.GetNamedSections() ) {
+		result.AppendTemplate( enumValueTemplate, section.GetName(), ids.SectionIds[sectionPos] );
+		sectionPos++;
+	}
+	result.Append( enumSuffix );
+	result.Append( sectionDeclarationSuffix );
+}
+
+// Each section gets its own enumeration named after the section, so the keys keep their qualified names.
+void CMessageCompiler::fillEnumIncOutput( CCodeEmitter& result ) const
+{
+	int messagePos = 0;
+	fillEnumIncOutput( input.GetUnnamedSections(), ids.MessageIds, result, messagePos );
+	fillEnumIncOutput( input.GetNamedSections(), ids.MessageIds, result, messagePos );
+}
+
+void CMessageCompiler::fillEnumIncOutput( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CCodeEmitter& result, int& messagePos )
+{
+	for( const auto& section : sections ) {
+		const auto sectionName = section.GetName();
+		result.AppendTemplate( enumPrefixTemplate, sectionName.IsEmpty() ? globalEnumName : sectionName );
+		for( const auto& key : section.GetKeyNames() ) {
+			result.AppendTemplate( enumValueTemplate, key, messageIds[messagePos] );
+			messagePos++;
+		}
+		result.Append( enumSuffix );
+	}
+}
+
+void CMessageCompiler::CreateShards( CUnicodeView name ) const
+{
+	CPhaseTimer timer( stats, CP_Shards );
+	CArray<CShard> shards;
+	int messagePos = 0;
+	splitShards( input.GetUnnamedSections(), false, messagePos, shards );
+	splitShards( input.GetNamedSections(), true, messagePos, shards );
+	checkShardNames( name, shards );
+	for( const auto& shard : shards ) {
+		createShard( name, shard );
+	}
+}
+
+static const CStringView globalShardName = "Global";
+static const CStringView sectionShardTemplate = "Section_%0";
+static const CStringView namedSectionShardTemplate = "Named_%0";
+static const CStringView keyCountShardTemplate = "Part%0";
+// Shards don't cross the border between the unnamed and the named sections, so the sections of a shard are in a single array.
+// Section shards of the two kinds have different prefixes, so [X], {X} and the global section get different names.
+void CMessageCompiler::splitShards( CArrayView<CMessageSection> sections, bool isNamed, int& messagePos, CArray<CShard>& shards ) const
+{
+	int shardStart = 0;
+	int shardKeyCount = 0;
+	int shardMessagePos = messagePos;
+	for( int i = 0; i < sections.Size(); i++ ) {
+		const int keyCount = sections[i].GetKeyNames().Size();
+		messagePos += keyCount;
+		shardKeyCount += keyCount;
+		if( options.ShardMode == SM_Section || shardKeyCount >= options.ShardKeyCount || i + 1 == sections.Size() ) {
+			shards.IncreaseSize( shards.Size() + 1 );
+			CShard& shard = shards.Last();
+			if( options.ShardMode == SM_KeyCount ) {
+				shard.Name = keyCountShardTemplate.SubstParam( shards.Size() - 1 );
+			} else {
+				const CStringView sectionName = sections[i].GetName();
+				if( sectionName.IsEmpty() ) {
+					shard.Name = Str( globalShardName );
+				} else {
+					shard.Name = ( isNamed ? namedSectionShardTemplate : sectionShardTemplate ).SubstParam( sectionName );
+				}
+			}
+			shard.Sections = CArrayView<CMessageSection>( sections.Ptr() + shardStart, i + 1 - shardStart );
+			shard.FirstMessagePos = shardMessagePos;
+			shardStart = i + 1;
+			shardKeyCount = 0;
+			shardMessagePos = messagePos;
+		}
+	}
+}
+
+static const CStringView shardSrcPrefixTemplate = "#include <common.h>\r\n#pragma hdrstop\r\n\r\n#include <%0>\r\n\r\n";
+void CMessageCompiler::createShard( CUnicodeView name, const CShard& shard ) const
+{
+	const CUnicodeString incName = getShardOutputName( name, shard.Name, L"h" );
+	CCodeEmitter incOutput;
+	incOutput.Emit( [&]( CCodeEmitter& result ) {
+		result.Append( fileGeneralPrefix );
+		int messagePos = shard.FirstMessagePos;
+		switch( options.IdForm ) {
+			case IF_Extern:
+				fillIncOutput( shard.Sections, result );
+				break;
+			case IF_Constexpr:
+				fillSrcOutput( shard.Sections, ids.MessageIds, constexprDefTemplate, result, messagePos );
+				break;
+			case IF_Enum:
+				fillEnumIncOutput( shard.Sections, ids.MessageIds, result, messagePos );
+				break;
+			default:
+				assert( false );
 		}
+		result.Append( fileGeneralSuffix );
+	} );
+	addOutputSize( CP_Shards, incOutput.Text().Length() );
+	writeShardOutput( incName, incOutput.Text() );
+	if( options.IdForm != IF_Extern ) {
+		return;
+	}
+
+	const CString srcPrefix = shardSrcPrefixTemplate.SubstParam( FileSystem::GetNameExt( incName ) );
+	CCodeEmitter srcOutput;
+	srcOutput.Emit( [&]( CCodeEmitter& result ) {
+		result.Append( srcPrefix );
+		result.Append( fileGeneralPrefix );
+		int messagePos = shard.FirstMessagePos;
+		fillSrcOutput( shard.Sections, ids.MessageIds, srcDefTemplate, result, messagePos );
+		result.Append( fileGeneralSuffix );
+	} );
+	addOutputSize( CP_Shards, srcOutput.Text().Length() );
+	writeShardOutput( getShardOutputName( name, shard.Name, L"cpp" ), srcOutput.Text() );
+}
+
+extern const CError Err_ShardNameConflict( L"Shards %1 and %2 would be written to the same files on a case-insensitive file system.\nSource output name: %0." );
+// Section names differ in case only if they are different sections, so such shards would overwrite each other's files.
+void CMessageCompiler::checkShardNames( CUnicodeView name, CArrayView<CShard> shards )
+{
+	CMap<CString, int> shardPositions;
+	for( int i = 0; i < shards.Size(); i++ ) {
+		const CString foldedName = getFoldedName( shards[i].Name );
+		const int* position = shardPositions.Get( foldedName );
+		if( position != nullptr ) {
+			check( false, Err_ShardNameConflict, name, shards[*position].Name, shards[i].Name );
+		}
+		shardPositions.Add( foldedName, i );
+	}
+}
+
+// Identifiers are ASCII, so only the ASCII letters are folded.
+CString CMessageCompiler::getFoldedName( CStringPart name )
+{
+	CString result;
+	for( int i = 0; i < name.Length(); i++ ) {
+		const char ch = name[i];
+		result += ( ch >= 'A' && ch <= 'Z' ) ? static_cast<char>( ch - 'A' + 'a' ) : ch;
+	}
+	return result;
+}
+
+// The shard name is appended to the source output name: Messages_Section_Errors.h for the section Errors of Messages.
+CUnicodeString CMessageCompiler::getShardOutputName( CUnicodeView name, CStringPart shardName, CUnicodeView ext )
+{
+	const CUnicodeString outputName = getOutputName( name, ext );
+	const int extPos = outputName.Length() - ext.Length() - 1;
+	CUnicodeString result( outputName.Mid( 0, extPos ) );
+	result += L'_';
+	result += UnicodeStr( shardName );
+	result += outputName.Mid( extPos );
+	return result;
+}
+
+// Shards are tracked by the build cache like the other outputs, so a deleted or edited shard is written again.
+void CMessageCompiler::writeShardOutput( CUnicodeView name, CStringPart text ) const
+{
+	if( cache == nullptr ) {
+		writeChangedOutput( name, text );
+	} else if( cache->UpdateShardOutput( name, HashBytes( text.Ptr(), text.Length() ) ) ) {
+		CFileWriter outputFile( name, FCM_CreateAlways );
+		outputFile.Write( text.Ptr(), text.Length() );
+	}
+}
+
+// Without a build cache the existing files are compared with the new contents.
+void CMessageCompiler::writeChangedOutput( CUnicodeView name, CStringPart text )
+{
+	if( FileSystem::FileExists( name ) ) {
+		const CMappedFile oldFile( name );
+		if( oldFile.Size() == text.Length() && ( text.IsEmpty() || memcmp( oldFile.Data(), text.Ptr(), text.Length() ) == 0 ) ) {
+			return;
+		}
+	}
+	CFileWriter outputFile( name, FCM_CreateAlways );
+	outputFile.Write( text.Ptr(), text.Length() );
+}
+
+static const CUnicodeView mergeReportTemplate = L"%0: string merging saved %1 of %2 blob bytes.";
+static const CUnicodeView compressionReportTemplate = L"%0: blob compressed from %1 to %2 bytes.";
+void CMessageCompiler::CreateBinary( CUnicodeView name ) const
+{
+	CPhaseTimer timer( stats, CP_Binary );
+	if( stats != nullptr ) {
+		stats->Phase( CP_Binary ).BytesIn = input.MessageBinarySize();
+	}
+	if( options.BinaryFormat == BF_Mapped ) {
+		CMessageTableStats tableStats;
+		if( streamingWriter != nullptr ) {
+			createStreamedBinOutput( name, tableStats );
+		} else {
+			createMappedBinOutput( name, tableStats );
+		}
+		if( options.MergeStrings ) {
+			Log::Message( mergeReportTemplate.SubstParam( name, getSizeText( tableStats.RawBlobSize - tableStats.BlobSize ),
+				getSizeText( tableStats.RawBlobSize ) ) );
+		}
+		if( options.CompressionBlockSize > 0 ) {
+			Log::Message( compressionReportTemplate.SubstParam( name, getSizeText( tableStats.BlobSize ), getSizeText( tableStats.StoredBlobSize ) ) );
+		}
+		if( !options.DeltaBaseName.IsEmpty() ) {
+			createDeltaOutput( name );
+		}
+	} else {
+		if( cache == nullptr || cache->UpdateOutput( BO_Binary, name, getStreamBinHash() ) ) {
+			createStreamBinOutput( name );
+		}
+		if( stats != nullptr ) {
+			addOutputSize( CP_Binary, CCompileStats::GetFileSize( name ) );
+		}
+	}
+}
+
+void CMessageCompiler::createMappedBinOutput( CUnicodeView name, CMessageTableStats& tableStats ) const
+{
+	CArray<BYTE> image;
+	CMessageTableWriter writer( input, ids, options );
+	writer.SetLocales( locales );
+	writer.SetProfile( profile.get() );
+	writer.CreateImage( image, tableStats );
+	addOutputSize( CP_Binary, image.Size() );
+	writeBinaryImage( name, image );
+}
+
+// The table hash covers the whole image, so the image is not hashed again for the cache.
+void CMessageCompiler::writeBinaryImage( CUnicodeView name, CArrayView<BYTE> image ) const
+{
+	const uint64_t tableHash = reinterpret_cast<const CMessageTableHeader*>( image.Ptr() )->TableHash;
+	if( cache == nullptr || cache->UpdateOutput( BO_Binary, name, tableHash ) ) {
+		CFileWriter outputFile( name, FCM_CreateAlways );
+		outputFile.Write( image.Ptr(), image.Size() );
+	}
+}
+
+// The values have been written to the temporary blob during parsing, only the tables are created here.
+void CMessageCompiler::createStreamedBinOutput( CUnicodeView name, CMessageTableStats& tableStats ) const
+{
+	streamingWriter->CreateTables( input, ids, tableStats );
+	addOutputSize( CP_Binary, streamingWriter->Size() );
+	if( cache == nullptr || cache->UpdateOutput( BO_Binary, name, streamingWriter->ContentHash() ) ) {
+		streamingWriter->Write( name );
 	}
 }
 
-void CMessageCompiler::createBinOutput( CUnicodeView name ) const
+static const CUnicodeView deltaReportTemplate = L"%0: %1 messages changed, %2 added and %3 removed since %4.";
+// The new version is read back from the binary output, so the streamed and the in-memory tables are compared alike.
+void CMessageCompiler::createDeltaOutput( CUnicodeView binOutputName ) const
+{
+	const CMappedFile baseFile( options.DeltaBaseName );
+	const CMappedFile targetFile( binOutputName );
+	const CMessageTableView base( baseFile.Data(), baseFile.Size() );
+	const CMessageTableView target( targetFile.Data(), targetFile.Size() );
+	CArray<BYTE> image;
+	CMessageDeltaStats deltaStats;
+	CMessageDeltaWriter( base, target, ids.MessageIds ).CreateImage( image, deltaStats );
+
+	const CUnicodeString deltaName = getOutputName( binOutputName, L"delta" );
+	CFileWriter outputFile( deltaName, FCM_CreateAlways );
+	outputFile.Write( image.Ptr(), image.Size() );
+	Log::Message( deltaReportTemplate.SubstParam( deltaName, deltaStats.ChangedCount, deltaStats.AddedCount, deltaStats.RemovedCount,
+		options.DeltaBaseName ) );
+}
+
+CUnicodeString CMessageCompiler::getSizeText( __int64 size )
+{
+	char buffer[32];
+	sprintf_s( buffer, "%lld", size );
+	return UnicodeStr( CStringView( buffer ) );
+}
+
+void CMessageCompiler::createStreamBinOutput( CUnicodeView name ) const
 {
 	CFileWriter binOutputFile( name, FCM_CreateAlways );
-	// We know the exact size of a message and can set the archive buffer accordingly.
-	const int binarySize = input.MessageBinarySize();
+	// We know the exact size of a message and can set the archive buffer accordingly. Larger files are written with a full buffer.
+	const int binarySize = static_cast<int>( std::min<__int64>( input.MessageBinarySize(), INT_MAX ) );
 	CArchiveWriter binOutput( binOutputFile, binarySize );
 	writeBinSectionNames( binOutput );
 	writeBinMessages( binOutput );
@@ -154,49 +827,190 @@ void CMessageCompiler::writeBinSectionNames( CArchiveWriter& binOutput ) const
 	const auto size = sections.Size();
 	CMap<CString, int> sectionIds;
 	sectionIds.ReserveBuffer( size );
-	int namedSectionId = getFirstNamedSectionId();
+	int sectionPos = getFirstNamedSectionOrdinal();
 	for( const auto& section : sections ) {
-		sectionIds.Add( section.GetName(), namedSectionId );
-		namedSectionId++;
+		sectionIds.Add( section.GetName(), ids.SectionIds[sectionPos] );
+		sectionPos++;
 	}
 
 	binOutput << sectionIds;
 }
 
+// Messages are written in the ID order. Unused IDs get empty messages.
 void CMessageCompiler::writeBinMessages( CArchiveWriter& binOutput ) const
 {
-	binOutput << input.MessageCount();
-	int namedMessageId = fillBinOutput( input.GetUnnamedSections(), binOutput );
-	fillBinOutput( input.GetNamedSections(), binOutput );
+	CArray<CUnicodePart> messagesById;
+	int namedMessagePos = getMessagesById( messagesById );
+
+	binOutput << ids.MessageIdLimit;
+	for( const auto& message : messagesById ) {
+		binOutput << UnicodeStr( message );
+	}
 
-	int namedSectionId = getFirstNamedSectionId();
+	int sectionPos = getFirstNamedSectionOrdinal();
 	for( const auto& section : input.GetNamedSections() ) {
 		for( const auto& key : section.GetKeyNames() ) {
-			binOutput << key;
-			binOutput << namedSectionId;
-			binOutput << namedMessageId;
-			namedMessageId++;
+			binOutput << UnicodeStr( key );
+			binOutput << ids.SectionIds[sectionPos];
+			binOutput << ids.MessageIds[namedMessagePos];
+			namedMessagePos++;
 		}
-		namedSectionId++;
+		sectionPos++;
 	}
 }
 
-int CMessageCompiler::getFirstNamedSectionId() const
+static const CUnicodePart paramNames[CMessageParams::MaxParamCount] = { L"%0", L"%1", L"%2", L"%3", L"%4", L"%5", L"%6", L"%7", L"%8", L"%9" };
+// Precompiled parameters are checked by substituting every parameter with its own name, which must give the original value.
+bool CMessageCompiler::isValueEqual( const CMessageReader& reader, int messageId, CUnicodePart value )
 {
-	return input.GetUnnamedSections().Size();
+	if( reader.GetString( messageId ) != value ) {
+		return false;
+	}
+	return !reader.HasParams() || reader.Format( messageId, CArrayView<CUnicodePart>( paramNames, CMessageParams::MaxParamCount ) ) == value;
 }
 
-// Serialize message values and return the number of processed values.
-int CMessageCompiler::fillBinOutput( CArrayView<CMessageSection> sections, CArchiveWriter& result )
+// Hash of all the data that is serialized to the stream format. Strings are hashed with their lengths to keep them apart.
+uint64_t CMessageCompiler::getStreamBinHash() const
+{
+	uint64_t hash = HashOffsetBasis;
+	int sectionPos = getFirstNamedSectionOrdinal();
+	for( const auto& section : input.GetNamedSections() ) {
+		const auto name = section.GetName();
+		hash = HashValue( name.Length(), hash );
+		hash = HashBytes( name.Ptr(), name.Length(), hash );
+		hash = HashValue( ids.SectionIds[sectionPos], hash );
+		sectionPos++;
+	}
+
+	CArray<CUnicodePart> messagesById;
+	int namedMessagePos = getMessagesById( messagesById );
+	hash = HashValue( ids.MessageIdLimit, hash );
+	for( const auto& message : messagesById ) {
+		hash = HashValue( message.Length(), hash );
+		hash = HashString( message, hash );
+	}
+
+	sectionPos = getFirstNamedSectionOrdinal();
+	for( const auto& section : input.GetNamedSections() ) {
+		for( const auto& key : section.GetKeyNames() ) {
+			hash = HashValue( key.Length(), hash );
+			hash = HashString( key, hash );
+			hash = HashValue( ids.SectionIds[sectionPos], hash );
+			hash = HashValue( ids.MessageIds[namedMessagePos], hash );
+			namedMessagePos++;
+		}
+		sectionPos++;
+	}
+	return hash;
+}
+
+// Put the message values in the ID order and return the position of the first named section message.
+int CMessageCompiler::getMessagesById( CArray<CUnicodePart>& result ) const
+{
+	result.Empty();
+	result.IncreaseSize( ids.MessageIdLimit );
+	int messagePos = 0;
+	fillMessagesById( input.GetUnnamedSections(), ids.MessageIds, messagePos, result );
+	const int namedMessagePos = messagePos;
+	fillMessagesById( input.GetNamedSections(), ids.MessageIds, messagePos, result );
+	return namedMessagePos;
+}
+
+void CMessageCompiler::checkParams() const
+{
+	checkParams( input.GetUnnamedSections() );
+	checkParams( input.GetNamedSections() );
+}
+
+extern const CError Err_BadMessageParams( L"Message parameters must be numbered from zero without gaps and their count can't exceed %0.\n"
+	L"File name: %1. Section: %2. Key: %3." );
+void CMessageCompiler::checkParams( CArrayView<CMessageSection> sections ) const
+{
+	for( const auto& section : sections ) {
+		const auto paramMasks = section.GetParamMasks();
+		for( int i = 0; i < paramMasks.Size(); i++ ) {
+			const int paramCount = CMessageParams::GetParamCount( paramMasks[i] );
+			check( paramCount != NotFound && paramCount <= options.MaxParamCount, Err_BadMessageParams, options.MaxParamCount, input.GetFileName(),
+				UnicodeStr( section.GetName() ), section.GetKeyNames()[i] );
+		}
+	}
+}
+
+// Position of the first named section among the sections that have IDs.
+int CMessageCompiler::getFirstNamedSectionOrdinal() const
+{
+	return ids.SectionIds.Size() - input.GetNamedSections().Size();
+}
+
+void CMessageCompiler::fillMessagesById( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, int& messagePos, CArray<CUnicodePart>& result )
 {
-	int messageCount = 0;
 	for( const auto& section : sections ) {
 		for( const auto& value : section.GetKeyValues() ) {
-			result << value;
-			messageCount++;
+			result[messageIds[messagePos]] = value;
+			messagePos++;
+		}
+	}
+}
+
+extern const CError Err_BadMessageCount( L"Binary output has wrong message, section or locale count.\nFile name: %0." );
+extern const CError Err_BadLocaleName( L"Binary output has a wrong locale name.\nFile name: %0. Locale: %1." );
+// Check the messages of every locale.
+void CMessageCompiler::verifyBinOutput( CUnicodeView name ) const
+{
+	CMessageReader reader( name );
+	check( reader.MessageCount() == ids.MessageIdLimit && reader.SectionCount() == ids.SectionIdLimit
+		&& reader.LocaleCount() == std::max( locales.Size(), 1 ), Err_BadMessageCount, name );
+	int64_t checkedSize = 0;
+	for( int localeId = 0; localeId < reader.LocaleCount(); localeId++ ) {
+		if( !locales.IsEmpty() ) {
+			check( reader.FindLocale( locales[localeId].Name ) == localeId, Err_BadLocaleName, name, locales[localeId].Name );
+		}
+		reader.SetLocale( localeId );
+		checkedSize += verifyLocale( reader, localeId == 0 ? input : *locales[localeId].File, name );
+	}
+	if( stats != nullptr ) {
+		stats->Phase( CP_Verify ).BytesIn = CCompileStats::GetFileSize( name );
+		stats->Phase( CP_Verify ).BytesOut = checkedSize;
+	}
+}
+
+extern const CError Err_BadMessageValue( L"Binary output doesn't match the message file.\nFile name: %0. Message ID: %1." );
+extern const CError Err_BadMessageLookup( L"Binary output lookup doesn't match the message file.\nFile name: %0. Section: %1. Key: %2." );
+// Check every message by its ID and every named section message by its section and key.
+// The file has the keys of the parsed file in the same order. The result is the size of the checked values in bytes.
+int64_t CMessageCompiler::verifyLocale( const CMessageReader& reader, const CMessageFile& file, CUnicodeView name ) const
+{
+	int64_t checkedSize = 0;
+	int messagePos = 0;
+	for( const auto& section : file.GetUnnamedSections() ) {
+		for( const auto& value : section.GetKeyValues() ) {
+			const int messageId = ids.MessageIds[messagePos];
+			check( isValueEqual( reader, messageId, value ), Err_BadMessageValue, name, messageId );
+			checkedSize += value.Length() * sizeof( wchar_t );
+			messagePos++;
+		}
+	}
+
+	int sectionPos = getFirstNamedSectionOrdinal();
+	for( const auto& section : file.GetNamedSections() ) {
+		const CUnicodeString sectionName = UnicodeStr( section.GetName() );
+		const int sectionId = ids.SectionIds[sectionPos];
+		const auto keys = section.GetKeyNames();
+		const auto values = section.GetKeyValues();
+		for( int i = 0; i < keys.Size(); i++ ) {
+			const int messageId = ids.MessageIds[messagePos];
+			check( isValueEqual( reader, messageId, values[i] ), Err_BadMessageValue, name, messageId );
+			CUnicodePart foundValue;
+			const bool isFound = reader.FindString( sectionName, keys[i], foundValue );
+			const bool isFoundValueEqual = isFound && foundValue == values[i];
+			check( isFoundValueEqual && reader.FindSection( sectionName ) == sectionId && reader.FindMessage( sectionId, keys[i] ) == messageId,
+				Err_BadMessageLookup, name, sectionName, keys[i] );
+			checkedSize += values[i].Length() * sizeof( wchar_t );
+			messagePos++;
 		}
+		sectionPos++;
 	}
-	return messageCount;
+	return checkedSize;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1,34 +1,138 @@
 #pragma once
 #include <MessageFile.h>
+#include <CompilerOptions.h>
+#include <MessageIdMap.h>
+#include <BuildCache.h>
+#include <CompileStats.h>
+#include <StreamingTableWriter.h>
+#include <AccessProfile.h>
 
 namespace Msg {
 
+class CCodeEmitter;
+class CMessageReader;
 //////////////////////////////////////////////////////////////////////////
 
 class CMessageCompiler {
 public:
-	explicit CMessageCompiler( CUnicodeView fileName );
+	// Parse a message file. If a cache is given, outputs that have the same content as in the cache are not written.
+	// If statistics are given, every compilation phase is measured.
+	CMessageCompiler( CUnicodeView fileName, const CCompilerOptions& options, CBuildCache* cache = nullptr, CCompileStats* stats = nullptr );
+	// Parse the text of a message file that has already been read. The options must not enable streaming.
+	CMessageCompiler( CUnicodeView fileName, CUnicodeString text, const CCompilerOptions& options, CBuildCache* cache = nullptr,
+		CCompileStats* stats = nullptr );
 
+	const CMessageFile& GetInput() const
+		{ return input; }
+	const CMessageIds& GetIds() const
+		{ return ids; }
+	// Put several locales in the mapped binary output. The first locale is the reference locale, which is the parsed file.
+	// The other locales must have the keys of the parsed file in the same order. The locales must outlive the compiler.
+	void SetLocales( CArrayView<CMessageLocale> newValue )
+		{ locales = newValue; }
+
+	// Create all the outputs. The header, the source and the binary file are created concurrently.
 	void Compile( CUnicodeView srcOutputName, CUnicodeView binOutputName ) const;
+	// Parse the changed message file again and update the IDs if the keys have changed. The options must enable watching.
+	// If the new version of the file is invalid, the compiler keeps the last valid version.
+	void Update();
+	// Create the outputs that depend on the changes since the last call. If the keys haven't changed, only the binary file
+	// and the embedded messages are created, because the other outputs depend only on the keys.
+	void CompileChanges( CUnicodeView srcOutputName, CUnicodeView binOutputName );
+	// Separate compilation steps. The header and the source replace the extension of the source output name.
+	void CreateHeader( CUnicodeView srcOutputName ) const;
+	void CreateSource( CUnicodeView srcOutputName ) const;
+	void CreateBinary( CUnicodeView binOutputName ) const;
+	// Create the header and source pairs of the shards. Files whose contents haven't changed are not rewritten.
+	void CreateShards( CUnicodeView srcOutputName ) const;
+
+	// Compile a file with the given options. Incremental compilation skips parsing if the inputs haven't changed.
+	static void CompileFile( CUnicodeView fileName, CUnicodeView srcOutputName, CUnicodeView binOutputName, const CCompilerOptions& options );
+	// Compile a file and compile it again after every change until the process is stopped. The parsed file is kept in memory
+	// and only its changed parts are parsed again. Errors are logged and the watching continues.
+	static void WatchFile( CUnicodeView fileName, CUnicodeView srcOutputName, CUnicodeView binOutputName, const CCompilerOptions& options );
+	// Check if the options produce a source file besides the header.
+	static bool HasSrcOutput( const CCompilerOptions& options );
 
 private:
+	// Consecutive sections that are put in a single header and source pair.
+	struct CShard {
+		CString Name;
+		CArrayView<CMessageSection> Sections;
+		// Position of the first message of the shard in the file order.
+		int FirstMessagePos = 0;
+	};
+
+	// Writer of the binary output in the streaming mode. It receives the values while the input is parsed.
+	std::unique_ptr<CStreamingTableWriter> streamingWriter;
 	CMessageFile input;
+	CCompilerOptions options;
+	CUnicodeString idMapName;
+	CMessageIdMap idMap;
+	CMessageIds ids;
+	CBuildCache* cache;
+	CCompileStats* stats;
+	CArrayView<CMessageLocale> locales;
+	// Null if the options have no access profile.
+	std::unique_ptr<CAccessProfile> profile;
+	// The keys have changed since the outputs that depend on them were created.
+	bool hasKeyChanges = true;
+	// Mapped binary output of the last watch compilation, patched with the changed values. Empty if it must be created anew.
+	CArray<BYTE> watchImage;
+	// Blob size up to which the watch image is patched. Replaced values stay in the blob, so it is created anew beyond it.
+	__int64 maxWatchBlobSize = 0;
+	// Hash of the blob of the watch image, continued by the patches.
+	uint64_t watchBlobHash = 0;
+
+	TMessageValueHandler getValueHandler() const;
+	void initialize();
+	static uint64_t getFileHash( CUnicodeView fileName );
+	static uint64_t getInputHash( uint64_t fileHash, CUnicodeView fileName, CUnicodeView srcOutputName, const CCompilerOptions& options );
+	static CUnicodeString getIdMapName( CUnicodeView fileName );
+	static CUnicodeString getCacheName( CUnicodeView binOutputName );
+	void updateIds();
+	static CUnicodeString getOutputName( CUnicodeView name, CUnicodeView ext );
+	static void reportStats( const CCompileStats* stats, TStatsFormat format );
+	void addOutputSize( TCompilePhase phase, int64_t size ) const;
+	void writeTextOutput( TBuildOutput output, CUnicodeView name, CStringPart text ) const;
+
+	void checkParams() const;
+	void checkParams( CArrayView<CMessageSection> sections ) const;
+	int getFirstNamedSectionOrdinal() const;
 
-	int getFirstNamedSectionId() const;
-
-	void createIncOutput( CUnicodeView name ) const;
-	void fillSectionDeclaration( CString& result ) const;
-	void fillIncOutput( CString& result ) const;
-	static void fillIncOutput( CArrayView<CMessageSection> sections, CString& result );
-	void createSrcOutput( CUnicodeView name ) const;
-	void fillSectionDefinition( CString& result ) const;
-	void fillSrcOutput( CString& result ) const;
-	static void fillSrcOutput( CArrayView<CMessageSection> sections, CString& result, int& totalKeyCount );
-	void createBinOutput( CUnicodeView name ) const;
+	void fillSectionDeclaration( CCodeEmitter& result ) const;
+	void fillIncOutput( CCodeEmitter& result ) const;
+	static void fillIncOutput( CArrayView<CMessageSection> sections, CCodeEmitter& result );
+	void fillSectionDefinition( CStringView defTemplate, CCodeEmitter& result ) const;
+	void fillSrcOutput( CStringView defTemplate, CCodeEmitter& result ) const;
+	static void fillSrcOutput( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CStringView defTemplate, CCodeEmitter& result, int& messagePos );
+	void checkEnumNames() const;
+	void fillSectionEnum( CCodeEmitter& result ) const;
+	void fillEnumIncOutput( CCodeEmitter& result ) const;
+	static void fillEnumIncOutput( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CCodeEmitter& result, int& messagePos );
+	void splitShards( CArrayView<CMessageSection> sections, bool isNamed, int& messagePos, CArray<CShard>& shards ) const;
+	void createShard( CUnicodeView name, const CShard& shard ) const;
+	static void checkShardNames( CUnicodeView name, CArrayView<CShard> shards );
+	static CString getFoldedName( CStringPart name );
+	static CUnicodeString getShardOutputName( CUnicodeView name, CStringPart shardName, CUnicodeView ext );
+	void writeShardOutput( CUnicodeView name, CStringPart text ) const;
+	static void writeChangedOutput( CUnicodeView name, CStringPart text );
+	void createMappedBinOutput( CUnicodeView name, CMessageTableStats& tableStats ) const;
+	void updateWatchBinary( CUnicodeView name );
+	void writeBinaryImage( CUnicodeView name, CArrayView<BYTE> image ) const;
+	void createStreamedBinOutput( CUnicodeView name, CMessageTableStats& tableStats ) const;
+	void createDeltaOutput( CUnicodeView binOutputName ) const;
+	static CUnicodeString getSizeText( __int64 size );
+	void createStreamBinOutput( CUnicodeView name ) const;
+	void verifyBinOutput( CUnicodeView name ) const;
+	int64_t verifyLocale( const CMessageReader& reader, const CMessageFile& file, CUnicodeView name ) const;
+	static bool isValueEqual( const CMessageReader& reader, int messageId, CUnicodePart value );
 	void writeBinSectionNames( CArchiveWriter& binOutput ) const;
 	void writeBinMessages( CArchiveWriter& binOutput ) const;
+	uint64_t getStreamBinHash() const;
+	int getMessagesById( CArray<CUnicodePart>& result ) const;
 
-	static int fillBinOutput( CArrayView<CMessageSection> sections, CArchiveWriter& result );
+	static void fillMessagesById( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, int& messagePos, CArray<CUnicodePart>& result );
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,69 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageDelta.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_BadMessageDelta( L"Invalid message table delta." );
+CMessageDeltaView::CMessageDeltaView( const BYTE* _data, __int64 size ) :
+	data( _data ),
+	header( reinterpret_cast<const CMessageDeltaHeader*>( data ) ),
+	changes( nullptr ),
+	blob( nullptr )
+{
+	check( data != nullptr && size >= static_cast<__int64>( sizeof( CMessageDeltaHeader ) ), Err_BadMessageDelta );
+	checkDeltaConsistency( size );
+	changes = reinterpret_cast<const CMessageDeltaChange*>( data + header->ChangeTableOffset );
+	blob = data + header->BlobOffset;
+	checkChangeConsistency();
+}
+
+void CMessageDeltaView::checkDeltaConsistency( __int64 size ) const
+{
+	check( header->Signature == MessageDeltaSignature && header->Version == MessageDeltaVersion, Err_BadMessageDelta );
+	check( header->Encoding == MTE_Wide || header->Encoding == MTE_Utf8, Err_BadMessageDelta );
+	check( static_cast<int>( header->CharSize ) == GetEncodingCharSize( header->Encoding ), Err_BadMessageDelta );
+	check( header->MessageCount <= INT_MAX && header->LocaleCount > 0 && header->LocaleCount <= INT_MAX, Err_BadMessageDelta );
+	check( header->ChangeCount <= INT_MAX, Err_BadMessageDelta );
+	const uint64_t fileSize = static_cast<uint64_t>( size );
+	check( header->BlobOffset <= fileSize && header->BlobSize <= fileSize - header->BlobOffset, Err_BadMessageDelta );
+	check( header->ChangeTableOffset <= header->BlobOffset, Err_BadMessageDelta );
+	check( header->ChangeCount <= ( header->BlobOffset - header->ChangeTableOffset ) / sizeof( CMessageDeltaChange ), Err_BadMessageDelta );
+}
+
+// Every change is checked once, so applying the delta doesn't need to check anything.
+void CMessageDeltaView::checkChangeConsistency() const
+{
+	for( uint32_t i = 0; i < header->ChangeCount; i++ ) {
+		const CMessageDeltaChange& change = changes[i];
+		check( change.MessageId < header->MessageCount && change.LocaleId < header->LocaleCount, Err_BadMessageDelta );
+		check( change.Change == MDC_Changed || change.Change == MDC_Added || change.Change == MDC_Removed, Err_BadMessageDelta );
+		const uint64_t valueSize = ( change.Length + static_cast<uint64_t>( 1 ) ) * header->CharSize;
+		check( change.Offset <= header->BlobSize && valueSize <= header->BlobSize - change.Offset, Err_BadMessageDelta );
+	}
+}
+
+const CMessageDeltaChange& CMessageDeltaView::GetChange( int changeId ) const
+{
+	assert( changeId >= 0 && changeId < ChangeCount() );
+	return changes[changeId];
+}
+
+CUnicodeString CMessageDeltaView::DecodeValue( int changeId ) const
+{
+	const CMessageDeltaChange& change = GetChange( changeId );
+	const BYTE* value = blob + change.Offset;
+	if( Encoding() == MTE_Wide ) {
+		return UnicodeStr( CUnicodePart( reinterpret_cast<const wchar_t*>( value ), change.Length ) );
+	}
+	CUnicodeString result;
+	CUtf8::Decode( value, change.Length, result );
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
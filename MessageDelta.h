@@ -0,0 +1,44 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Read-only view of a message table delta. The layout is described in MessageTableFormat.h.
+// The view does not own the delta memory. The whole delta is validated when the view is created.
+class CMessageDeltaView {
+public:
+	// Create a view of a delta image. The image must outlive the view and be aligned to MessageTableAlignment.
+	CMessageDeltaView( const BYTE* data, __int64 size );
+
+	TMessageTableEncoding Encoding() const
+		{ return header->Encoding; }
+	uint64_t BaseHash() const
+		{ return header->BaseHash; }
+	uint64_t TargetHash() const
+		{ return header->TargetHash; }
+	int MessageCount() const
+		{ return header->MessageCount; }
+	int LocaleCount() const
+		{ return header->LocaleCount; }
+
+	int ChangeCount() const
+		{ return header->ChangeCount; }
+	const CMessageDeltaChange& GetChange( int changeId ) const;
+	// Convert the new value of a change to a wide string.
+	CUnicodeString DecodeValue( int changeId ) const;
+
+private:
+	const BYTE* data;
+	const CMessageDeltaHeader* header;
+	const CMessageDeltaChange* changes;
+	const BYTE* blob;
+
+	void checkDeltaConsistency( __int64 size ) const;
+	void checkChangeConsistency() const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,140 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageDeltaWriter.h>
+#include <MessageTable.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_DeltaTableMismatch( L"Base of a message table delta must have the encoding and the locales of the new table." );
+CMessageDeltaWriter::CMessageDeltaWriter( const CMessageTableView& _base, const CMessageTableView& _target, CArrayView<int> usedMessageIds ) :
+	base( _base ),
+	target( _target )
+{
+	check( base.Encoding() == target.Encoding() && base.LocaleCount() == target.LocaleCount(), Err_DeltaTableMismatch );
+	for( int localeId = 0; localeId < target.LocaleCount(); localeId++ ) {
+		check( base.DecodeLocaleName( localeId ) == target.DecodeLocaleName( localeId ), Err_DeltaTableMismatch );
+	}
+	isUsed.IncreaseSize( target.MessageCount() );
+	memset( isUsed.Ptr(), 0, isUsed.Size() );
+	for( const int messageId : usedMessageIds ) {
+		isUsed[messageId] = 1;
+	}
+}
+
+extern const CError Err_MessageDeltaTooLarge( L"Message table delta is too large. Compile the whole table instead." );
+// Message IDs cover both versions, so the messages beyond the new message count are removed.
+void CMessageDeltaWriter::CreateImage( CArray<BYTE>& result, CMessageDeltaStats& stats ) const
+{
+	const int messageCount = std::max( base.MessageCount(), target.MessageCount() );
+	CArray<CMessageDeltaChange> changes;
+	CArray<BYTE> blob;
+	stats = CMessageDeltaStats();
+	for( int localeId = 0; localeId < target.LocaleCount(); localeId++ ) {
+		for( int messageId = 0; messageId < messageCount; messageId++ ) {
+			CMessageDeltaChange change{};
+			if( !getChange( messageId, localeId, change.Change ) ) {
+				continue;
+			}
+			change.MessageId = messageId;
+			change.LocaleId = localeId;
+			addValue( messageId, localeId, blob, change );
+			changes.Add( change );
+			stats.ChangedCount += change.Change == MDC_Changed ? 1 : 0;
+			stats.AddedCount += change.Change == MDC_Added ? 1 : 0;
+			stats.RemovedCount += change.Change == MDC_Removed ? 1 : 0;
+		}
+	}
+
+	CMessageDeltaHeader header{};
+	header.Signature = MessageDeltaSignature;
+	header.Version = MessageDeltaVersion;
+	header.Encoding = target.Encoding();
+	header.CharSize = GetEncodingCharSize( target.Encoding() );
+	header.BaseHash = base.TableHash();
+	header.TargetHash = target.TableHash();
+	header.MessageCount = messageCount;
+	header.LocaleCount = target.LocaleCount();
+	header.ChangeCount = changes.Size();
+	header.ChangeTableOffset = AlignTableOffset( sizeof( CMessageDeltaHeader ) );
+	header.BlobOffset = AlignTableOffset( header.ChangeTableOffset + changes.Size() * static_cast<__int64>( sizeof( CMessageDeltaChange ) ) );
+	header.BlobSize = blob.Size();
+	const __int64 imageSize = header.BlobOffset + header.BlobSize;
+	check( imageSize <= INT_MAX, Err_MessageDeltaTooLarge );
+
+	result.Empty();
+	result.IncreaseSize( static_cast<int>( imageSize ) );
+	BYTE* image = result.Ptr();
+	// Padding must be deterministic.
+	memset( image, 0, static_cast<size_t>( header.BlobOffset ) );
+	memcpy( image, &header, sizeof( header ) );
+	memcpy( image + header.ChangeTableOffset, changes.Ptr(), changes.Size() * sizeof( CMessageDeltaChange ) );
+	memcpy( image + header.BlobOffset, blob.Ptr(), blob.Size() );
+}
+
+// Return false if the message is the same in both versions. IDs beyond the base are added even if they are unused,
+// so that every ID of the new version has a value after the delta is applied.
+bool CMessageDeltaWriter::getChange( int messageId, int localeId, TMessageDeltaChange& result ) const
+{
+	if( messageId >= base.MessageCount() ) {
+		result = MDC_Added;
+		return true;
+	}
+	if( messageId >= target.MessageCount() || isUsed[messageId] == 0 ) {
+		result = MDC_Removed;
+		return !isEmptyValue( base, messageId, localeId );
+	}
+	result = MDC_Changed;
+	return !isSameValue( base, target, messageId, localeId );
+}
+
+// Removed messages get an empty value.
+void CMessageDeltaWriter::addValue( int messageId, int localeId, CArray<BYTE>& blob, CMessageDeltaChange& change ) const
+{
+	const int charSize = GetEncodingCharSize( target.Encoding() );
+	const BYTE* value = nullptr;
+	change.Length = 0;
+	if( change.Change != MDC_Removed ) {
+		if( target.Encoding() == MTE_Wide ) {
+			const CUnicodePart str = target.GetString( messageId, localeId );
+			value = reinterpret_cast<const BYTE*>( str.Ptr() );
+			change.Length = str.Length();
+		} else {
+			const CStringPart str = target.GetUtf8String( messageId, localeId );
+			value = reinterpret_cast<const BYTE*>( str.Ptr() );
+			change.Length = str.Length();
+		}
+	}
+
+	const int size = ( change.Length + 1 ) * charSize;
+	const int start = blob.Size();
+	check( start <= INT_MAX - size, Err_MessageDeltaTooLarge );
+	change.Offset = start;
+	blob.IncreaseSize( start + size );
+	if( value != nullptr ) {
+		memcpy( blob.Ptr() + start, value, size - charSize );
+	}
+	memset( blob.Ptr() + start + size - charSize, 0, charSize );
+}
+
+bool CMessageDeltaWriter::isEmptyValue( const CMessageTableView& table, int messageId, int localeId )
+{
+	if( table.Encoding() == MTE_Wide ) {
+		return table.GetString( messageId, localeId ).IsEmpty();
+	}
+	return table.GetUtf8String( messageId, localeId ).IsEmpty();
+}
+
+bool CMessageDeltaWriter::isSameValue( const CMessageTableView& left, const CMessageTableView& right, int messageId, int localeId )
+{
+	if( left.Encoding() == MTE_Wide ) {
+		return left.GetString( messageId, localeId ) == right.GetString( messageId, localeId );
+	}
+	return left.GetUtf8String( messageId, localeId ) == right.GetUtf8String( messageId, localeId );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,41 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+class CMessageTableView;
+//////////////////////////////////////////////////////////////////////////
+
+// Numbers of the messages in a created delta.
+struct CMessageDeltaStats {
+	int ChangedCount = 0;
+	int AddedCount = 0;
+	int RemovedCount = 0;
+};
+
+// Creator of a delta between two versions of a message table. The layout is described in MessageTableFormat.h.
+// Messages are compared in the table encoding without decoding, and the new values are stored in the same encoding.
+class CMessageDeltaWriter {
+public:
+	// The versions must have the same encoding and locales. Message IDs of the new version that are not among
+	// the used IDs are removed. Both tables must outlive the writer.
+	CMessageDeltaWriter( const CMessageTableView& base, const CMessageTableView& target, CArrayView<int> usedMessageIds );
+
+	// Create the whole delta image in memory.
+	void CreateImage( CArray<BYTE>& result, CMessageDeltaStats& stats ) const;
+
+private:
+	const CMessageTableView& base;
+	const CMessageTableView& target;
+	// Nonzero for the message IDs used by the new version.
+	CArray<BYTE> isUsed;
+
+	bool getChange( int messageId, int localeId, TMessageDeltaChange& result ) const;
+	void addValue( int messageId, int localeId, CArray<BYTE>& blob, CMessageDeltaChange& change ) const;
+	static bool isEmptyValue( const CMessageTableView& table, int messageId, int localeId );
+	static bool isSameValue( const CMessageTableView& left, const CMessageTableView& right, int messageId, int localeId );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -2,6 +2,11 @@
 #pragma hdrstop
 
 #include <MessageFile.h>
+#include <CharScanner.h>
+#include <MessageParams.h>
+#include <CompileStats.h>
+#include <TextFileReader.h>
+#include <WorkerPool.h>
 
 namespace Msg {
 
@@ -16,66 +21,536 @@ CMessageSection::CMessageSection( CMessageSection&& other ) :
 	name( move( other.name ) ),
 	keyNames( move( other.keyNames ) ),
 	keyValues( move( other.keyValues ) ),
+	paramMasks( move( other.paramMasks ) ),
 	uniqueKeys( move( other.uniqueKeys ) )
 {
 
 }
 
-bool CMessageSection::SetString( CUnicodePart keyName, CUnicodePart newValue )
+bool CMessageSection::SetString( CUnicodePart keyName, CUnicodePart newValue, int paramMask )
 {
 	if( !uniqueKeys.Set( keyName ) ) {
 		return false;
 	}
 	keyNames.Add( keyName );
 	keyValues.Add( newValue );
+	paramMasks.Add( paramMask );
 	return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-CMessageFile::CMessageFile( CUnicodeView _fileName ) :
-	fileName( _fileName )
+CMessageFile::CMessageFile( CUnicodeView _fileName, CCompileStats* stats, int workerCount, const TMessageValueHandler& valueHandler,
+		bool _isUpdatable ) :
+	fileName( _fileName ),
+	isUpdatable( _isUpdatable )
 {
-	parseFile();
+	assert( !isUpdatable || !valueHandler );
+	if( valueHandler ) {
+		parseStream( stats, valueHandler );
+	} else {
+		parseFile( stats, workerCount );
+	}
 }
 
-extern const CError Err_BadMessageFile( L"Message file contains an invalid string.\nFile name: %0. File position: %1." );
-void CMessageFile::parseFile()
+CMessageFile::CMessageFile( CUnicodeView _fileName, CUnicodeString text, CCompileStats* stats, int workerCount, bool _isUpdatable ) :
+	fileName( _fileName ),
+	isUpdatable( _isUpdatable )
 {
-	const CUnicodeString fileStr = File::ReadUnicodeText( fileName );
+	parseText( text, stats, workerCount );
+}
 
+extern const CError Err_BadMessageFile( L"Message file contains an invalid string.\nFile name: %0. File position: %1." );
+// A chunk is parsed like a whole file, except that it has to end exactly at the start of the next chunk.
+// Keys at the start of a chunk that begins inside a section are put in the continuation.
+CMessageFile::CMessageFile( CUnicodeView _fileName, CUnicodeView contents, int begin, int end, __int64 _basePosition,
+		const CMessageSection* continuedSection ) :
+	fileName( _fileName ),
+	basePosition( _basePosition )
+{
 	CMessageSection* currentSection = nullptr;
+	if( continuedSection != nullptr ) {
+		continuation.SetName( UnicodeStr( continuedSection->GetName() ) );
+		currentSection = &continuation;
+	}
+	const int endPos = parseRange( contents, begin, end, currentSection );
+	check( endPos == end, Err_BadMessageFile, fileName, getPositionText( endPos ) );
+}
+
+// Files shorter than two chunks are always parsed on a single thread.
+static const int minChunkLength = 1 << 20;
+// Every worker gets several chunks, so that the chunks of different complexity are balanced.
+static const int chunksPerWorker = 4;
+
+void CMessageFile::parseFile( CCompileStats* stats, int workerCount )
+{
+	CUnicodeString fileStr;
+	{
+		CPhaseTimer timer( stats, CP_Read );
+		fileStr = File::ReadUnicodeText( fileName );
+	}
+	parseText( fileStr, stats, workerCount );
+}
+
+void CMessageFile::parseText( CUnicodeString& fileStr, CCompileStats* stats, int workerCount )
+{
 	const int length = fileStr.Length();
-	for( int strPos = 0; strPos < length; ) {
-		strPos = skipWhitespaceAndComments( fileStr, strPos );
+	CPhaseTimer timer( stats, CP_Parse );
+	const CWorkerPool workers( workerCount );
+	if( isUpdatable ) {
+		updateParts( fileStr, workers );
+		haveKeysChanged = true;
+		addParseStats( stats, length );
+		return;
+	}
+	CArray<int> chunkStarts;
+	if( workers.WorkerCount() > 1 && length >= 2 * minChunkLength ) {
+		const int targetChunkCount = workers.WorkerCount() * chunksPerWorker;
+		const int chunkLength = length / targetChunkCount > minChunkLength ? length / targetChunkCount : minChunkLength;
+		findChunkStarts( fileStr, chunkLength, false, chunkStarts );
+	}
+	if( chunkStarts.Size() <= 1 || !parseChunks( fileStr, chunkStarts, workers ) ) {
+		parseRange( fileStr, 0, length, nullptr );
+	}
+	addParseStats( stats, length );
+}
+
+void CMessageFile::Update( CCompileStats* stats, int workerCount )
+{
+	assert( isUpdatable );
+	CUnicodeString newText;
+	{
+		CPhaseTimer timer( stats, CP_Read );
+		newText = File::ReadUnicodeText( fileName );
+	}
+	const int length = newText.Length();
+	CPhaseTimer timer( stats, CP_Parse );
+	updateParts( newText, CWorkerPool( workerCount ) );
+	addParseStats( stats, length );
+}
+
+void CMessageFile::addParseStats( CCompileStats* stats, int length ) const
+{
+	if( stats != nullptr ) {
+		const int64_t textSize = static_cast<int64_t>( length ) * sizeof( wchar_t );
+		stats->Phase( CP_Read ).BytesIn = CCompileStats::GetFileSize( fileName );
+		stats->Phase( CP_Read ).BytesOut = textSize;
+		stats->Phase( CP_Parse ).BytesIn = textSize;
+		stats->Phase( CP_Parse ).BytesOut = totalSize;
+	}
+}
+
+// Find the items that start new chunks: the first item at the start of a line after every chunkLength characters.
+// Section openers are always accepted, keys only if acceptsKeys is set.
+// Quotes and comments are skipped so that the items are usually real. The search doesn't have to be exact:
+// a chunk that doesn't end exactly at the next chunk start fails to parse and is parsed again in a larger piece.
+void CMessageFile::findChunkStarts( CUnicodeView str, int chunkLength, bool acceptsKeys, CArray<int>& result )
+{
+	const wchar_t* ptr = str.Ptr();
+	result.Add( 0 );
+	int nextStart = chunkLength;
+	bool isInQuotes = false;
+	for( int pos = 0; ptr[pos] != 0; ) {
+		if( isInQuotes ) {
+			pos = CCharScanner::FindAnyOf( ptr, pos, L'\"', L'\\' );
+			if( ptr[pos] == L'\\' ) {
+				pos += ptr[pos + 1] != 0 ? 2 : 1;
+			} else if( ptr[pos] == L'\"' ) {
+				isInQuotes = false;
+				pos++;
+			}
+			continue;
+		}
+
+		pos = CCharScanner::FindAnyOf( ptr, pos, L'\"', L';', L'/', L'\n' );
+		switch( ptr[pos] ) {
+			case L'\"':
+				isInQuotes = true;
+				pos++;
+				break;
+			case L';':
+				pos = CCharScanner::FindAnyOf( ptr, pos + 1, L'\n' );
+				break;
+			case L'/':
+				// A single slash is not a comment.
+				pos = ptr[pos + 1] == L'/' ? CCharScanner::FindAnyOf( ptr, pos + 1, L'\n' ) : pos + 1;
+				break;
+			case L'\n':
+				pos = skipWhitespace( str, pos + 1 );
+				if( pos >= nextStart && ( ptr[pos] == L'[' || ptr[pos] == L'{' || ( acceptsKeys && isCharValidVariableSymbol( ptr[pos] ) ) ) ) {
+					result.Add( pos );
+					nextStart = pos + chunkLength;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+// Parse the chunks concurrently and merge their sections in the file order.
+// Return false if any chunk fails or the chunks contain sections of the same kind and name. The serial parser then gives the exact error.
+bool CMessageFile::parseChunks( CUnicodeView contents, CArrayView<int> chunkStarts, const CWorkerPool& workers )
+{
+	const int chunkCount = chunkStarts.Size();
+	chunks.IncreaseSize( chunkCount );
+	workers.Run( chunkCount, [&]( int chunkIndex ) {
+		const int end = chunkIndex + 1 < chunkCount ? chunkStarts[chunkIndex + 1] : contents.Length();
+		try {
+			chunks[chunkIndex].reset( new CMessageFile( fileName, contents, chunkStarts[chunkIndex], end ) );
+		} catch( CException& ) {
+			// The chunk stays empty.
+		}
+	} );
+
+	// Section names are compared before anything is moved, so a failure leaves the file empty.
+	CHashTable<CString> uniqueNames;
+	CHashTable<CString> uniqueNamedNames;
+	for( const auto& chunk : chunks ) {
+		if( chunk == nullptr ) {
+			chunks.Empty();
+			return false;
+		}
+		for( const auto& section : chunk->sections ) {
+			if( !uniqueNames.Set( Str( section.GetName() ) ) ) {
+				chunks.Empty();
+				return false;
+			}
+		}
+		for( const auto& section : chunk->namedSections ) {
+			if( !uniqueNamedNames.Set( Str( section.GetName() ) ) ) {
+				chunks.Empty();
+				return false;
+			}
+		}
+	}
+
+	// The merged file knows the names of its sections like a serially parsed file.
+	for( auto& chunk : chunks ) {
+		for( auto& section : chunk->sections ) {
+			sectionNames.Set( strings.Add( UnicodeStr( section.GetName() ) ) );
+			sections.Add( move( section ) );
+		}
+		for( auto& section : chunk->namedSections ) {
+			namedSectionNames.Set( strings.Add( UnicodeStr( section.GetName() ) ) );
+			namedSections.Add( move( section ) );
+		}
+		chunk->sections.Empty();
+		chunk->namedSections.Empty();
+		messageCount += chunk->messageCount;
+		totalSize += chunk->totalSize;
+		escapeCount += chunk->escapeCount;
+	}
+	return true;
+}
+
+// Parse the contents from begin to end. Return the position where the parsing stopped.
+// If end is not the end of the contents, the parsing stops at the first token that starts at end.
+int CMessageFile::parseRange( CUnicodeView contents, int begin, int end, CMessageSection* currentSection )
+{
+	const bool isChunk = end < contents.Length();
+	// Value buffer is reused between the pairs to keep its capacity.
+	CUnicodeString valueName;
+	int strPos = begin;
+	while( strPos < end ) {
+		strPos = skipWhitespaceAndComments( contents, strPos );
+		if( isChunk && strPos >= end ) {
+			break;
+		}
 
-		CUnicodeString newSectionName;
-		if( parseSection( fileStr, strPos, newSectionName ) ) {
+		CUnicodePart newSectionName;
+		if( parseSection( contents, strPos, newSectionName ) ) {
 			currentSection = &createSection( newSectionName );
 			continue;
 		}
-		if( parseNamedSection( fileStr, strPos, newSectionName ) ) {
+		if( parseNamedSection( contents, strPos, newSectionName ) ) {
 			currentSection = &createNamedSection( newSectionName );
 			continue;
 		}
 
-		CUnicodeString keyName;
-		CUnicodeString valueName;
-		if( parseKeyValuePair( fileStr, strPos, keyName, valueName ) ) {
+		CUnicodePart keyName;
+		valueName.Empty();
+		if( parseKeyValuePair( contents, strPos, keyName, valueName ) ) {
 			setNewValue( currentSection, keyName, valueName );
 			continue;
 		}
-		check( false, Err_BadMessageFile, fileName, strPos );
+		check( false, Err_BadMessageFile, fileName, getPositionText( strPos ) );
+	}
+	return strPos;
+}
+
+// Minimum length of a part of an updatable file. An edit parses at least one part again.
+static const int updatePartLength = 1 << 14;
+
+// Parts that end before the first changed character are kept, and so are the parts that start in the unchanged end of the text.
+// The first character after a kept part must not change, because the parsing of a part looks at it.
+// The parts in between are parsed again. If they can't be parsed separately, the whole text is parsed as a single part,
+// which also gives the exact error of an invalid file. Nothing is changed until all the parts are parsed.
+void CMessageFile::updateParts( CUnicodeString& newText, const CWorkerPool& workers )
+{
+	const int oldLength = text.Length();
+	const int newLength = newText.Length();
+	const int minLength = std::min( oldLength, newLength );
+	const int prefixLength = getCommonPrefixLength( text.Ptr(), newText.Ptr(), minLength );
+	if( prefixLength == oldLength && prefixLength == newLength ) {
+		haveKeysChanged = false;
+		parsedPartCount = 0;
+		updatedSections.Empty();
+		return;
+	}
+	const int suffixLength = getCommonSuffixLength( text.Ptr() + oldLength, newText.Ptr() + newLength, minLength - prefixLength );
+	int firstPart = 0;
+	while( firstPart < parts.Size() && parts[firstPart].End < prefixLength ) {
+		firstPart++;
+	}
+	int lastPart = parts.Size();
+	while( lastPart > firstPart && parts[lastPart - 1].Begin >= oldLength - suffixLength ) {
+		lastPart--;
+	}
+
+	const int regionBegin = firstPart < parts.Size() ? parts[firstPart].Begin : oldLength;
+	const int regionEnd = ( lastPart < parts.Size() ? parts[lastPart].Begin : oldLength ) + newLength - oldLength;
+	CArray<CFilePart> newParts;
+	int keptPrefixCount = getSectionCount( 0, firstPart, false );
+	int keptSuffixBegin = sections.Size() - getSectionCount( lastPart, parts.Size(), false );
+	const bool isParsed = parseParts( newText, regionBegin, regionEnd, workers, newParts )
+		&& hasUniqueSectionNames( firstPart, lastPart, newParts, false ) && hasUniqueSectionNames( firstPart, lastPart, newParts, true );
+	if( !isParsed ) {
+		firstPart = 0;
+		lastPart = parts.Size();
+		keptPrefixCount = 0;
+		keptSuffixBegin = sections.Size();
+		newParts.Empty();
+		newParts.IncreaseSize( 1 );
+		CFilePart& part = newParts[0];
+		part.End = newLength;
+		part.Chunk.reset( new CMessageFile( fileName, newText, 0, newLength ) );
+		setPartCounts( part );
+	}
+
+	const int keptNamedPrefixCount = getSectionCount( 0, firstPart, true );
+	const int keptNamedSuffixBegin = namedSections.Size() - getSectionCount( lastPart, parts.Size(), true );
+	haveKeysChanged = !haveSameKeys( CArrayView<CMessageSection>( sections.Ptr() + keptPrefixCount, keptSuffixBegin - keptPrefixCount ), newParts, false )
+		|| !haveSameKeys( CArrayView<CMessageSection>( namedSections.Ptr() + keptNamedPrefixCount, keptNamedSuffixBegin - keptNamedPrefixCount ),
+			newParts, true );
+	parsedPartCount = newParts.Size();
+
+	CArray<CMessageSection> newSections;
+	CArray<CMessageSection> newNamedSections;
+	CArray<CFilePart> resultParts;
+	for( int i = 0; i < keptPrefixCount; i++ ) {
+		newSections.Add( move( sections[i] ) );
+	}
+	for( int i = 0; i < keptNamedPrefixCount; i++ ) {
+		newNamedSections.Add( move( namedSections[i] ) );
+	}
+	for( int i = 0; i < firstPart; i++ ) {
+		resultParts.Add( move( parts[i] ) );
+	}
+	for( auto& part : newParts ) {
+		for( auto& section : part.Chunk->sections ) {
+			newSections.Add( move( section ) );
+		}
+		for( auto& section : part.Chunk->namedSections ) {
+			newNamedSections.Add( move( section ) );
+		}
+		part.Chunk->sections.Empty();
+		part.Chunk->namedSections.Empty();
+		resultParts.Add( move( part ) );
+	}
+	for( int i = keptSuffixBegin; i < sections.Size(); i++ ) {
+		newSections.Add( move( sections[i] ) );
+	}
+	for( int i = keptNamedSuffixBegin; i < namedSections.Size(); i++ ) {
+		newNamedSections.Add( move( namedSections[i] ) );
+	}
+	for( int i = lastPart; i < parts.Size(); i++ ) {
+		parts[i].Begin += newLength - oldLength;
+		parts[i].End += newLength - oldLength;
+		resultParts.Add( move( parts[i] ) );
+	}
+
+	sections = move( newSections );
+	namedSections = move( newNamedSections );
+	parts = move( resultParts );
+	text = move( newText );
+	setUpdatedSections( firstPart, firstPart + parsedPartCount );
+	messageCount = 0;
+	totalSize = 0;
+	escapeCount = 0;
+	for( const auto& part : parts ) {
+		messageCount += part.Chunk->messageCount;
+		totalSize += part.Chunk->totalSize;
+		escapeCount += part.Chunk->escapeCount;
+	}
+}
+
+// Parse the text from begin to end in parts that start at sections. Return false if any part fails.
+bool CMessageFile::parseParts( CUnicodeView contents, int begin, int end, const CWorkerPool& workers, CArray<CFilePart>& result ) const
+{
+	if( begin == end ) {
+		return true;
+	}
+	CArray<int> partStarts;
+	findChunkStarts( CUnicodeString( contents.Mid( begin, end - begin ) ), updatePartLength, false, partStarts );
+	result.IncreaseSize( partStarts.Size() );
+	workers.Run( partStarts.Size(), [&]( int partIndex ) {
+		CFilePart& part = result[partIndex];
+		part.Begin = begin + partStarts[partIndex];
+		part.End = partIndex + 1 < partStarts.Size() ? begin + partStarts[partIndex + 1] : end;
+		try {
+			part.Chunk.reset( new CMessageFile( fileName, contents, part.Begin, part.End ) );
+		} catch( CException& ) {
+			// The part stays empty.
+		}
+	} );
+
+	for( auto& part : result ) {
+		if( part.Chunk == nullptr ) {
+			return false;
+		}
+		setPartCounts( part );
+	}
+	return true;
+}
+
+void CMessageFile::setPartCounts( CFilePart& part )
+{
+	part.SectionCount = part.Chunk->sections.Size();
+	part.NamedSectionCount = part.Chunk->namedSections.Size();
+	part.MessageCount = 0;
+	for( const auto& section : part.Chunk->sections ) {
+		part.MessageCount += section.GetKeyValues().Size();
+	}
+	part.NamedMessageCount = 0;
+	for( const auto& section : part.Chunk->namedSections ) {
+		part.NamedMessageCount += section.GetKeyValues().Size();
 	}
 }
 
+int CMessageFile::getSectionCount( int beginPart, int endPart, bool isNamed ) const
+{
+	int result = 0;
+	for( int i = beginPart; i < endPart; i++ ) {
+		result += isNamed ? parts[i].NamedSectionCount : parts[i].SectionCount;
+	}
+	return result;
+}
+
+// The parts from firstPart to endPart have been parsed. Only the counts of the parts are summed, so the cost doesn't depend on the file size.
+void CMessageFile::setUpdatedSections( int firstPart, int endPart )
+{
+	CUpdatedSections unnamed;
+	CUpdatedSections named;
+	named.IsNamed = true;
+	int unnamedMessageCount = 0;
+	for( int i = 0; i < parts.Size(); i++ ) {
+		const CFilePart& part = parts[i];
+		if( i < firstPart ) {
+			unnamed.Begin += part.SectionCount;
+			named.Begin += part.NamedSectionCount;
+			unnamed.FirstMessagePos += part.MessageCount;
+			named.FirstMessagePos += part.NamedMessageCount;
+		} else if( i < endPart ) {
+			unnamed.End += part.SectionCount;
+			named.End += part.NamedSectionCount;
+		}
+		unnamedMessageCount += part.MessageCount;
+	}
+	unnamed.End += unnamed.Begin;
+	named.End += named.Begin;
+	named.FirstMessagePos += unnamedMessageCount;
+	updatedSections.Empty();
+	updatedSections.Add( unnamed );
+	updatedSections.Add( named );
+}
+
+// Sections of a kind in the kept parts and in the parsed parts must have different names, as in a file that is parsed at once.
+bool CMessageFile::hasUniqueSectionNames( int firstPart, int lastPart, CArrayView<CFilePart> newParts, bool isNamed ) const
+{
+	const CArray<CMessageSection>& oldSections = isNamed ? namedSections : sections;
+	const int keptPrefixCount = getSectionCount( 0, firstPart, isNamed );
+	const int keptSuffixBegin = oldSections.Size() - getSectionCount( lastPart, parts.Size(), isNamed );
+	CHashTable<CString> uniqueNames;
+	for( int i = 0; i < oldSections.Size(); i++ ) {
+		if( ( i < keptPrefixCount || i >= keptSuffixBegin ) && !uniqueNames.Set( Str( oldSections[i].GetName() ) ) ) {
+			return false;
+		}
+	}
+	for( const auto& part : newParts ) {
+		for( const auto& section : isNamed ? part.Chunk->namedSections : part.Chunk->sections ) {
+			if( !uniqueNames.Set( Str( section.GetName() ) ) ) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Sections are compared by their names and keys. The values don't matter.
+bool CMessageFile::haveSameKeys( CArrayView<CMessageSection> oldSections, CArrayView<CFilePart> newParts, bool isNamed )
+{
+	int oldPos = 0;
+	for( const auto& part : newParts ) {
+		for( const auto& section : isNamed ? part.Chunk->namedSections : part.Chunk->sections ) {
+			if( oldPos >= oldSections.Size() || !haveSameKeys( oldSections[oldPos], section ) ) {
+				return false;
+			}
+			oldPos++;
+		}
+	}
+	return oldPos == oldSections.Size();
+}
+
+bool CMessageFile::haveSameKeys( const CMessageSection& left, const CMessageSection& right )
+{
+	const auto leftKeys = left.GetKeyNames();
+	const auto rightKeys = right.GetKeyNames();
+	if( left.GetName() != right.GetName() || leftKeys.Size() != rightKeys.Size() ) {
+		return false;
+	}
+	for( int i = 0; i < leftKeys.Size(); i++ ) {
+		if( leftKeys[i] != rightKeys[i] ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Texts are compared in blocks, which is much faster than comparing them character by character.
+static const int compareBlockLength = 256;
+
+int CMessageFile::getCommonPrefixLength( const wchar_t* left, const wchar_t* right, int maxLength )
+{
+	const size_t blockSize = compareBlockLength * sizeof( wchar_t );
+	int result = 0;
+	while( result + compareBlockLength <= maxLength && memcmp( left + result, right + result, blockSize ) == 0 ) {
+		result += compareBlockLength;
+	}
+	while( result < maxLength && left[result] == right[result] ) {
+		result++;
+	}
+	return result;
+}
+
+int CMessageFile::getCommonSuffixLength( const wchar_t* leftEnd, const wchar_t* rightEnd, int maxLength )
+{
+	int result = 0;
+	const size_t blockSize = compareBlockLength * sizeof( wchar_t );
+	while( result + compareBlockLength <= maxLength && memcmp( leftEnd - result - compareBlockLength, rightEnd - result - compareBlockLength, blockSize ) == 0 ) {
+		result += compareBlockLength;
+	}
+	while( result < maxLength && leftEnd[-result - 1] == rightEnd[-result - 1] ) {
+		result++;
+	}
+	return result;
+}
+
 int CMessageFile::skipWhitespaceAndComments( CUnicodeView str, int pos )
 {
 	pos = skipWhitespace( str, pos );
 	while( str[pos] == L';' || ( str[pos] == L'/' && str[pos + 1] == L'/' ) ) {
-		do {
-			pos++;
-		} while( str[pos] != 0 && str[pos] != L'\n' );
+		pos = CCharScanner::FindAnyOf( str.Ptr(), pos + 1, L'\n' );
 		pos = skipWhitespace( str, pos );
 	}
 
@@ -84,21 +559,22 @@ int CMessageFile::skipWhitespaceAndComments( CUnicodeView str, int pos )
 
 int CMessageFile::skipWhitespace( CUnicodeView str, int pos )
 {
+	// Most of the whitespace is ASCII and is skipped in blocks. Other whitespace symbols are checked one by one.
+	pos = CCharScanner::SkipAsciiWhitespace( str.Ptr(), pos );
 	while( CUnicodeString::IsCharWhiteSpace( str[pos] ) ) {
-		pos++;
+		pos = CCharScanner::SkipAsciiWhitespace( str.Ptr(), pos + 1 );
 	}
 
 	return pos;
 }
 
 // Try and get a key-value pair from contents. If contents don't contain a valid pair, return false.
-bool CMessageFile::parseKeyValuePair( CUnicodeView str, int& pos, CUnicodeString& key, CUnicodeString& value ) const
+bool CMessageFile::parseKeyValuePair( CUnicodeView str, int& pos, CUnicodePart& key, CUnicodeString& value )
 {
-	assert( key.IsEmpty() );
 	assert( value.IsEmpty() );
 
-	const int colonIndex = str.Find( L':', pos );
-	if( colonIndex == NotFound || colonIndex == pos ) {
+	const int colonIndex = CCharScanner::FindAnyOf( str.Ptr(), pos, L':' );
+	if( str[colonIndex] == 0 || colonIndex == pos ) {
 		return false;
 	}
 	key = str.Mid( pos, colonIndex - pos );
@@ -107,24 +583,21 @@ bool CMessageFile::parseKeyValuePair( CUnicodeView str, int& pos, CUnicodeString
 	}
 
 	pos = colonIndex;
-	value = parseValueFromString( str, pos );
+	parseValueFromString( str, pos, value );
 	return true;
 }
 
-// Parse a given contents and retrieve the message value from it.
+// Parse a given contents and append the message value to result.
 // The starting point is in contents at index contentPos in position strPos.
-CUnicodeString CMessageFile::parseValueFromString( CUnicodeView contents, int& pos ) const
+void CMessageFile::parseValueFromString( CUnicodeView contents, int& pos, CUnicodeString& result )
 {
-	const bool openQuoteFound = findOpenQuotePos( contents, pos );
-	check( openQuoteFound, Err_BadMessageFile, fileName, pos );
+	if( !findOpenQuotePos( contents, pos ) ) {
+		check( false, Err_BadMessageFile, fileName, getPositionText( pos ) );
+	}
 
-	CUnicodeString result;
 	do {
-		result += parseValueInQuotes( contents, pos );
+		parseValueInQuotes( contents, pos, result );
 	} while( findOpenQuotePos( contents, pos ) );
-	
-	replaceSpecialSymbols( result );
-	return result;
 }
 
 // Search given contents for an open quotation mark. Return a success of the search.
@@ -135,55 +608,56 @@ bool CMessageFile::findOpenQuotePos( CUnicodeView contents, int& pos ) const
 	return contents[pos] == quote;
 }
 
-// Search given contents for a closed quotation mark. Return the string value between the marks.
+// Search given contents for a closed quotation mark. Decode the string value between the marks and append it to result.
+// Text between the special symbols is appended in whole runs, so each character is visited once.
 extern const CError Err_CloseQuoteNotFound( L"A closed quotation mark has not been found in a message file.\nFile name: %0." );
-CUnicodeString CMessageFile::parseValueInQuotes( CUnicodeView contents, int& pos ) const
+void CMessageFile::parseValueInQuotes( CUnicodeView contents, int& pos, CUnicodeString& result )
 {
-	const int startPos = pos + 1;
-	// Search for the quote in a current string.
-	for( pos = contents.Find( quote, startPos ); pos != NotFound; pos = contents.Find( quote, pos + 1 ) ) {
-		// Skip \" symbols.
-		if( pos > 0 && contents[pos - 1] == L'\\' ) {
-			continue;
+	int runStart = pos + 1;
+	for( int i = runStart; ; i++ ) {
+		i = CCharScanner::FindAnyOf( contents.Ptr(), i, quote, L'\\' );
+		const wchar_t ch = contents[i];
+		if( ch == quote ) {
+			// A closed quote is found.
+			result += contents.Mid( runStart, i - runStart );
+			pos = i;
+			return;
+		}
+		if( ch == L'\\' ) {
+			result += contents.Mid( runStart, i - runStart );
+			i++;
+			check( contents[i] != 0, Err_CloseQuoteNotFound, fileName );
+			result += decodeSpecialSymbol( contents[i] );
+			escapeCount++;
+			runStart = i + 1;
+		} else {
+			assert( ch == 0 );
+			check( false, Err_CloseQuoteNotFound, fileName );
 		}
-		// A closed quote is found.
-		return UnicodeStr( contents.Mid( startPos, pos - startPos ) );
 	}
-
-	check( false, Err_CloseQuoteNotFound, fileName );
-	return CUnicodeString();
 }
 
-// Replace all the special symbols in a value string.
+// Get the character that corresponds to a special symbol following a backslash.
 extern const CError Err_InvalidSpecial( L"Message file value contains an invalid special symbol: \\%1.\nFile name: %0." );
-void CMessageFile::replaceSpecialSymbols( CUnicodeString& str ) const
+wchar_t CMessageFile::decodeSpecialSymbol( wchar_t symbol ) const
 {
-	for( int slashPos = str.Find( L'\\' ); slashPos != NotFound; slashPos = str.Find( L'\\', slashPos + 1 )  ) {
-		// This should never happen as it means that value in the original file ends with \" which can't be the end.
-		assert( slashPos + 1 < str.Length() );
-
-		switch( str[slashPos + 1] ) {
-			case L'\\':
-				str.ReplaceAt( slashPos, L'\\', 2 );
-				break;
-			case L'n':
-				str.ReplaceAt( slashPos, L'\n', 2 );
-				break;
-			case L'r':
-				str.ReplaceAt( slashPos, L'\r', 2 );
-				break;
-			case L'\"':
-				str.ReplaceAt( slashPos, L'\"', 2 );
-				break;
-			default:
-				check( false, Err_InvalidSpecial, fileName, UnicodeStr( str[slashPos + 1] ) );
-				break;
-		}
+	switch( symbol ) {
+		case L'\\':
+			return L'\\';
+		case L'n':
+			return L'\n';
+		case L'r':
+			return L'\r';
+		case L'\"':
+			return L'\"';
+		default:
+			check( false, Err_InvalidSpecial, fileName, UnicodeStr( symbol ) );
+			return symbol;
 	}
 }
 
 // Try and get a section name from str. If str doesn't contain a section name, return false.
-bool CMessageFile::parseSection( CUnicodeView str, int& pos, CUnicodeString& section )
+bool CMessageFile::parseSection( CUnicodeView str, int& pos, CUnicodePart& section )
 {
 	if( str[pos] != L'[' ) {
 		return false;
@@ -199,7 +673,7 @@ bool CMessageFile::parseSection( CUnicodeView str, int& pos, CUnicodeString& sec
 	return true;
 }
 
-bool CMessageFile::parseNamedSection( CUnicodeView str, int& pos, CUnicodeString& section )
+bool CMessageFile::parseNamedSection( CUnicodeView str, int& pos, CUnicodePart& section )
 {
 	if( str[pos] != L'{' ) {
 		return false;
@@ -217,22 +691,26 @@ bool CMessageFile::parseNamedSection( CUnicodeView str, int& pos, CUnicodeString
 
 const CError Err_DublicateSection{ L"File contains two sections with the name %1. File name: %0." };
 // Create a section with a given name and return a pointer to it.
-CMessageSection& CMessageFile::createSection( CUnicodeView name )
+CMessageSection& CMessageFile::createSection( CUnicodePart name )
 {
-	check( sectionNames.Set( name ), Err_DublicateSection, fileName, name );
+	check( sectionNames.Set( strings.Add( name ) ), Err_DublicateSection, fileName, name );
+	isLastSectionNamed = false;
 	sections.IncreaseSize( sections.Size() + 1 );
 	sections.Last().SetName( name );
 	return sections.Last();
 }
 
-CMessageSection& CMessageFile::createNamedSection( CUnicodeView name )
+extern const CError Err_DuplicateNamedSection( L"File contains two named sections with the name %1. File name: %0." );
+CMessageSection& CMessageFile::createNamedSection( CUnicodePart name )
 {
+	check( namedSectionNames.Set( strings.Add( name ) ), Err_DuplicateNamedSection, fileName, name );
+	isLastSectionNamed = true;
 	namedSections.IncreaseSize( namedSections.Size() + 1 );
 	namedSections.Last().SetName( name );
 	return namedSections.Last();
 }
 
-bool CMessageFile::checkValidKeyName( CUnicodeView keyName )
+bool CMessageFile::checkValidKeyName( CUnicodePart keyName )
 {
 	assert( !keyName.IsEmpty() );
 	if( !isCharValidVariableSymbol( keyName[0] ) ) {
@@ -255,14 +733,127 @@ bool CMessageFile::isCharValidVariableSymbol( wchar_t ch )
 
 extern const CError Err_UnnamedSection{ L"Key with the name %1 does not belong to a section. File name: %0." };
 extern const CError Err_DuplicateKey{ L"Message section %1 contains two keys with the name %2. File name: %0." };
-void CMessageFile::setNewValue( CMessageSection* section, CUnicodePart key, const CUnicodeString& value )
+void CMessageFile::setNewValue( CMessageSection* section, CUnicodePart key, CUnicodePart value )
 {
 	check( section != nullptr, Err_UnnamedSection, fileName, key );
 	messageCount++;
 	totalSize += value.Length() * sizeof( wchar_t );
 
-	const CUnicodePart pureKey = deleteWhitespace( key );
-	check( section->SetString( pureKey, value ), Err_DuplicateKey, fileName, UnicodeStr( section->GetName() ), key );
+	const CUnicodePart pureKey = strings.Add( deleteWhitespace( key ) );
+	const int paramMask = CMessageParams::GetParamMask( value );
+	check( section->SetString( pureKey, strings.Add( value ), paramMask ), Err_DuplicateKey, fileName, UnicodeStr( section->GetName() ), key );
+}
+
+// Window size of the streaming mode in bytes. A window is parsed up to the last item that starts a line,
+// the rest of it is parsed together with the next window.
+static const int streamWindowSize = 1 << 20;
+// Number of item starts searched for in a window.
+static const int windowItemStartCount = 4;
+// A window that fails to parse is extended up to this number of window sizes before the error is reported.
+static const int maxStreamWindowGrowth = 8;
+
+void CMessageFile::parseStream( CCompileStats* stats, const TMessageValueHandler& valueHandler )
+{
+	CTextFileReader reader( fileName );
+	CUnicodeString window;
+	__int64 windowPosition = 0;
+	__int64 textLength = 0;
+	bool isEndOfFile = false;
+	while( !isEndOfFile || !window.IsEmpty() ) {
+		if( !isEndOfFile ) {
+			CPhaseTimer timer( stats, CP_Read );
+			const int oldLength = window.Length();
+			isEndOfFile = !reader.Read( streamWindowSize, window );
+			textLength += window.Length() - oldLength;
+		}
+
+		CPhaseTimer timer( stats, CP_Parse );
+		const int end = isEndOfFile ? window.Length() : findWindowEnd( window );
+		if( end == 0 ) {
+			// A single item is longer than the window.
+			continue;
+		}
+		std::unique_ptr<CMessageFile> part;
+		try {
+			part.reset( new CMessageFile( fileName, window, 0, end, windowPosition, getLastSection() ) );
+		} catch( CException& ) {
+			// The item search may be misled by unusual section names, so a failed window is extended and parsed again.
+			// An invalid file fails in every extended window, so its error is reported when the window reaches the end of the file
+			// or grows to a few window sizes. That keeps the memory use and the repeated parsing bounded.
+			if( isEndOfFile || window.Length() >= maxStreamWindowGrowth * streamWindowSize ) {
+				throw;
+			}
+			continue;
+		}
+		addStreamedPart( *part, valueHandler );
+		windowPosition += end;
+		window = CUnicodeString( window.Mid( end ) );
+	}
+
+	if( stats != nullptr ) {
+		const int64_t textSize = textLength * sizeof( wchar_t );
+		stats->Phase( CP_Read ).BytesIn = CCompileStats::GetFileSize( fileName );
+		stats->Phase( CP_Read ).BytesOut = textSize;
+		stats->Phase( CP_Parse ).BytesIn = textSize;
+		stats->Phase( CP_Parse ).BytesOut = totalSize;
+	}
+}
+
+// End of the complete items of a window: the last item found at the start of a line. Zero if there is none.
+int CMessageFile::findWindowEnd( CUnicodeView window )
+{
+	CArray<int> itemStarts;
+	findChunkStarts( window, window.Length() / windowItemStartCount + 1, true, itemStarts );
+	const int end = itemStarts.Last();
+	assert( end <= window.Length() );
+	return end;
+}
+
+// Add the keys of a streamed window to the file and pass its values to the handler.
+// Keys of the continued section come first, then the sections of each kind in the file order, so the values of each kind keep the file order.
+void CMessageFile::addStreamedPart( const CMessageFile& part, const TMessageValueHandler& valueHandler )
+{
+	if( !part.continuation.GetKeyNames().IsEmpty() ) {
+		addStreamedKeys( part.continuation, isLastSectionNamed, *getLastSection(), valueHandler );
+	}
+	for( const auto& section : part.sections ) {
+		addStreamedKeys( section, false, createSection( UnicodeStr( section.GetName() ) ), valueHandler );
+	}
+	for( const auto& section : part.namedSections ) {
+		addStreamedKeys( section, true, createNamedSection( UnicodeStr( section.GetName() ) ), valueHandler );
+	}
+	if( !part.sections.IsEmpty() || !part.namedSections.IsEmpty() ) {
+		isLastSectionNamed = part.isLastSectionNamed;
+	}
+	messageCount += part.messageCount;
+	totalSize += part.totalSize;
+	escapeCount += part.escapeCount;
+}
+
+void CMessageFile::addStreamedKeys( const CMessageSection& source, bool isNamedSection, CMessageSection& target, const TMessageValueHandler& valueHandler )
+{
+	const auto keys = source.GetKeyNames();
+	const auto values = source.GetKeyValues();
+	const auto paramMasks = source.GetParamMasks();
+	for( int i = 0; i < keys.Size(); i++ ) {
+		check( target.SetString( strings.Add( keys[i] ), CUnicodePart(), paramMasks[i] ), Err_DuplicateKey, fileName, UnicodeStr( target.GetName() ), keys[i] );
+		valueHandler( isNamedSection, values[i] );
+	}
+}
+
+// Section that the keys at the start of the next streamed window belong to. Null before the first section.
+CMessageSection* CMessageFile::getLastSection()
+{
+	CArray<CMessageSection>& lastSections = isLastSectionNamed ? namedSections : sections;
+	return lastSections.IsEmpty() ? nullptr : &lastSections.Last();
+}
+
+// Positions in the error messages are counted from the start of the file.
+CUnicodeString CMessageFile::getPositionText( int pos ) const
+{
+	char buffer[32];
+	sprintf_s( buffer, "%lld", basePosition + pos );
+	return UnicodeStr( CStringView( buffer ) );
 }
 
 //////////////////////////////////////////////////////////////////////////
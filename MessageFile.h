@@ -1,9 +1,13 @@
 #pragma once
+#include <StringArena.h>
 
 namespace Msg {
 
+class CCompileStats;
+class CWorkerPool;
 //////////////////////////////////////////////////////////////////////////
 // A single section in a .msg file.
+// Keys and values are views of the strings stored in the file arena.
 class CMessageSection {
 public:
 	explicit CMessageSection() = default;
@@ -12,25 +16,30 @@ public:
 	// Section name.
 	CStringView GetName() const
 		{ return name; }
-	void SetName( CUnicodeView newValue )
+	void SetName( CUnicodePart newValue )
 		{ name = Str( newValue ); }
 
-	// Set key value. If the key was already present, do not set the value and return false.
-	bool SetString( CUnicodePart keyName, CUnicodePart newValue );
+	// Set key value and the mask of its parameters. If the key was already present, do not set the value and return false.
+	// The key and the value must outlive the section.
+	bool SetString( CUnicodePart keyName, CUnicodePart newValue, int paramMask );
 
 	// Get all section keys.
-	const CArray<CUnicodeString>& GetKeyNames() const
+	CArrayView<CUnicodePart> GetKeyNames() const
 		{ return keyNames; }
 	// Get all section values.
-	const CArray<CUnicodeString>& GetKeyValues() const
+	CArrayView<CUnicodePart> GetKeyValues() const
 		{ return keyValues; }
+	// Get the parameter masks of all section values. See CMessageParams::GetParamMask.
+	CArrayView<int> GetParamMasks() const
+		{ return paramMasks; }
 
 private:
 	CString name;
-	CArray<CUnicodeString> keyNames;
-	CArray<CUnicodeString> keyValues;
+	CArray<CUnicodePart> keyNames;
+	CArray<CUnicodePart> keyValues;
+	CArray<int> paramMasks;
 	// Set of all keys to ensure that each key is unique.
-	CHashTable<CUnicodeString> uniqueKeys;
+	CHashTable<CUnicodePart> uniqueKeys;
 
 	// Copying is prohibited.
 	CMessageSection( CMessageSection& ) = delete;
@@ -39,23 +48,69 @@ private:
 
 //////////////////////////////////////////////////////////////////////////
 
+// Consecutive sections of a kind that were parsed by an update of a file, and the position of their first message.
+// Message positions follow the file order, where the messages of the unnamed sections come before the messages of the named sections.
+struct CUpdatedSections {
+	bool IsNamed = false;
+	int Begin = 0;
+	int End = 0;
+	int FirstMessagePos = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Receiver of the message values of a file that is parsed in the streaming mode.
+// Values of the unnamed and the named sections come in the file order. The value is valid only during the call.
+typedef std::function<void( bool isNamedSection, CUnicodePart value )> TMessageValueHandler;
+
 // .msg file wrapper.
 // All the message files are divided into sections in brackets or braces.
 // Each section contains a message name and its value in quotes separated by a colon. Example:
 // MessageName: "MessageText"
 // Several values in a row are concatenated.
 // Values can contain a newline escape symbol: "\r\n". This symbol is replaced by an actual newline.
+// Values can contain parameters from %0 to %9. The parameters of every value are collected while the value is parsed.
 // Comments in the file start with either ; or //
 class CMessageFile {
 public:
-	explicit CMessageFile( CUnicodeView fileName );
+	// Reading and parsing are measured if statistics are given.
+	// Large files are split at section boundaries and parsed by the given number of workers. Zero means one worker per hardware thread.
+	// The result is the same as with a single worker.
+	// If a value handler is given, the file is read and parsed serially in windows of a fixed size and only the keys are kept:
+	// every value is passed to the handler and the section values are empty. Memory use doesn't depend on the size of the values.
+	// An updatable file keeps its text and is parsed in parts that start at sections, so that Update parses only the changed parts.
+	explicit CMessageFile( CUnicodeView fileName, CCompileStats* stats = nullptr, int workerCount = 0,
+		const TMessageValueHandler& valueHandler = TMessageValueHandler(), bool isUpdatable = false );
+	// Parse the text of the file that the caller has already read.
+	CMessageFile( CUnicodeView fileName, CUnicodeString text, CCompileStats* stats = nullptr, int workerCount = 0, bool isUpdatable = false );
+
+	CUnicodeView GetFileName() const
+		{ return fileName; }
+
+	// Read an updatable file again after it has changed. Parts whose text hasn't changed are kept without parsing, even if they have moved.
+	// If the new version is invalid, the file is left unchanged.
+	void Update( CCompileStats* stats, int workerCount );
+	// Whether the sections or the keys have changed in the last update. True for a file that hasn't been updated.
+	bool HaveKeysChanged() const
+		{ return haveKeysChanged; }
+	// Number of parts of an updatable file and the number of parts parsed by the last update.
+	int PartCount() const
+		{ return parts.Size(); }
+	int ParsedPartCount() const
+		{ return parsedPartCount; }
+	// Sections of an updatable file that were parsed by the last update. The other sections have the values they had before the update.
+	CArrayView<CUpdatedSections> GetUpdatedSections() const
+		{ return updatedSections; }
 
 	// Total count of all messages.
 	int MessageCount() const
 		{ return messageCount; }
 	// Size of all the messages in bytes.
-	int MessageBinarySize() const
+	__int64 MessageBinarySize() const
 		{ return totalSize; }
+	// Count of the decoded escape sequences.
+	int EscapeCount() const
+		{ return escapeCount; }
 
 	// Enumerate all sections.
 	CArrayView<CMessageSection> GetUnnamedSections() const
@@ -64,36 +119,92 @@ public:
 		{ return namedSections; }
 
 private:
+	// Part of an updatable file. The chunk of the part owns the strings of the part sections.
+	struct CFilePart {
+		int Begin = 0;
+		int End = 0;
+		int SectionCount = 0;
+		int NamedSectionCount = 0;
+		int MessageCount = 0;
+		int NamedMessageCount = 0;
+		std::unique_ptr<CMessageFile> Chunk;
+	};
+
 	// Name of the file.
 	CUnicodeString fileName;
+	// Storage for all the parsed keys, values and section names.
+	CStringArena strings;
 	// List of unnamed sections in the file.
 	CArray<CMessageSection> sections;
 	// List of named sections in the file.
 	CArray<CMessageSection> namedSections;
 	// A set of existing section names to ensure that each section is unique.
-	CHashTable<CUnicodeString> sectionNames;
+	CHashTable<CUnicodePart> sectionNames;
+	// The same for the named sections, which have their own names.
+	CHashTable<CUnicodePart> namedSectionNames;
+	// Chunks of a file that was parsed in parallel. The chunks own the strings of the sections.
+	CArray<std::unique_ptr<CMessageFile>> chunks;
+	// Text of an updatable file.
+	CUnicodeString text;
+	// Parts of an updatable file in the file order.
+	CArray<CFilePart> parts;
+	bool isUpdatable = false;
+	bool haveKeysChanged = true;
+	int parsedPartCount = 0;
+	CArray<CUpdatedSections> updatedSections;
+	// Keys at the start of a streamed window that belong to the last section of the previous window.
+	CMessageSection continuation;
+	bool isLastSectionNamed = false;
+	// Position of the parsed text in the file. Non-zero for streamed windows.
+	__int64 basePosition = 0;
 	// Size of all the message values in bytes.
-	int totalSize = 0;
+	__int64 totalSize = 0;
 	// Count of all the messages in the file.
 	int messageCount = 0;
-
-	void parseFile();
+	// Count of the escape sequences in all the values.
+	int escapeCount = 0;
+
+	CMessageFile( CUnicodeView fileName, CUnicodeView contents, int begin, int end, __int64 basePosition = 0,
+		const CMessageSection* continuedSection = nullptr );
+
+	void parseFile( CCompileStats* stats, int workerCount );
+	void parseText( CUnicodeString& fileStr, CCompileStats* stats, int workerCount );
+	void addParseStats( CCompileStats* stats, int length ) const;
+	static void findChunkStarts( CUnicodeView str, int chunkLength, bool acceptsKeys, CArray<int>& result );
+	bool parseChunks( CUnicodeView contents, CArrayView<int> chunkStarts, const CWorkerPool& workers );
+	int parseRange( CUnicodeView contents, int begin, int end, CMessageSection* currentSection );
+	void updateParts( CUnicodeString& newText, const CWorkerPool& workers );
+	bool parseParts( CUnicodeView contents, int begin, int end, const CWorkerPool& workers, CArray<CFilePart>& result ) const;
+	static void setPartCounts( CFilePart& part );
+	int getSectionCount( int beginPart, int endPart, bool isNamed ) const;
+	void setUpdatedSections( int firstPart, int endPart );
+	bool hasUniqueSectionNames( int firstPart, int lastPart, CArrayView<CFilePart> newParts, bool isNamed ) const;
+	static bool haveSameKeys( CArrayView<CMessageSection> oldSections, CArrayView<CFilePart> newParts, bool isNamed );
+	static bool haveSameKeys( const CMessageSection& left, const CMessageSection& right );
+	static int getCommonPrefixLength( const wchar_t* left, const wchar_t* right, int maxLength );
+	static int getCommonSuffixLength( const wchar_t* leftEnd, const wchar_t* rightEnd, int maxLength );
+	void parseStream( CCompileStats* stats, const TMessageValueHandler& valueHandler );
+	static int findWindowEnd( CUnicodeView window );
+	void addStreamedPart( const CMessageFile& part, const TMessageValueHandler& valueHandler );
+	void addStreamedKeys( const CMessageSection& source, bool isNamedSection, CMessageSection& target, const TMessageValueHandler& valueHandler );
+	CMessageSection* getLastSection();
+	CUnicodeString getPositionText( int pos ) const;
 	static int skipWhitespace( CUnicodeView str, int pos );
 	static int skipWhitespaceAndComments( CUnicodeView str, int pos );
-	bool parseKeyValuePair( CUnicodeView contents, int& pos, CUnicodeString& key, CUnicodeString& value ) const;
-	CUnicodeString parseValueFromString( CUnicodeView contents, int& pos ) const;
+	bool parseKeyValuePair( CUnicodeView contents, int& pos, CUnicodePart& key, CUnicodeString& value );
+	void parseValueFromString( CUnicodeView contents, int& pos, CUnicodeString& result );
 	bool findOpenQuotePos( CUnicodeView contents, int& pos ) const;
-	CUnicodeString parseValueInQuotes( CUnicodeView contents, int& pos ) const;
+	void parseValueInQuotes( CUnicodeView contents, int& pos, CUnicodeString& result );
+	wchar_t decodeSpecialSymbol( wchar_t symbol ) const;
 
-	void setNewValue( CMessageSection* section, CUnicodePart key, const CUnicodeString& value );
+	void setNewValue( CMessageSection* section, CUnicodePart key, CUnicodePart value );
 
-	void replaceSpecialSymbols( CUnicodeString& str ) const;
-	static bool parseSection( CUnicodeView str, int& pos, CUnicodeString& section );
-	static bool parseNamedSection( CUnicodeView str, int& pos, CUnicodeString& section );
-	CMessageSection& createSection( CUnicodeView name );
-	CMessageSection& createNamedSection( CUnicodeView name );
+	static bool parseSection( CUnicodeView str, int& pos, CUnicodePart& section );
+	static bool parseNamedSection( CUnicodeView str, int& pos, CUnicodePart& section );
+	CMessageSection& createSection( CUnicodePart name );
+	CMessageSection& createNamedSection( CUnicodePart name );
 
-	static bool checkValidKeyName( CUnicodeView keyName );
+	static bool checkValidKeyName( CUnicodePart keyName );
 	static bool isCharValidVariableSymbol( wchar_t ch );
 };
 
@@ -0,0 +1,259 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageIdMap.h>
+#include <MessageFile.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+static const CUnicodeView entryTypeNames[] = { L"section", L"message" };
+static const CUnicodeView removedMark = L"removed";
+static const wchar_t fieldSeparator = L'|';
+
+void CMessageIdMap::Load( CUnicodeView fileName )
+{
+	if( !FileSystem::FileExists( fileName ) ) {
+		return;
+	}
+
+	const CUnicodeString contents = File::ReadUnicodeText( fileName );
+	const int length = contents.Length();
+	for( int lineStart = 0; lineStart < length; ) {
+		int lineEnd = contents.Find( L'\n', lineStart );
+		if( lineEnd == NotFound ) {
+			lineEnd = length;
+		}
+		const CUnicodePart line = contents.Mid( lineStart, lineEnd - lineStart ).TrimSpaces();
+		lineStart = lineEnd + 1;
+
+		if( !line.IsEmpty() && line[0] != L';' ) {
+			parseLine( fileName, line );
+		}
+	}
+	for( const auto& space : spaces ) {
+		checkUniqueIds( fileName, space );
+	}
+}
+
+void CMessageIdMap::Empty()
+{
+	for( auto& space : spaces ) {
+		space.Entries.Empty();
+		space.NamePositions.Empty();
+		space.IdLimit = 0;
+	}
+}
+
+extern const CError Err_BadIdMapLine( L"Invalid ID map line. Expected format: <section|message>|<ID>|<name>[|removed].\nFile name: %0. Line: %1." );
+void CMessageIdMap::parseLine( CUnicodeView fileName, CUnicodePart line )
+{
+	const int typeEnd = line.Find( fieldSeparator );
+	check( typeEnd != NotFound, Err_BadIdMapLine, fileName, line );
+	const int idEnd = line.Find( fieldSeparator, typeEnd + 1 );
+	check( idEnd != NotFound, Err_BadIdMapLine, fileName, line );
+	int nameEnd = line.Find( fieldSeparator, idEnd + 1 );
+	const bool isRemoved = nameEnd != NotFound;
+	if( nameEnd == NotFound ) {
+		nameEnd = line.Length();
+	} else {
+		check( line.Mid( nameEnd + 1 ) == removedMark, Err_BadIdMapLine, fileName, line );
+	}
+
+	const CUnicodePart typeName = line.Mid( 0, typeEnd );
+	int type = 0;
+	while( type < ET_Count && typeName != entryTypeNames[type] ) {
+		type++;
+	}
+	check( type < ET_Count, Err_BadIdMapLine, fileName, line );
+
+	const CUnicodePart idStr = line.Mid( typeEnd + 1, idEnd - typeEnd - 1 );
+	check( !idStr.IsEmpty() && idStr.Length() < 10, Err_BadIdMapLine, fileName, line );
+	int id = 0;
+	for( int i = 0; i < idStr.Length(); i++ ) {
+		check( CUnicodeString::IsCharDigit( idStr[i] ), Err_BadIdMapLine, fileName, line );
+		id = id * 10 + ( idStr[i] - L'0' );
+	}
+
+	const CUnicodePart name = line.Mid( idEnd + 1, nameEnd - idEnd - 1 );
+	check( !name.IsEmpty(), Err_BadIdMapLine, fileName, line );
+	addEntry( static_cast<TEntryType>( type ), Str( name ), id, isRemoved );
+}
+
+extern const CError Err_DuplicateIdMapEntry( L"ID map contains two entries with the same name: %0." );
+void CMessageIdMap::addEntry( TEntryType type, const CString& name, int id, bool isRemoved )
+{
+	CIdSpace& space = spaces[type];
+	check( space.NamePositions.Get( name ) == nullptr, Err_DuplicateIdMapEntry, name );
+	space.NamePositions.Add( name, space.Entries.Size() );
+	space.Entries.IncreaseSize( space.Entries.Size() + 1 );
+	CEntry& entry = space.Entries.Last();
+	entry.Name = name;
+	entry.Id = id;
+	entry.IsRemoved = isRemoved;
+	if( id >= space.IdLimit ) {
+		space.IdLimit = id + 1;
+	}
+}
+
+extern const CError Err_DuplicateIdMapId( L"ID map gives the same ID to several names.\nFile name: %0. ID: %1." );
+void CMessageIdMap::checkUniqueIds( CUnicodeView fileName, const CIdSpace& space )
+{
+	const auto entries = getSortedEntries( space );
+	for( int i = 1; i < entries.Size(); i++ ) {
+		check( entries[i]->Id != entries[i - 1]->Id, Err_DuplicateIdMapId, fileName, entries[i]->Id );
+	}
+}
+
+static const CStringView idMapHeader = "; Message ID map. Generated by MessageCompiler, keep it together with the message file.\r\n";
+static const CStringView entryTemplate = "%0|%1|%2\r\n";
+static const CStringView removedEntryTemplate = "%0|%1|%2|removed\r\n";
+CString CMessageIdMap::CreateFileText() const
+{
+	CString result = Str( idMapHeader );
+	for( int type = 0; type < ET_Count; type++ ) {
+		const CString typeName = Str( entryTypeNames[type] );
+		for( const CEntry* entry : getSortedEntries( spaces[type] ) ) {
+			const CStringView lineTemplate = entry->IsRemoved ? removedEntryTemplate : entryTemplate;
+			result += lineTemplate.SubstParam( typeName, entry->Id, entry->Name );
+		}
+	}
+	return result;
+}
+
+// Entries sorted by their IDs. Sorted output keeps the map file diffs small.
+CArray<const CMessageIdMap::CEntry*> CMessageIdMap::getSortedEntries( const CIdSpace& space )
+{
+	CArray<const CEntry*> result;
+	result.ReserveBuffer( space.Entries.Size() );
+	for( const auto& entry : space.Entries ) {
+		result.Add( &entry );
+	}
+	std::sort( result.begin(), result.end(), []( const CEntry* left, const CEntry* right ) { return left->Id < right->Id; } );
+	return result;
+}
+
+// All the names are acquired in the enumeration order, so an empty map gives positional IDs.
+void CMessageIdMap::Update( const CMessageFile& file, bool compact, CMessageIds& result )
+{
+	for( auto& space : spaces ) {
+		for( auto& entry : space.Entries ) {
+			entry.IsRemoved = true;
+		}
+	}
+
+	for( const auto& section : file.GetUnnamedSections() ) {
+		if( !section.GetName().IsEmpty() ) {
+			acquireId( ET_Section, getSectionEntryName( section.GetName(), false ) );
+		}
+	}
+	for( const auto& section : file.GetNamedSections() ) {
+		acquireId( ET_Section, getSectionEntryName( section.GetName(), true ) );
+	}
+	for( const auto& section : file.GetUnnamedSections() ) {
+		for( const auto& key : section.GetKeyNames() ) {
+			acquireId( ET_Message, GetMessageEntryName( section.GetName(), false, key ) );
+		}
+	}
+	for( const auto& section : file.GetNamedSections() ) {
+		for( const auto& key : section.GetKeyNames() ) {
+			acquireId( ET_Message, GetMessageEntryName( section.GetName(), true, key ) );
+		}
+	}
+
+	if( compact ) {
+		for( auto& space : spaces ) {
+			compactSpace( space );
+		}
+	}
+	fillResult( file, result );
+}
+
+extern const CError Err_DuplicateIdMapName( L"Message file gives two %0 entries the name %1, so they can't get separate IDs." );
+extern const CError Err_BadIdMapName( L"Name %0 can't be stored in the ID map, because it contains the | separator." );
+// Every entry is marked as removed before the update, so an entry that is already in use has been acquired twice.
+int CMessageIdMap::acquireId( TEntryType type, const CString& name )
+{
+	check( name.Find( static_cast<char>( fieldSeparator ) ) == NotFound, Err_BadIdMapName, name );
+	CIdSpace& space = spaces[type];
+	const int* position = space.NamePositions.Get( name );
+	if( position != nullptr ) {
+		CEntry& entry = space.Entries[*position];
+		check( entry.IsRemoved, Err_DuplicateIdMapName, entryTypeNames[type], name );
+		entry.IsRemoved = false;
+		return entry.Id;
+	}
+	const int id = space.IdLimit;
+	addEntry( type, name, id, false );
+	return id;
+}
+
+// Remove the tombstones and give the remaining names consecutive IDs in their current order.
+void CMessageIdMap::compactSpace( CIdSpace& space )
+{
+	CArray<CEntry> entries;
+	space.NamePositions.Empty();
+	for( const CEntry* entry : getSortedEntries( space ) ) {
+		if( !entry->IsRemoved ) {
+			space.NamePositions.Add( entry->Name, entries.Size() );
+			entries.IncreaseSize( entries.Size() + 1 );
+			entries.Last().Name = entry->Name;
+			entries.Last().Id = entries.Size() - 1;
+		}
+	}
+	space.Entries = move( entries );
+	space.IdLimit = space.Entries.Size();
+}
+
+void CMessageIdMap::fillResult( const CMessageFile& file, CMessageIds& result ) const
+{
+	result.SectionIds.Empty();
+	result.MessageIds.Empty();
+	result.SectionIdLimit = spaces[ET_Section].IdLimit;
+	result.MessageIdLimit = spaces[ET_Message].IdLimit;
+
+	for( const auto& section : file.GetUnnamedSections() ) {
+		if( !section.GetName().IsEmpty() ) {
+			result.SectionIds.Add( getId( ET_Section, getSectionEntryName( section.GetName(), false ) ) );
+		}
+	}
+	for( const auto& section : file.GetNamedSections() ) {
+		result.SectionIds.Add( getId( ET_Section, getSectionEntryName( section.GetName(), true ) ) );
+	}
+	result.MessageIds.ReserveBuffer( file.MessageCount() );
+	for( const auto& section : file.GetUnnamedSections() ) {
+		for( const auto& key : section.GetKeyNames() ) {
+			result.MessageIds.Add( getId( ET_Message, GetMessageEntryName( section.GetName(), false, key ) ) );
+		}
+	}
+	for( const auto& section : file.GetNamedSections() ) {
+		for( const auto& key : section.GetKeyNames() ) {
+			result.MessageIds.Add( getId( ET_Message, GetMessageEntryName( section.GetName(), true, key ) ) );
+		}
+	}
+}
+
+int CMessageIdMap::getId( TEntryType type, const CString& name ) const
+{
+	const CIdSpace& space = spaces[type];
+	const int* position = space.NamePositions.Get( name );
+	assert( position != nullptr );
+	return space.Entries[*position].Id;
+}
+
+static const CStringView unnamedSectionTemplate = "[%0]";
+static const CStringView namedSectionTemplate = "{%0}";
+CString CMessageIdMap::getSectionEntryName( CStringPart sectionName, bool isNamed )
+{
+	return ( isNamed ? namedSectionTemplate : unnamedSectionTemplate ).SubstParam( sectionName );
+}
+
+CString CMessageIdMap::GetMessageEntryName( CStringPart sectionName, bool isNamed, CUnicodePart key )
+{
+	return getSectionEntryName( sectionName, isNamed ) + Str( key );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,79 @@
+#pragma once
+
+namespace Msg {
+
+class CMessageFile;
+//////////////////////////////////////////////////////////////////////////
+
+// IDs of the sections and messages of a message file.
+// Sections are enumerated as in the generated code: unnamed sections that have a name, then named sections.
+// Messages are enumerated in the file order of the unnamed sections, then the named sections.
+struct CMessageIds {
+	CArray<int> SectionIds;
+	CArray<int> MessageIds;
+	// All the IDs are less than the limits. IDs below a limit that are not given to anything are holes.
+	int SectionIdLimit = 0;
+	int MessageIdLimit = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Persistent assignment of section and message IDs.
+// Known names keep their IDs between compilations, new names get IDs after the largest known ID.
+// IDs of the removed names are kept as tombstones and are given back if the name reappears.
+// Tombstones are deleted and the remaining IDs are renumbered only when the map is compacted.
+// An empty map gives the positional IDs that are used without a map file.
+// File format: one entry per line, <section|message>|<ID>|<name>[|removed]. Lines starting with ; are comments.
+// Section names are enclosed in brackets or braces according to the section type. Message names are prefixed with the section name.
+class CMessageIdMap {
+public:
+	// Read entries from a file and add them to the map. A missing file gives no entries.
+	void Load( CUnicodeView fileName );
+	// Remove all the entries.
+	void Empty();
+	// Create the map file contents.
+	CString CreateFileText() const;
+
+	// Give IDs to every section and message of the file. Names that are absent from the file become tombstones.
+	void Update( const CMessageFile& file, bool compact, CMessageIds& result );
+
+	// Name of a message in the map file. It identifies the message among the messages of all the sections.
+	static CString GetMessageEntryName( CStringPart sectionName, bool isNamed, CUnicodePart key );
+
+private:
+	enum TEntryType {
+		ET_Section,
+		ET_Message,
+		ET_Count
+	};
+
+	struct CEntry {
+		CString Name;
+		int Id = 0;
+		bool IsRemoved = false;
+	};
+
+	// Entries of a single type.
+	struct CIdSpace {
+		CArray<CEntry> Entries;
+		// Entry positions by name.
+		CMap<CString, int> NamePositions;
+		int IdLimit = 0;
+	};
+
+	CIdSpace spaces[ET_Count];
+
+	void parseLine( CUnicodeView fileName, CUnicodePart line );
+	void addEntry( TEntryType type, const CString& name, int id, bool isRemoved );
+	static void checkUniqueIds( CUnicodeView fileName, const CIdSpace& space );
+	static CArray<const CEntry*> getSortedEntries( const CIdSpace& space );
+	int acquireId( TEntryType type, const CString& name );
+	static void compactSpace( CIdSpace& space );
+	void fillResult( const CMessageFile& file, CMessageIds& result ) const;
+	int getId( TEntryType type, const CString& name ) const;
+	static CString getSectionEntryName( CStringPart sectionName, bool isNamed );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
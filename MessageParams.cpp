@@ -0,0 +1,124 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageParams.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+int CMessageParams::GetParamMask( CUnicodePart value )
+{
+	int result = 0;
+	for( int pos = value.Find( L'%' ); pos != NotFound; pos = value.Find( L'%', pos + 1 ) ) {
+		if( isParamAt( value, pos ) ) {
+			result |= 1 << ( value[pos + 1] - L'0' );
+		}
+	}
+	return result;
+}
+
+// Parameters without gaps give a mask of consecutive low bits.
+int CMessageParams::GetParamCount( int paramMask )
+{
+	if( ( paramMask & ( paramMask + 1 ) ) != 0 ) {
+		return NotFound;
+	}
+	int result = 0;
+	for( ; paramMask != 0; paramMask >>= 1 ) {
+		result++;
+	}
+	return result;
+}
+
+CMessageParamEntry CMessageParams::AddSegments( CUnicodePart value, CArray<CMessageSegment>& segments )
+{
+	CMessageParamEntry result{};
+	result.FirstSegment = segments.Size();
+	int spanStart = 0;
+	for( int pos = value.Find( L'%' ); pos != NotFound; pos = value.Find( L'%', pos + 1 ) ) {
+		if( isParamAt( value, pos ) ) {
+			addLiteral( spanStart, pos - spanStart, result, segments );
+			CMessageSegment slot;
+			slot.Start = value[pos + 1] - L'0';
+			slot.Length = MessageParamSlot;
+			segments.Add( slot );
+			result.SegmentCount++;
+			result.ParamCount = std::max( result.ParamCount, slot.Start + 1 );
+			spanStart = pos + 2;
+			pos++;
+		}
+	}
+	if( result.SegmentCount == 0 ) {
+		result.LiteralLength = value.Length();
+		return result;
+	}
+	addLiteral( spanStart, value.Length() - spanStart, result, segments );
+	return result;
+}
+
+bool CMessageParams::isParamAt( CUnicodePart value, int pos )
+{
+	return pos + 1 < value.Length() && value[pos + 1] >= L'0' && value[pos + 1] <= L'9';
+}
+
+// Empty spans are skipped.
+void CMessageParams::addLiteral( int start, int length, CMessageParamEntry& entry, CArray<CMessageSegment>& segments )
+{
+	if( length == 0 ) {
+		return;
+	}
+	CMessageSegment span;
+	span.Start = start;
+	span.Length = length;
+	segments.Add( span );
+	entry.SegmentCount++;
+	entry.LiteralLength += length;
+}
+
+int CMessageParams::GetFormattedLength( CUnicodePart message, const CMessageParamEntry& entry, const CMessageSegment* segments,
+	CArrayView<CUnicodePart> params )
+{
+	int result = entry.SegmentCount == 0 ? message.Length() : entry.LiteralLength;
+	for( uint32_t i = 0; i < entry.SegmentCount; i++ ) {
+		const CMessageSegment& segment = segments[entry.FirstSegment + i];
+		if( segment.Length == MessageParamSlot ) {
+			result += getSegmentText( message, segment, params ).Length();
+		}
+	}
+	return result;
+}
+
+// The result is a sequence of copies.
+void CMessageParams::Format( CUnicodePart message, const CMessageParamEntry& entry, const CMessageSegment* segments,
+	CArrayView<CUnicodePart> params, wchar_t* buffer )
+{
+	if( entry.SegmentCount == 0 ) {
+		memcpy( buffer, message.Ptr(), message.Length() * sizeof( wchar_t ) );
+		buffer[message.Length()] = 0;
+		return;
+	}
+	wchar_t* end = buffer;
+	for( uint32_t i = 0; i < entry.SegmentCount; i++ ) {
+		const CUnicodePart text = getSegmentText( message, segments[entry.FirstSegment + i], params );
+		memcpy( end, text.Ptr(), text.Length() * sizeof( wchar_t ) );
+		end += text.Length();
+	}
+	*end = 0;
+}
+
+extern const CError Err_BadMessageSegment( L"Precompiled message parameters don't match the message." );
+// Spans are checked against the message, because the message length of a UTF-8 table is known only after decoding.
+CUnicodePart CMessageParams::getSegmentText( CUnicodePart message, const CMessageSegment& segment, CArrayView<CUnicodePart> params )
+{
+	if( segment.Length == MessageParamSlot ) {
+		return static_cast<int>( segment.Start ) < params.Size() ? params[segment.Start] : CUnicodePart();
+	}
+	const uint32_t length = message.Length();
+	check( segment.Start <= length && segment.Length <= length - segment.Start, Err_BadMessageSegment );
+	return CUnicodePart( message.Ptr() + segment.Start, segment.Length );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,38 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Parameters of the message values. A parameter is a percent sign followed by a decimal digit, the form that SubstParam substitutes.
+// A precompiled message is split into literal spans and parameter slots, so formatting copies the spans without scanning the text.
+class CMessageParams {
+public:
+	// Largest number of parameters of a message.
+	static const int MaxParamCount = 10;
+
+	// Mask of the parameters used in a value. Bit i is set if the value contains parameter i.
+	static int GetParamMask( CUnicodePart value );
+	// Number of parameters of a mask. NotFound if the parameters don't start from zero or have gaps.
+	static int GetParamCount( int paramMask );
+
+	// Split a value into segments and append them to the segment table. A value without parameters gets no segments.
+	static CMessageParamEntry AddSegments( CUnicodePart value, CArray<CMessageSegment>& segments );
+
+	// Length of a message with the parameters substituted. Missing parameters are empty.
+	static int GetFormattedLength( CUnicodePart message, const CMessageParamEntry& entry, const CMessageSegment* segments,
+		CArrayView<CUnicodePart> params );
+	// Substitute the parameters. The buffer must have room for the formatted length and the terminating null.
+	static void Format( CUnicodePart message, const CMessageParamEntry& entry, const CMessageSegment* segments,
+		CArrayView<CUnicodePart> params, wchar_t* buffer );
+
+private:
+	static bool isParamAt( CUnicodePart value, int pos );
+	static void addLiteral( int start, int length, CMessageParamEntry& entry, CArray<CMessageSegment>& segments );
+	static CUnicodePart getSegmentText( CUnicodePart message, const CMessageSegment& segment, CArrayView<CUnicodePart> params );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,257 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageReader.h>
+#include <MessageParams.h>
+#include <MessageDelta.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+CMessageReader::CMessageReader( CUnicodeView fileName ) :
+	file( fileName ),
+	table( file.Data(), file.Size() ),
+	locale( 0 ),
+	patches( nullptr ),
+	tableHash( table.TableHash() )
+{
+	if( table.Encoding() == MTE_Utf8 ) {
+		const int localeCount = table.LocaleCount();
+		decodedStrings.reset( new std::atomic<std::atomic<CDecodedString*>*>[localeCount] );
+		for( int i = 0; i < localeCount; i++ ) {
+			decodedStrings[i].store( nullptr, std::memory_order_relaxed );
+		}
+	}
+}
+
+CMessageReader::~CMessageReader()
+{
+	if( decodedStrings == nullptr ) {
+		return;
+	}
+	for( int localeId = 0; localeId < table.LocaleCount(); localeId++ ) {
+		std::atomic<CDecodedString*>* strings = decodedStrings[localeId].load( std::memory_order_relaxed );
+		if( strings != nullptr ) {
+			for( int i = 0; i < table.MessageCount(); i++ ) {
+				delete strings[i].load( std::memory_order_relaxed );
+			}
+			delete[] strings;
+		}
+	}
+}
+
+int CMessageReader::MessageCount() const
+{
+	const CPatchTable* current = patches.load( std::memory_order_acquire );
+	return current == nullptr ? table.MessageCount() : current->MessageCount;
+}
+
+void CMessageReader::SetLocale( int localeId )
+{
+	assert( localeId >= 0 && localeId < LocaleCount() );
+	locale.store( localeId, std::memory_order_relaxed );
+}
+
+// The locale is read once, so the string and its decoded copy belong to the same locale.
+CUnicodePart CMessageReader::GetString( int messageId ) const
+{
+	assert( messageId >= 0 && messageId < MessageCount() );
+	return getString( messageId, GetLocale() );
+}
+
+// The message and its segments are taken from the same locale and version. Formatting doesn't allocate once the buffer is large enough.
+int CMessageReader::Format( int messageId, CArrayView<CUnicodePart> params, CArray<wchar_t>& buffer ) const
+{
+	assert( HasParams() );
+	assert( messageId >= 0 && messageId < MessageCount() );
+	const int localeId = GetLocale();
+	const CPatchedString* patched = findPatch( messageId, localeId );
+	const CUnicodePart message = patched != nullptr ? CUnicodePart( patched->Text.get(), patched->Length ) : getTableString( messageId, localeId );
+	const CMessageParamEntry& entry = patched != nullptr ? patched->ParamEntry : table.GetParamEntry( messageId, localeId );
+	const CMessageSegment* segments = patched != nullptr ? patched->Segments.Ptr() : table.Segments();
+	const int length = CMessageParams::GetFormattedLength( message, entry, segments, params );
+	if( buffer.Size() <= length ) {
+		buffer.IncreaseSize( length + 1 );
+	}
+	CMessageParams::Format( message, entry, segments, params, buffer.Ptr() );
+	return length;
+}
+
+CUnicodeString CMessageReader::Format( int messageId, CArrayView<CUnicodePart> params ) const
+{
+	CArray<wchar_t> buffer;
+	const int length = Format( messageId, params, buffer );
+	return UnicodeStr( CUnicodePart( buffer.Ptr(), length ) );
+}
+
+CUnicodePart CMessageReader::getString( int messageId, int localeId ) const
+{
+	const CPatchedString* patched = findPatch( messageId, localeId );
+	if( patched != nullptr ) {
+		return CUnicodePart( patched->Text.get(), patched->Length );
+	}
+	return getTableString( messageId, localeId );
+}
+
+// Messages beyond the table are added by deltas, so they are always replaced.
+CUnicodePart CMessageReader::getTableString( int messageId, int localeId ) const
+{
+	assert( messageId < table.MessageCount() );
+	if( table.Encoding() == MTE_Wide ) {
+		return table.GetString( messageId, localeId );
+	}
+	const CDecodedString& decoded = getDecodedString( messageId, localeId );
+	return CUnicodePart( decoded.Text.get(), decoded.Length );
+}
+
+bool CMessageReader::FindString( CUnicodePart section, CUnicodePart key, CUnicodePart& result ) const
+{
+	const int sectionId = FindSection( section );
+	if( sectionId == NotFound ) {
+		return false;
+	}
+	const int messageId = FindMessage( sectionId, key );
+	if( messageId == NotFound ) {
+		return false;
+	}
+	result = GetString( messageId );
+	return true;
+}
+
+// The name indices still have the keys of removed messages, so the removal is checked in the replaced messages.
+int CMessageReader::FindMessage( int sectionId, CUnicodePart key ) const
+{
+	const int messageId = table.FindMessage( sectionId, key );
+	if( messageId == NotFound ) {
+		return NotFound;
+	}
+	const CPatchedString* patched = findPatch( messageId, GetLocale() );
+	return patched != nullptr && patched->IsRemoved ? NotFound : messageId;
+}
+
+extern const CError Err_DeltaBaseMismatch( L"Message table delta was created for another version of the table.\nDelta name: %0." );
+// The replaced messages are created before anything is published, so a failure leaves the reader unchanged.
+// A new patch table is published after it is filled, so a lookup that sees the new message count finds the added messages.
+void CMessageReader::ApplyDelta( CUnicodeView deltaName )
+{
+	const CMappedFile deltaFile( deltaName );
+	const CMessageDeltaView delta( deltaFile.Data(), deltaFile.Size() );
+	check( delta.BaseHash() == tableHash && delta.LocaleCount() == LocaleCount(), Err_DeltaBaseMismatch, deltaName );
+	CArray<std::unique_ptr<CPatchedString>> newStrings;
+	newStrings.IncreaseSize( delta.ChangeCount() );
+	for( int i = 0; i < delta.ChangeCount(); i++ ) {
+		newStrings[i] = createPatchedString( delta.DecodeValue( i ), delta.GetChange( i ).Change == MDC_Removed );
+	}
+
+	const CPatchTable* current = patches.load( std::memory_order_relaxed );
+	std::unique_ptr<CPatchTable> newTable;
+	if( current == nullptr || delta.MessageCount() > current->MessageCount ) {
+		newTable = createPatchTable( std::max( MessageCount(), delta.MessageCount() ) );
+	}
+	const CPatchTable& target = newTable != nullptr ? *newTable : *current;
+	for( int i = 0; i < delta.ChangeCount(); i++ ) {
+		const CMessageDeltaChange& change = delta.GetChange( i );
+		const size_t slot = static_cast<size_t>( change.LocaleId ) * target.MessageCount + change.MessageId;
+		target.Strings[slot].store( newStrings[i].get(), std::memory_order_release );
+	}
+	if( newTable != nullptr ) {
+		patches.store( newTable.get(), std::memory_order_release );
+		patchTables.Add( move( newTable ) );
+	}
+	for( auto& str : newStrings ) {
+		patchedStrings.Add( move( str ) );
+	}
+	tableHash = delta.TargetHash();
+}
+
+const CMessageReader::CPatchedString* CMessageReader::findPatch( int messageId, int localeId ) const
+{
+	const CPatchTable* current = patches.load( std::memory_order_acquire );
+	if( current == nullptr ) {
+		return nullptr;
+	}
+	return current->Strings[static_cast<size_t>( localeId ) * current->MessageCount + messageId].load( std::memory_order_acquire );
+}
+
+// Parameters of a replaced message are split into segments of its own.
+std::unique_ptr<CMessageReader::CPatchedString> CMessageReader::createPatchedString( CUnicodePart text, bool isRemoved ) const
+{
+	std::unique_ptr<CPatchedString> result( new CPatchedString );
+	result->IsRemoved = isRemoved;
+	result->Length = text.Length();
+	result->Text.reset( new wchar_t[result->Length + 1] );
+	memcpy( result->Text.get(), text.Ptr(), result->Length * sizeof( wchar_t ) );
+	result->Text[result->Length] = 0;
+	if( table.HasParams() ) {
+		result->ParamEntry = CMessageParams::AddSegments( text, result->Segments );
+	}
+	return result;
+}
+
+// The replaced messages of the current table are copied to the new one.
+std::unique_ptr<CMessageReader::CPatchTable> CMessageReader::createPatchTable( int messageCount ) const
+{
+	const CPatchTable* current = patches.load( std::memory_order_relaxed );
+	const int localeCount = LocaleCount();
+	std::unique_ptr<CPatchTable> result( new CPatchTable );
+	result->MessageCount = messageCount;
+	const size_t size = static_cast<size_t>( localeCount ) * messageCount;
+	result->Strings.reset( new std::atomic<const CPatchedString*>[size] );
+	for( size_t i = 0; i < size; i++ ) {
+		result->Strings[i].store( nullptr, std::memory_order_relaxed );
+	}
+	if( current != nullptr ) {
+		for( int localeId = 0; localeId < localeCount; localeId++ ) {
+			for( int messageId = 0; messageId < current->MessageCount; messageId++ ) {
+				const size_t currentSlot = static_cast<size_t>( localeId ) * current->MessageCount + messageId;
+				const size_t slot = static_cast<size_t>( localeId ) * messageCount + messageId;
+				result->Strings[slot].store( current->Strings[currentSlot].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+			}
+		}
+	}
+	return result;
+}
+
+// The cache of a locale is created by the first thread that decodes a message of the locale.
+std::atomic<CMessageReader::CDecodedString*>* CMessageReader::getLocaleStrings( int localeId ) const
+{
+	std::atomic<CDecodedString*>* cached = decodedStrings[localeId].load( std::memory_order_acquire );
+	if( cached != nullptr ) {
+		return cached;
+	}
+
+	const int messageCount = table.MessageCount();
+	std::unique_ptr<std::atomic<CDecodedString*>[]> strings( new std::atomic<CDecodedString*>[messageCount] );
+	for( int i = 0; i < messageCount; i++ ) {
+		strings[i].store( nullptr, std::memory_order_relaxed );
+	}
+	if( decodedStrings[localeId].compare_exchange_strong( cached, strings.get(), std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+		return strings.release();
+	}
+	return cached;
+}
+
+// The first thread that finishes decoding publishes its copy.
+const CMessageReader::CDecodedString& CMessageReader::getDecodedString( int messageId, int localeId ) const
+{
+	std::atomic<CDecodedString*>* strings = getLocaleStrings( localeId );
+	CDecodedString* cached = strings[messageId].load( std::memory_order_acquire );
+	if( cached != nullptr ) {
+		return *cached;
+	}
+
+	const CUnicodeString text = table.DecodeString( messageId, localeId );
+	std::unique_ptr<CDecodedString> decoded( new CDecodedString );
+	decoded->Length = text.Length();
+	decoded->Text.reset( new wchar_t[decoded->Length + 1] );
+	memcpy( decoded->Text.get(), text.Ptr(), ( decoded->Length + 1 ) * sizeof( wchar_t ) );
+	if( strings[messageId].compare_exchange_strong( cached, decoded.get(), std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+		return *decoded.release();
+	}
+	return *cached;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,116 @@
+#pragma once
+#include <MappedFile.h>
+#include <MessageTable.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Reader of a message table file in the mapped format.
+// The file is mapped to memory and nothing is decoded when it is opened. Wide strings of an uncompressed table are returned
+// directly from the mapping. Compressed blocks and UTF-8 strings are decoded on the first access and cached until the reader is destroyed.
+// All the methods are safe to call concurrently and never lock: threads that decode the same string at once race
+// to publish their copies and the losing copies are discarded.
+// A file with several locales returns the strings of the selected locale. Switching the locale is a single atomic store.
+// Deltas replace messages while the reader is used. See ApplyDelta.
+class CMessageReader {
+public:
+	explicit CMessageReader( CUnicodeView fileName );
+	~CMessageReader();
+
+	// Upper bound of the message IDs. Deltas may add IDs.
+	int MessageCount() const;
+	int SectionCount() const
+		{ return table.SectionCount(); }
+	const CMessageTableView& Table() const
+		{ return table; }
+
+	// Number of locales. A file compiled from a single message file has one locale.
+	int LocaleCount() const
+		{ return table.LocaleCount(); }
+	// Find a locale ID by the locale name. Return NotFound if the file has no such locale.
+	int FindLocale( CUnicodePart name ) const
+		{ return table.FindLocale( name ); }
+	// Locale of the returned strings. The reference locale 0 is selected initially.
+	int GetLocale() const
+		{ return locale.load( std::memory_order_relaxed ); }
+	// Select the locale of the returned strings. Lookups that run concurrently with the switch return strings of either locale.
+	void SetLocale( int localeId );
+
+	// Get message text by its ID in the selected locale. The text is null-terminated and stays valid while the reader exists.
+	CUnicodePart GetString( int messageId ) const;
+	// Whether the file has precompiled message parameters.
+	bool HasParams() const
+		{ return table.HasParams(); }
+	// Substitute parameters %0 to %9 in a message of the selected locale. The file must have precompiled parameters.
+	// Missing parameters are empty. The buffer grows if needed and the result is null-terminated. Return the result length.
+	int Format( int messageId, CArrayView<CUnicodePart> params, CArray<wchar_t>& buffer ) const;
+	CUnicodeString Format( int messageId, CArrayView<CUnicodePart> params ) const;
+	// Find a named section ID. Return NotFound if the section doesn't exist.
+	int FindSection( CUnicodePart name ) const
+		{ return table.FindSection( name ); }
+	// Find a message ID in a named section. Return NotFound if the section doesn't contain the key
+	// or a delta has removed the message from the selected locale.
+	int FindMessage( int sectionId, CUnicodePart key ) const;
+	// Find message text by the section name and the key in the selected locale. Return false if the message doesn't exist.
+	bool FindString( CUnicodePart section, CUnicodePart key, CUnicodePart& result ) const;
+
+	// Hash of the table version the reader returns. It changes with every applied delta, so it must be read by the thread
+	// that applies the deltas. See CMessageTableHeader::TableHash.
+	uint64_t TableHash() const
+		{ return tableHash; }
+	// Replace the messages changed by a delta. The delta must have been created from the version the reader returns.
+	// Lookups may run concurrently and return the old or the new value of a message. The strings returned before stay valid.
+	// The first delta and the deltas that add IDs publish a new table of replaced messages with a single atomic store,
+	// which takes time proportional to the message count. Other deltas replace the messages in place.
+	// Deltas must not be applied concurrently. The name indices are not replaced, so the added messages can only be found by ID.
+	// Removed messages are not found by name. Their IDs stay valid and return empty strings.
+	void ApplyDelta( CUnicodeView deltaName );
+
+private:
+	// A message converted to the wide encoding.
+	struct CDecodedString {
+		std::unique_ptr<wchar_t[]> Text;
+		int Length;
+	};
+	// Message replaced by a delta.
+	struct CPatchedString {
+		std::unique_ptr<wchar_t[]> Text;
+		int Length = 0;
+		// Parameters of the message. Empty if the file has no precompiled parameters.
+		CMessageParamEntry ParamEntry{};
+		CArray<CMessageSegment> Segments;
+		// The message is not used by the version of the delta. Its text is empty.
+		bool IsRemoved = false;
+	};
+	// Replaced messages of all the locales, indexed like the entry tables. Messages that haven't been replaced are null.
+	struct CPatchTable {
+		int MessageCount = 0;
+		std::unique_ptr<std::atomic<const CPatchedString*>[]> Strings;
+	};
+
+	CMappedFile file;
+	CMessageTableView table;
+	std::atomic<int> locale;
+	// Decoded UTF-8 messages by locale. Null until a message of the locale is accessed.
+	// Every element is an array of messages that are null until the message is accessed.
+	std::unique_ptr<std::atomic<std::atomic<CDecodedString*>*>[]> decodedStrings;
+	// Null until a delta is applied.
+	std::atomic<const CPatchTable*> patches;
+	uint64_t tableHash;
+	// Every patch table and replaced message. Lookups may still use the replaced ones, so they are kept until the reader is destroyed.
+	CArray<std::unique_ptr<CPatchTable>> patchTables;
+	CArray<std::unique_ptr<CPatchedString>> patchedStrings;
+
+	CUnicodePart getString( int messageId, int localeId ) const;
+	CUnicodePart getTableString( int messageId, int localeId ) const;
+	const CPatchedString* findPatch( int messageId, int localeId ) const;
+	std::unique_ptr<CPatchedString> createPatchedString( CUnicodePart text, bool isRemoved ) const;
+	std::unique_ptr<CPatchTable> createPatchTable( int messageCount ) const;
+	std::atomic<CDecodedString*>* getLocaleStrings( int localeId ) const;
+	const CDecodedString& getDecodedString( int messageId, int localeId ) const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
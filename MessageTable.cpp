@@ -0,0 +1,295 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageTable.h>
+#include <PerfectHash.h>
+#include <LzCodec.h>
+#include <MessageParams.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_BadMessageTable( L"Invalid message table." );
+CMessageTableView::CMessageTableView( const BYTE* _data, __int64 size ) :
+	data( _data ),
+	header( reinterpret_cast<const CMessageTableHeader*>( data ) ),
+	localeCount( 1 ),
+	locales( nullptr ),
+	entries( nullptr ),
+	params( nullptr ),
+	segments( nullptr ),
+	blob( nullptr ),
+	blocks( nullptr )
+{
+	check( data != nullptr && size >= static_cast<__int64>( sizeof( CMessageTableHeader ) ), Err_BadMessageTable );
+	checkTableConsistency( size );
+	if( header->LocaleCount > 0 ) {
+		localeCount = header->LocaleCount;
+		locales = reinterpret_cast<const CMessageTableLocale*>( data + header->LocaleTableOffset );
+	}
+	entries = reinterpret_cast<const CMessageTableEntry*>( data + header->EntryTableOffset );
+	if( header->ParamTableOffset != 0 ) {
+		params = reinterpret_cast<const CMessageParamEntry*>( data + header->ParamTableOffset );
+		segments = reinterpret_cast<const CMessageSegment*>( data + header->SegmentTableOffset );
+	}
+	blob = data + header->BlobOffset;
+	if( header->BlockCount > 0 ) {
+		blocks = reinterpret_cast<const CBlobBlock*>( data + header->BlockTableOffset );
+		checkBlockConsistency();
+		blockCache.reset( new std::atomic<BYTE*>[header->BlockCount] );
+		for( uint32_t i = 0; i < header->BlockCount; i++ ) {
+			blockCache[i].store( nullptr, std::memory_order_relaxed );
+		}
+	}
+}
+
+CMessageTableView::~CMessageTableView()
+{
+	for( uint32_t i = 0; i < header->BlockCount; i++ ) {
+		delete[] blockCache[i].load( std::memory_order_relaxed );
+	}
+}
+
+// Validate the header once so that lookups don't need to check anything.
+// Offsets are compared as unsigned values that can't overflow: every table lies before the blob and the blob lies inside the file.
+void CMessageTableView::checkTableConsistency( __int64 size ) const
+{
+	check( header->Signature == MessageTableSignature && header->Version == MessageTableVersion, Err_BadMessageTable );
+	check( header->Encoding == MTE_Wide || header->Encoding == MTE_Utf8, Err_BadMessageTable );
+	check( static_cast<int>( header->CharSize ) == GetEncodingCharSize( header->Encoding ), Err_BadMessageTable );
+	const uint64_t fileSize = static_cast<uint64_t>( size );
+	check( header->BlobOffset <= fileSize && header->StoredBlobSize <= fileSize - header->BlobOffset, Err_BadMessageTable );
+	check( header->EntryTableOffset <= header->BlobOffset, Err_BadMessageTable );
+	check( header->LocaleCount <= INT_MAX, Err_BadMessageTable );
+	const uint64_t entryCount = header->MessageCount * static_cast<uint64_t>( header->LocaleCount > 0 ? header->LocaleCount : 1 );
+	check( entryCount <= ( header->BlobOffset - header->EntryTableOffset ) / sizeof( CMessageTableEntry ), Err_BadMessageTable );
+	if( header->LocaleCount > 0 ) {
+		check( header->LocaleTableOffset <= header->BlobOffset, Err_BadMessageTable );
+		check( header->LocaleCount * static_cast<uint64_t>( sizeof( CMessageTableLocale ) ) <= header->BlobOffset - header->LocaleTableOffset, Err_BadMessageTable );
+		const auto localeTable = reinterpret_cast<const CMessageTableLocale*>( data + header->LocaleTableOffset );
+		for( uint32_t i = 0; i < header->LocaleCount; i++ ) {
+			check( isStringInBlob( localeTable[i].NameOffset, localeTable[i].NameLength ), Err_BadMessageTable );
+		}
+	}
+	if( header->ParamTableOffset != 0 ) {
+		check( header->ParamTableOffset <= header->BlobOffset && header->SegmentTableOffset <= header->BlobOffset, Err_BadMessageTable );
+		check( entryCount <= ( header->BlobOffset - header->ParamTableOffset ) / sizeof( CMessageParamEntry ), Err_BadMessageTable );
+		check( header->SegmentCount * static_cast<uint64_t>( sizeof( CMessageSegment ) ) <= header->BlobOffset - header->SegmentTableOffset, Err_BadMessageTable );
+		check( header->MaxParamCount <= static_cast<uint32_t>( CMessageParams::MaxParamCount ), Err_BadMessageTable );
+	}
+	if( header->BlockCount == 0 ) {
+		check( header->StoredBlobSize == header->BlobSize, Err_BadMessageTable );
+	} else {
+		check( header->BlockTableOffset <= header->BlobOffset, Err_BadMessageTable );
+		check( header->BlockCount * static_cast<uint64_t>( sizeof( CBlobBlock ) ) <= header->BlobOffset - header->BlockTableOffset, Err_BadMessageTable );
+	}
+	checkIndexConsistency( header->SectionIndex );
+	checkIndexConsistency( header->KeyIndex );
+}
+
+void CMessageTableView::checkIndexConsistency( const CHashIndexHeader& index ) const
+{
+	check( ( index.BucketCount == 0 ) == ( index.SlotCount == 0 ), Err_BadMessageTable );
+	check( index.SeedTableOffset <= header->BlobOffset && index.SlotTableOffset <= header->BlobOffset, Err_BadMessageTable );
+	check( index.BucketCount * static_cast<uint64_t>( sizeof( int32_t ) ) <= header->BlobOffset - index.SeedTableOffset, Err_BadMessageTable );
+	check( index.SlotCount * static_cast<uint64_t>( sizeof( CHashIndexSlot ) ) <= header->BlobOffset - index.SlotTableOffset, Err_BadMessageTable );
+	const auto slots = reinterpret_cast<const CHashIndexSlot*>( data + index.SlotTableOffset );
+	for( uint32_t i = 0; i < index.SlotCount; i++ ) {
+		check( isStringInBlob( slots[i].NameOffset, slots[i].NameLength ), Err_BadMessageTable );
+	}
+}
+
+// Strings are stored with their terminators. Offsets are relative to the uncompressed blob.
+bool CMessageTableView::isStringInBlob( uint64_t offset, uint32_t length ) const
+{
+	const uint64_t size = ( length + static_cast<uint64_t>( 1 ) ) * header->CharSize;
+	return offset <= header->BlobSize && size <= header->BlobSize - offset;
+}
+
+// Blocks must cover the uncompressed blob without gaps and lie inside the stored blob.
+void CMessageTableView::checkBlockConsistency() const
+{
+	uint64_t uncompressedEnd = 0;
+	for( uint32_t i = 0; i < header->BlockCount; i++ ) {
+		const CBlobBlock& block = blocks[i];
+		check( block.UncompressedOffset == uncompressedEnd && block.CompressedSize <= block.UncompressedSize, Err_BadMessageTable );
+		check( block.CompressedOffset <= header->StoredBlobSize && block.CompressedSize <= header->StoredBlobSize - block.CompressedOffset, Err_BadMessageTable );
+		uncompressedEnd += block.UncompressedSize;
+	}
+	check( uncompressedEnd == header->BlobSize, Err_BadMessageTable );
+}
+
+// The entry is checked when it is requested, so opening a table doesn't scan the parameter tables.
+// Segment ranges and parameter slots are checked here. Literal spans are checked when a message is formatted,
+// because the length of a UTF-8 message in wide characters is known only after decoding.
+void CMessageTableView::checkParamEntry( const CMessageParamEntry& entry ) const
+{
+	check( entry.FirstSegment <= header->SegmentCount && entry.SegmentCount <= header->SegmentCount - entry.FirstSegment, Err_BadMessageTable );
+	check( entry.ParamCount <= header->MaxParamCount, Err_BadMessageTable );
+	for( uint32_t i = entry.FirstSegment; i < entry.FirstSegment + entry.SegmentCount; i++ ) {
+		check( segments[i].Length != MessageParamSlot || segments[i].Start < header->MaxParamCount, Err_BadMessageTable );
+	}
+}
+
+int CMessageTableView::FindLocale( CUnicodePart name ) const
+{
+	for( int i = 0; i < static_cast<int>( header->LocaleCount ); i++ ) {
+		if( isNameEqual( locales[i].NameOffset, locales[i].NameLength, name ) ) {
+			return i;
+		}
+	}
+	return NotFound;
+}
+
+CUnicodeString CMessageTableView::DecodeLocaleName( int localeId ) const
+{
+	assert( localeId >= 0 && localeId < LocaleCount() );
+	if( locales == nullptr ) {
+		return CUnicodeString();
+	}
+	const CMessageTableLocale& locale = locales[localeId];
+	const BYTE* name = getBlobData( locale.NameOffset );
+	if( Encoding() == MTE_Wide ) {
+		return UnicodeStr( CUnicodePart( reinterpret_cast<const wchar_t*>( name ), locale.NameLength ) );
+	}
+	CUnicodeString result;
+	CUtf8::Decode( name, locale.NameLength, result );
+	return result;
+}
+
+CUnicodePart CMessageTableView::GetString( int messageId, int localeId ) const
+{
+	assert( Encoding() == MTE_Wide );
+	const CMessageTableEntry& entry = getEntry( messageId, localeId );
+	return CUnicodePart( reinterpret_cast<const wchar_t*>( getBlobData( entry.Offset ) ), entry.Length );
+}
+
+CStringPart CMessageTableView::GetUtf8String( int messageId, int localeId ) const
+{
+	assert( Encoding() == MTE_Utf8 );
+	const CMessageTableEntry& entry = getEntry( messageId, localeId );
+	return CStringPart( reinterpret_cast<const char*>( getBlobData( entry.Offset ) ), entry.Length );
+}
+
+CUnicodeString CMessageTableView::DecodeString( int messageId, int localeId ) const
+{
+	if( Encoding() == MTE_Wide ) {
+		return UnicodeStr( GetString( messageId, localeId ) );
+	}
+	const CMessageTableEntry& entry = getEntry( messageId, localeId );
+	CUnicodeString result;
+	CUtf8::Decode( getBlobData( entry.Offset ), entry.Length, result );
+	return result;
+}
+
+// Entry tables of the locales follow each other.
+const CMessageTableEntry& CMessageTableView::getEntry( int messageId, int localeId ) const
+{
+	assert( messageId >= 0 && messageId < MessageCount() );
+	assert( localeId >= 0 && localeId < LocaleCount() );
+	return entries[static_cast<size_t>( localeId ) * header->MessageCount + messageId];
+}
+
+const CMessageParamEntry& CMessageTableView::GetParamEntry( int messageId, int localeId ) const
+{
+	assert( HasParams() );
+	assert( messageId >= 0 && messageId < MessageCount() );
+	assert( localeId >= 0 && localeId < LocaleCount() );
+	const CMessageParamEntry& entry = params[static_cast<size_t>( localeId ) * header->MessageCount + messageId];
+	checkParamEntry( entry );
+	return entry;
+}
+
+int CMessageTableView::FindSection( CUnicodePart name ) const
+{
+	const CHashIndexSlot* slot = findSlot( header->SectionIndex, GetNameHash( Encoding(), name ), name );
+	return slot == nullptr ? NotFound : static_cast<int>( slot->SectionId );
+}
+
+int CMessageTableView::FindMessage( int sectionId, CUnicodePart key ) const
+{
+	const CHashIndexSlot* slot = findSlot( header->KeyIndex, GetKeyIndexHash( Encoding(), sectionId, key ), key );
+	return slot == nullptr || static_cast<int>( slot->SectionId ) != sectionId ? NotFound : static_cast<int>( slot->MessageId );
+}
+
+// The perfect hash gives the only slot that may contain the name. The slot name is compared to reject unknown names.
+const CHashIndexSlot* CMessageTableView::findSlot( const CHashIndexHeader& index, uint64_t hash, CUnicodePart name ) const
+{
+	if( index.SlotCount == 0 ) {
+		return nullptr;
+	}
+	const auto seeds = reinterpret_cast<const int32_t*>( data + index.SeedTableOffset );
+	const int slotId = GetPerfectHashSlot( hash, seeds, index.BucketCount, index.SlotCount );
+	const CHashIndexSlot& slot = reinterpret_cast<const CHashIndexSlot*>( data + index.SlotTableOffset )[slotId];
+	return isNameEqual( slot.NameOffset, slot.NameLength, name ) ? &slot : nullptr;
+}
+
+// Compare a name in the blob with the given name without conversion.
+bool CMessageTableView::isNameEqual( uint64_t offset, uint32_t length, CUnicodePart name ) const
+{
+	const BYTE* blobName = getBlobData( offset );
+	if( Encoding() == MTE_Utf8 ) {
+		return CUtf8::Equals( blobName, length, name );
+	}
+	if( static_cast<int>( length ) != name.Length() ) {
+		return false;
+	}
+	return memcmp( blobName, name.Ptr(), name.Length() * sizeof( wchar_t ) ) == 0;
+}
+
+// Get a pointer to the uncompressed blob data at the given offset.
+const BYTE* CMessageTableView::getBlobData( uint64_t offset ) const
+{
+	if( blocks == nullptr ) {
+		return blob + offset;
+	}
+	const int blockId = findBlock( offset );
+	return getBlock( blockId ) + ( offset - blocks[blockId].UncompressedOffset );
+}
+
+int CMessageTableView::findBlock( uint64_t offset ) const
+{
+	int left = 0;
+	int right = static_cast<int>( header->BlockCount ) - 1;
+	while( left < right ) {
+		const int middle = ( left + right + 1 ) / 2;
+		if( blocks[middle].UncompressedOffset <= offset ) {
+			left = middle;
+		} else {
+			right = middle - 1;
+		}
+	}
+	return left;
+}
+
+// The first thread that finishes decompression publishes its buffer. Other threads discard their copies.
+// Raw blocks are used in place. A raw block that is not aligned to the char size, which older writers could produce, is copied.
+const BYTE* CMessageTableView::getBlock( int blockId ) const
+{
+	const CBlobBlock& block = blocks[blockId];
+	const bool isRaw = block.CompressedSize == block.UncompressedSize;
+	if( isRaw && block.CompressedOffset % header->CharSize == 0 ) {
+		return blob + block.CompressedOffset;
+	}
+	BYTE* cached = blockCache[blockId].load( std::memory_order_acquire );
+	if( cached != nullptr ) {
+		return cached;
+	}
+
+	std::unique_ptr<BYTE[]> buffer( new BYTE[block.UncompressedSize] );
+	if( isRaw ) {
+		memcpy( buffer.get(), blob + block.CompressedOffset, block.UncompressedSize );
+	} else {
+		check( CLzCodec::Decompress( blob + block.CompressedOffset, block.CompressedSize, buffer.get(), block.UncompressedSize ), Err_BadMessageTable );
+	}
+	if( blockCache[blockId].compare_exchange_strong( cached, buffer.get(), std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+		return buffer.release();
+	}
+	return cached;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
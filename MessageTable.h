@@ -0,0 +1,96 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Read-only view of a memory-mappable message table.
+// The view does not own the table memory. Strings of an uncompressed table point directly into the table.
+// Blocks of a compressed table are decompressed on first access and kept until the view is destroyed.
+// Lookups are thread-safe: concurrent readers of the same block may decompress it twice, but only one copy is kept.
+class CMessageTableView {
+public:
+	// Create a view of a table image. The image must outlive the view and be aligned to MessageTableAlignment.
+	CMessageTableView( const BYTE* data, __int64 size );
+	~CMessageTableView();
+	CMessageTableView( const CMessageTableView& ) = delete;
+	CMessageTableView& operator=( const CMessageTableView& ) = delete;
+
+	int MessageCount() const
+		{ return header->MessageCount; }
+	int SectionCount() const
+		{ return header->SectionCount; }
+	TMessageTableEncoding Encoding() const
+		{ return header->Encoding; }
+	// Hash that identifies the version of the table. See CMessageTableHeader::TableHash.
+	uint64_t TableHash() const
+		{ return header->TableHash; }
+	// Number of locales. A table compiled from a single file has one unnamed locale.
+	int LocaleCount() const
+		{ return localeCount; }
+
+	// Find a locale ID by the locale name. Return NotFound if the table has no such locale.
+	int FindLocale( CUnicodePart name ) const;
+	// Convert the locale name to a wide string.
+	CUnicodeString DecodeLocaleName( int localeId ) const;
+
+	// Get message text by its ID. The table must have the wide encoding.
+	// Locales share the message IDs. Locale 0 is the reference locale.
+	CUnicodePart GetString( int messageId, int localeId = 0 ) const;
+	// Get UTF-8 message text by its ID. The table must have the UTF-8 encoding.
+	CStringPart GetUtf8String( int messageId, int localeId = 0 ) const;
+	// Convert message text of any encoding to a wide string.
+	CUnicodeString DecodeString( int messageId, int localeId = 0 ) const;
+
+	// Whether the message parameters are precompiled into segments.
+	bool HasParams() const
+		{ return params != nullptr; }
+	// Largest number of parameters of a message. Zero if the parameters are not precompiled.
+	int MaxParamCount() const
+		{ return header->MaxParamCount; }
+	// Get the parameter entry of a message. The table must have precompiled parameters.
+	// The entry and its segments are validated on every call, so an invalid entry throws like an invalid table does on opening.
+	const CMessageParamEntry& GetParamEntry( int messageId, int localeId = 0 ) const;
+	// Segment table the parameter entries refer to.
+	const CMessageSegment* Segments() const
+		{ return segments; }
+
+	// Find a named section ID. Return NotFound if the section doesn't exist.
+	// Names are compared in the table encoding without conversion.
+	int FindSection( CUnicodePart name ) const;
+	// Find a message ID in a named section. Return NotFound if the section doesn't contain the key.
+	int FindMessage( int sectionId, CUnicodePart key ) const;
+
+private:
+	const BYTE* data;
+	const CMessageTableHeader* header;
+	int localeCount;
+	const CMessageTableLocale* locales;
+	// Entry tables of all the locales.
+	const CMessageTableEntry* entries;
+	// Parameter tables of all the locales. Null if the parameters are not precompiled.
+	const CMessageParamEntry* params;
+	const CMessageSegment* segments;
+	const BYTE* blob;
+	const CBlobBlock* blocks;
+	// Decompressed blocks. Null until the block is accessed.
+	std::unique_ptr<std::atomic<BYTE*>[]> blockCache;
+
+	void checkTableConsistency( __int64 size ) const;
+	void checkIndexConsistency( const CHashIndexHeader& index ) const;
+	void checkBlockConsistency() const;
+	bool isStringInBlob( uint64_t offset, uint32_t length ) const;
+	void checkParamEntry( const CMessageParamEntry& entry ) const;
+	const CMessageTableEntry& getEntry( int messageId, int localeId ) const;
+	const BYTE* getBlobData( uint64_t offset ) const;
+	int findBlock( uint64_t offset ) const;
+	const BYTE* getBlock( int blockId ) const;
+	const CHashIndexSlot* findSlot( const CHashIndexHeader& index, uint64_t hash, CUnicodePart name ) const;
+	bool isNameEqual( uint64_t offset, uint32_t length, CUnicodePart name ) const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
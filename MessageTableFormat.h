@@ -0,0 +1,228 @@
+#pragma once
+#include <HashUtils.h>
+#include <Utf8.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Memory-mappable binary message table.
+// The file is designed to be used in place: every structure is stored at an aligned offset
+// and message strings can be referenced directly without copying.
+// File layout:
+// CMessageTableHeader.
+// CMessageTableLocale array with LocaleCount elements if the table has several locales.
+// CMessageTableEntry array with MessageCount elements, indexed by message ID. A table with several locales
+// has an array per locale, one after another in the locale order. The first locale is the reference locale.
+// CMessageParamEntry arrays laid out like the entry arrays and the CMessageSegment array if the parameters are precompiled.
+// Section name index: perfect hash seeds followed by CHashIndexSlot array.
+// Named section key index: perfect hash seeds followed by CHashIndexSlot array.
+// CBlobBlock array with BlockCount elements if the blob is compressed.
+// String blob. Each message is a null-terminated string in the table encoding.
+// Section names and keys used by the indices and the locale names follow the messages in the blob.
+// Locales share the IDs, the indices and the blob, so identical strings of different locales are stored once.
+// A compressed blob is split into blocks at string boundaries. Each block is compressed by CLzCodec independently,
+// so a reader can decompress only the blocks that contain the requested strings.
+// All offsets are in bytes relative to the start of the file unless stated otherwise.
+// Offsets and blob sizes are 64-bit, so the size of a table is not limited. Counts and single strings are 32-bit.
+
+// Signature of the file: "MSGT".
+const uint32_t MessageTableSignature = 0x5447534D;
+const uint32_t MessageTableVersion = 7;
+// Alignment of every table in the file.
+const int MessageTableAlignment = 8;
+
+// Encoding of the strings in the blob.
+enum TMessageTableEncoding : uint32_t {
+	// wchar_t code units.
+	MTE_Wide,
+	// UTF-8 bytes.
+	MTE_Utf8
+};
+
+// Perfect hash table over names. See PerfectHash.h for the lookup algorithm.
+struct CHashIndexHeader {
+	uint32_t BucketCount;
+	uint32_t SlotCount;
+	// Offset of the int32_t seed array with BucketCount elements.
+	uint64_t SeedTableOffset;
+	// Offset of the CHashIndexSlot array with SlotCount elements.
+	uint64_t SlotTableOffset;
+};
+
+struct CHashIndexSlot {
+	// Name of the slot key in the blob.
+	uint64_t NameOffset;
+	uint32_t NameLength;
+	uint32_t SectionId;
+	// Message ID for a key index. Unused in the section index.
+	uint32_t MessageId;
+	uint32_t Reserved;
+};
+
+// Locale of a table with several locales.
+struct CMessageTableLocale {
+	// Name of the locale in the blob.
+	uint64_t NameOffset;
+	uint32_t NameLength;
+	uint32_t Reserved;
+};
+
+// Precompiled parameters of a message. See MessageParams.h for the parameter syntax.
+struct CMessageParamEntry {
+	// Position of the first segment in the segment table.
+	uint32_t FirstSegment;
+	// Zero segment count means that the message has no parameters and is used as is.
+	uint32_t SegmentCount;
+	// Largest parameter index plus one.
+	uint32_t ParamCount;
+	// Total length of the literal spans. The formatted length is this plus the lengths of the substituted parameters.
+	uint32_t LiteralLength;
+};
+
+// Value of CMessageSegment::Length that marks a parameter slot.
+const uint32_t MessageParamSlot = UINT32_MAX;
+
+// Part of a message with parameters: a literal span of the message or a parameter slot.
+// Spans are measured in wide characters of the message, so they apply to the decoded strings of a UTF-8 table too.
+struct CMessageSegment {
+	// Start of a literal span or the parameter index of a slot.
+	uint32_t Start;
+	// Length of a literal span or MessageParamSlot.
+	uint32_t Length;
+};
+
+// Part of a compressed blob.
+struct CBlobBlock {
+	// Position of the block data in the uncompressed blob.
+	uint64_t UncompressedOffset;
+	// Position of the block in the stored blob.
+	uint64_t CompressedOffset;
+	uint32_t UncompressedSize;
+	// A block with equal compressed and uncompressed sizes is stored without compression.
+	// Blocks start at offsets that are multiples of the char size, so the strings of a raw block are aligned.
+	uint32_t CompressedSize;
+};
+
+struct CMessageTableHeader {
+	uint32_t Signature;
+	uint32_t Version;
+	TMessageTableEncoding Encoding;
+	// Size of a single code unit in bytes.
+	uint32_t CharSize;
+	// Upper bounds of the message and section IDs. Stable IDs may leave unused IDs, their messages are empty.
+	uint32_t MessageCount;
+	// The ID of the first named section is the smallest ID among the named sections.
+	uint32_t SectionCount;
+	uint32_t FirstNamedSectionId;
+	// Compressed blob blocks. Zero block count means that the blob is not compressed.
+	uint32_t BlockCount;
+	// Zero locale count means a single unnamed locale.
+	uint32_t LocaleCount;
+	// Largest parameter count of a message.
+	uint32_t MaxParamCount;
+	uint32_t SegmentCount;
+	uint32_t Reserved;
+	// Hash of the stored blob followed by the bytes before the blob with this field set to zero.
+	// A delta names the table version it applies to by this hash.
+	uint64_t TableHash;
+	uint64_t LocaleTableOffset;
+	// Zero parameter table offset means that the parameters are not precompiled.
+	uint64_t ParamTableOffset;
+	uint64_t SegmentTableOffset;
+	uint64_t BlockTableOffset;
+	uint64_t EntryTableOffset;
+	uint64_t BlobOffset;
+	// Size of the uncompressed blob. Entry and slot offsets refer to it.
+	uint64_t BlobSize;
+	// Size of the blob in the file.
+	uint64_t StoredBlobSize;
+	// Named sections by name. The hash of a section name is GetNameHash( encoding, name ).
+	CHashIndexHeader SectionIndex;
+	// Named section messages by section ID and key. The hash of a key is GetKeyIndexHash( encoding, sectionId, key ).
+	CHashIndexHeader KeyIndex;
+};
+
+struct CMessageTableEntry {
+	// Offset of the string in bytes from the start of the blob.
+	uint64_t Offset;
+	// Length of the string in code units of the table encoding not including the terminating null.
+	uint32_t Length;
+	uint32_t Reserved;
+};
+
+// Delta that turns one version of a message table into the next one. See CMessageReader::ApplyDelta.
+// The delta has the new values of the messages that differ between the versions, so a reader can replace them
+// without loading the whole new table. The IDs of both versions must be the same, which stable IDs guarantee.
+// File layout:
+// CMessageDeltaHeader.
+// CMessageDeltaChange array with ChangeCount elements sorted by locale and message ID.
+// String blob with the new values. Each value is a null-terminated string in the delta encoding. The blob is not compressed.
+
+// Signature of the file: "MSGD".
+const uint32_t MessageDeltaSignature = 0x4447534D;
+const uint32_t MessageDeltaVersion = 1;
+
+enum TMessageDeltaChange : uint32_t {
+	// The message exists in both versions and has a new value.
+	MDC_Changed,
+	// The message ID is beyond the message count of the base version.
+	MDC_Added,
+	// The message is not used by the new version. Its value is empty.
+	MDC_Removed
+};
+
+struct CMessageDeltaChange {
+	uint32_t MessageId;
+	uint32_t LocaleId;
+	// Offset of the new value in bytes from the start of the blob.
+	uint64_t Offset;
+	// Length of the new value in code units of the delta encoding not including the terminating null.
+	uint32_t Length;
+	TMessageDeltaChange Change;
+};
+
+struct CMessageDeltaHeader {
+	uint32_t Signature;
+	uint32_t Version;
+	TMessageTableEncoding Encoding;
+	uint32_t CharSize;
+	// Table hashes of the version the delta applies to and of the version it produces. See CMessageTableHeader::TableHash.
+	uint64_t BaseHash;
+	uint64_t TargetHash;
+	// Message count of the produced version. Messages from the base message count up to this one are added.
+	uint32_t MessageCount;
+	// Locale count of both versions. A table with a single unnamed locale has one locale.
+	uint32_t LocaleCount;
+	uint32_t ChangeCount;
+	uint32_t Reserved;
+	uint64_t ChangeTableOffset;
+	uint64_t BlobOffset;
+	uint64_t BlobSize;
+};
+
+inline __int64 AlignTableOffset( __int64 offset )
+{
+	return ( offset + MessageTableAlignment - 1 ) & ~static_cast<__int64>( MessageTableAlignment - 1 );
+}
+
+// Names are hashed in the table encoding.
+inline uint64_t GetNameHash( TMessageTableEncoding encoding, CUnicodePart name, uint64_t hash = HashOffsetBasis )
+{
+	return encoding == MTE_Utf8 ? CUtf8::Hash( name, hash ) : HashString( name, hash );
+}
+
+inline uint64_t GetKeyIndexHash( TMessageTableEncoding encoding, int sectionId, CUnicodePart key )
+{
+	return GetNameHash( encoding, key, HashBytes( &sectionId, sizeof( sectionId ) ) );
+}
+
+inline int GetEncodingCharSize( TMessageTableEncoding encoding )
+{
+	return encoding == MTE_Utf8 ? 1 : sizeof( wchar_t );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
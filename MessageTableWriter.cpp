@@ -0,0 +1,509 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <MessageTableWriter.h>
+#include <MessageFile.h>
+#include <MessageIdMap.h>
+#include <AccessProfile.h>
+#include <LzCodec.h>
+#include <MessageParams.h>
+#include <PerfectHash.h>
+#include <StringBlob.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+CMessageTableWriter::CMessageTableWriter( const CMessageFile& _input, const CMessageIds& _ids, const CCompilerOptions& _options ) :
+	input( _input ),
+	ids( _ids ),
+	options( _options )
+{
+}
+
+extern const CError Err_MessageTableTooLarge( L"Message table is too large to be created in memory. Use the streaming mode." );
+void CMessageTableWriter::CreateImage( CArray<BYTE>& result, CMessageTableStats& stats ) const
+{
+	const TMessageTableEncoding encoding = options.Encoding;
+	const int messageCount = ids.MessageIdLimit;
+	const int localeCount = std::max( locales.Size(), 1 );
+
+	const __int64 expectedBlobSize = getExpectedBlobSize();
+	check( expectedBlobSize <= INT_MAX, Err_MessageTableTooLarge );
+	CStringBlobBuilder blob( encoding, static_cast<int>( expectedBlobSize ) );
+	// Message IDs that are not used by the file point to an empty string.
+	const int emptyHandle = messageCount > input.MessageCount() ? blob.Add( CUnicodePart() ) : NotFound;
+	CArray<int> messageHandles;
+	messageHandles.IncreaseSize( messageCount * localeCount );
+	for( int& handle : messageHandles ) {
+		handle = emptyHandle;
+	}
+	CArray<int> layoutOrder;
+	getLayoutOrder( layoutOrder );
+	addMessages( input, 0, layoutOrder, blob, messageHandles );
+	for( int localeId = 1; localeId < locales.Size(); localeId++ ) {
+		addMessages( *locales[localeId].File, localeId, layoutOrder, blob, messageHandles );
+	}
+
+	CTables tables;
+	AddIndexKeys( input, ids, encoding, getMessageCount( input.GetUnnamedSections() ), [&]( CUnicodePart name ) { return blob.Add( name ); },
+		tables.SectionKeys, tables.MessageKeys );
+	CArray<int> localeNameHandles;
+	for( const auto& locale : locales ) {
+		localeNameHandles.Add( blob.Add( locale.Name ) );
+	}
+
+	blob.Build( options.MergeStrings || locales.Size() > 1 );
+	stats.RawBlobSize = blob.RawSize();
+	stats.BlobSize = blob.GetBlob().Size();
+	tables.Entries.IncreaseSize( messageHandles.Size() );
+	for( int i = 0; i < messageHandles.Size(); i++ ) {
+		CMessageTableEntry& entry = tables.Entries[i];
+		entry = CMessageTableEntry{};
+		entry.Offset = blob.GetOffset( messageHandles[i] );
+		entry.Length = blob.GetLength( messageHandles[i] );
+	}
+	for( const int handle : localeNameHandles ) {
+		CMessageTableLocale locale{};
+		locale.NameOffset = blob.GetOffset( handle );
+		locale.NameLength = blob.GetLength( handle );
+		tables.Locales.Add( locale );
+	}
+	resolveNames( blob, tables.SectionKeys );
+	resolveNames( blob, tables.MessageKeys );
+	if( options.MaxParamCount > 0 ) {
+		tables.ParamEntries.IncreaseSize( messageHandles.Size() );
+		for( auto& entry : tables.ParamEntries ) {
+			entry = CMessageParamEntry{};
+		}
+		addParams( input, 0, tables );
+		for( int localeId = 1; localeId < locales.Size(); localeId++ ) {
+			addParams( *locales[localeId].File, localeId, tables );
+		}
+	}
+
+	CArray<BYTE> compressedBlob;
+	if( options.CompressionBlockSize > 0 ) {
+		compressBlob( blob, tables.Blocks, compressedBlob );
+	}
+	const CArrayView<BYTE> storedBlob = options.CompressionBlockSize > 0 ? CArrayView<BYTE>( compressedBlob ) : blob.GetBlob();
+	stats.StoredBlobSize = storedBlob.Size();
+
+	CMessageTableHeader header{};
+	header.Encoding = encoding;
+	header.CharSize = GetEncodingCharSize( encoding );
+	header.MessageCount = messageCount;
+	header.SectionCount = ids.SectionIdLimit;
+	header.FirstNamedSectionId = GetFirstNamedSectionId( input, ids );
+	header.BlobSize = blob.GetBlob().Size();
+	header.StoredBlobSize = storedBlob.Size();
+	CreateTables( header, tables, result );
+	const __int64 imageSize = header.BlobOffset + header.StoredBlobSize;
+	check( imageSize <= INT_MAX, Err_MessageTableTooLarge );
+
+	result.IncreaseSize( static_cast<int>( imageSize ) );
+	memcpy( result.Ptr() + header.BlobOffset, storedBlob.Ptr(), storedBlob.Size() );
+	SetTableHash( HashBytes( storedBlob.Ptr(), storedBlob.Size() ), result.Ptr() );
+}
+
+// Parameter segments and compressed blocks lie in front of the blob and depend on the values, so only plain blobs can be patched.
+bool CMessageTableWriter::IsPatchable( const CCompilerOptions& options )
+{
+	return options.BinaryFormat == BF_Mapped && options.CompressionBlockSize == 0 && options.MaxParamCount == 0;
+}
+
+// The changed values are found first, so the image grows once and is left unchanged if the patch is refused.
+// Replaced values stay in the blob unused until a new image is created.
+bool CMessageTableWriter::PatchImage( __int64 maxBlobSize, CArray<BYTE>& image, uint64_t& blobHash, int& patchedCount ) const
+{
+	assert( IsPatchable( options ) && locales.IsEmpty() );
+	const CMessageTableHeader& oldHeader = *reinterpret_cast<const CMessageTableHeader*>( image.Ptr() );
+	assert( oldHeader.Encoding == options.Encoding && oldHeader.MessageCount == static_cast<uint32_t>( ids.MessageIdLimit ) );
+	const TMessageTableEncoding encoding = options.Encoding;
+	const int charSize = GetEncodingCharSize( encoding );
+	const __int64 blobOffset = oldHeader.BlobOffset;
+	const __int64 entryTableOffset = oldHeader.EntryTableOffset;
+	assert( image.Size() == blobOffset + oldHeader.BlobSize );
+
+	CArray<CUnicodePart> values;
+	CArray<int> messagePositions;
+	for( const auto& updated : input.GetUpdatedSections() ) {
+		const CArrayView<CMessageSection> sections = updated.IsNamed ? input.GetNamedSections() : input.GetUnnamedSections();
+		int messagePos = updated.FirstMessagePos;
+		for( int i = updated.Begin; i < updated.End; i++ ) {
+			for( const auto& value : sections[i].GetKeyValues() ) {
+				values.Add( value );
+				messagePositions.Add( messagePos );
+				messagePos++;
+			}
+		}
+	}
+	CArray<int> changedPositions;
+	CArray<BYTE> encodedValue;
+	__int64 appendedSize = 0;
+	for( int pos = 0; pos < values.Size(); pos++ ) {
+		const int size = getEncodedSize( encoding, values[pos] );
+		if( encodedValue.Size() < size ) {
+			encodedValue.IncreaseSize( size );
+		}
+		encodeString( encoding, values[pos], encodedValue.Ptr() );
+		const auto& entry = reinterpret_cast<const CMessageTableEntry*>( image.Ptr() + entryTableOffset )[ids.MessageIds[messagePositions[pos]]];
+		const bool isSame = ( entry.Length + 1ull ) * charSize == static_cast<uint64_t>( size )
+			&& memcmp( image.Ptr() + blobOffset + entry.Offset, encodedValue.Ptr(), size ) == 0;
+		if( !isSame ) {
+			changedPositions.Add( pos );
+			appendedSize += size;
+		}
+	}
+	patchedCount = changedPositions.Size();
+	if( changedPositions.IsEmpty() ) {
+		return true;
+	}
+	const __int64 newBlobSize = oldHeader.BlobSize + appendedSize;
+	if( newBlobSize > maxBlobSize || blobOffset + newBlobSize > INT_MAX ) {
+		return false;
+	}
+
+	const int oldImageSize = image.Size();
+	int blobEnd = oldImageSize;
+	image.IncreaseSize( static_cast<int>( blobOffset + newBlobSize ) );
+	auto& header = *reinterpret_cast<CMessageTableHeader*>( image.Ptr() );
+	const auto entries = reinterpret_cast<CMessageTableEntry*>( image.Ptr() + entryTableOffset );
+	for( const int pos : changedPositions ) {
+		const int size = encodeString( encoding, values[pos], image.Ptr() + blobEnd );
+		CMessageTableEntry& entry = entries[ids.MessageIds[messagePositions[pos]]];
+		entry.Offset = blobEnd - blobOffset;
+		entry.Length = size / charSize - 1;
+		blobEnd += size;
+	}
+	header.BlobSize = newBlobSize;
+	header.StoredBlobSize = newBlobSize;
+	// The blob hash is a running hash of its bytes, so the appended bytes continue it.
+	blobHash = HashBytes( image.Ptr() + oldImageSize, static_cast<size_t>( appendedSize ), blobHash );
+	SetTableHash( blobHash, image.Ptr() );
+	return true;
+}
+
+// Encode a string with its terminator like the blob builder does. Return the written size in bytes.
+int CMessageTableWriter::encodeString( TMessageTableEncoding encoding, CUnicodePart str, BYTE* buffer )
+{
+	const int charSize = GetEncodingCharSize( encoding );
+	const int byteLength = encoding == MTE_Utf8 ? CUtf8::Encode( str, buffer ) : str.Length() * charSize;
+	if( encoding != MTE_Utf8 ) {
+		memcpy( buffer, str.Ptr(), byteLength );
+	}
+	memset( buffer + byteLength, 0, charSize );
+	return byteLength + charSize;
+}
+
+int CMessageTableWriter::getEncodedSize( TMessageTableEncoding encoding, CUnicodePart str )
+{
+	const int charSize = GetEncodingCharSize( encoding );
+	return ( encoding == MTE_Utf8 ? CUtf8::EncodedSize( str ) : str.Length() * charSize ) + charSize;
+}
+
+// Every string is stored with its null terminator. Mostly ASCII UTF-8 text takes a code unit per character.
+__int64 CMessageTableWriter::getExpectedBlobSize() const
+{
+	__int64 textSize = input.MessageBinarySize();
+	for( int localeId = 1; localeId < locales.Size(); localeId++ ) {
+		textSize += locales[localeId].File->MessageBinarySize();
+	}
+	const __int64 stringCount = static_cast<__int64>( ids.MessageIdLimit ) * std::max( locales.Size(), 1 ) + 1;
+	return ( textSize / sizeof( wchar_t ) + stringCount ) * GetEncodingCharSize( options.Encoding );
+}
+
+void CMessageTableWriter::CreateTables( CMessageTableHeader& header, const CTables& tables, CArray<BYTE>& result )
+{
+	const CPerfectHashBuilder sectionHash( tables.SectionKeys.Hashes );
+	const CPerfectHashBuilder messageHash( tables.MessageKeys.Hashes );
+
+	header.Signature = MessageTableSignature;
+	header.Version = MessageTableVersion;
+	header.LocaleCount = tables.Locales.Size();
+	__int64 offset = AlignTableOffset( sizeof( CMessageTableHeader ) );
+	header.LocaleTableOffset = offset;
+	offset = AlignTableOffset( offset + tables.Locales.Size() * static_cast<__int64>( sizeof( CMessageTableLocale ) ) );
+	header.EntryTableOffset = offset;
+	offset = AlignTableOffset( offset + tables.Entries.Size() * static_cast<__int64>( sizeof( CMessageTableEntry ) ) );
+	if( !tables.ParamEntries.IsEmpty() ) {
+		header.MaxParamCount = 0;
+		for( const auto& entry : tables.ParamEntries ) {
+			header.MaxParamCount = std::max( header.MaxParamCount, entry.ParamCount );
+		}
+		header.SegmentCount = tables.Segments.Size();
+		header.ParamTableOffset = offset;
+		offset = AlignTableOffset( offset + tables.ParamEntries.Size() * static_cast<__int64>( sizeof( CMessageParamEntry ) ) );
+		header.SegmentTableOffset = offset;
+		offset = AlignTableOffset( offset + tables.Segments.Size() * static_cast<__int64>( sizeof( CMessageSegment ) ) );
+	}
+	offset = layoutIndex( sectionHash, offset, header.SectionIndex );
+	offset = layoutIndex( messageHash, offset, header.KeyIndex );
+	header.BlockCount = tables.Blocks.Size();
+	header.BlockTableOffset = offset;
+	offset = AlignTableOffset( offset + tables.Blocks.Size() * static_cast<__int64>( sizeof( CBlobBlock ) ) );
+	header.BlobOffset = offset;
+	check( offset <= INT_MAX, Err_MessageTableTooLarge );
+
+	result.Empty();
+	result.IncreaseSize( static_cast<int>( offset ) );
+	BYTE* image = result.Ptr();
+	// Padding must be deterministic.
+	memset( image, 0, static_cast<size_t>( offset ) );
+	memcpy( image, &header, sizeof( header ) );
+	memcpy( image + header.LocaleTableOffset, tables.Locales.Ptr(), tables.Locales.Size() * sizeof( CMessageTableLocale ) );
+	memcpy( image + header.EntryTableOffset, tables.Entries.Ptr(), tables.Entries.Size() * sizeof( CMessageTableEntry ) );
+	memcpy( image + header.ParamTableOffset, tables.ParamEntries.Ptr(), tables.ParamEntries.Size() * sizeof( CMessageParamEntry ) );
+	memcpy( image + header.SegmentTableOffset, tables.Segments.Ptr(), tables.Segments.Size() * sizeof( CMessageSegment ) );
+	writeIndex( sectionHash, tables.SectionKeys, header.SectionIndex, image );
+	writeIndex( messageHash, tables.MessageKeys, header.KeyIndex, image );
+	memcpy( image + header.BlockTableOffset, tables.Blocks.Ptr(), tables.Blocks.Size() * sizeof( CBlobBlock ) );
+}
+
+// The blob is hashed first, so the streaming writer can hash it while it is written.
+void CMessageTableWriter::SetTableHash( uint64_t storedBlobHash, BYTE* image )
+{
+	const auto header = reinterpret_cast<CMessageTableHeader*>( image );
+	header->TableHash = 0;
+	header->TableHash = HashBytes( image, static_cast<size_t>( header->BlobOffset ), storedBlobHash );
+}
+
+int CMessageTableWriter::GetFirstNamedSectionId( const CMessageFile& input, const CMessageIds& ids )
+{
+	const int namedSectionCount = input.GetNamedSections().Size();
+	int result = ids.SectionIdLimit;
+	for( int i = ids.SectionIds.Size() - namedSectionCount; i < ids.SectionIds.Size(); i++ ) {
+		result = ids.SectionIds[i] < result ? ids.SectionIds[i] : result;
+	}
+	return result;
+}
+
+// Sections stand for the groups of messages that are used together, so the accessed messages of a section are kept together
+// and the sections go from the most to the least accessed. Messages without lookups follow in the file order.
+// Merged strings are stored with the strings that contain them, so merging can move some accessed values out of the accessed part.
+void CMessageTableWriter::getLayoutOrder( CArray<int>& result ) const
+{
+	result.Empty();
+	if( profile == nullptr ) {
+		return;
+	}
+	CArray<CSectionAccess> sections;
+	int messagePos = 0;
+	addSectionAccess( input.GetUnnamedSections(), messagePos, sections );
+	addSectionAccess( input.GetNamedSections(), messagePos, sections );
+	std::stable_sort( sections.begin(), sections.end(), []( const CSectionAccess& left, const CSectionAccess& right ) {
+		return left.Count > right.Count;
+	} );
+
+	CArray<BYTE> isAdded;
+	isAdded.IncreaseSize( input.MessageCount() );
+	memset( isAdded.Ptr(), 0, isAdded.Size() );
+	result.ReserveBuffer( input.MessageCount() );
+	for( const auto& section : sections ) {
+		if( section.Count == 0 ) {
+			break;
+		}
+		const int sectionStart = result.Size();
+		for( int pos = section.FirstPos; pos < section.EndPos; pos++ ) {
+			if( profile->GetCount( ids.MessageIds[pos] ) > 0 ) {
+				result.Add( pos );
+				isAdded[pos] = 1;
+			}
+		}
+		std::stable_sort( result.Ptr() + sectionStart, result.Ptr() + result.Size(), [this]( int left, int right ) {
+			return profile->GetCount( ids.MessageIds[left] ) > profile->GetCount( ids.MessageIds[right] );
+		} );
+	}
+	for( int pos = 0; pos < input.MessageCount(); pos++ ) {
+		if( isAdded[pos] == 0 ) {
+			result.Add( pos );
+		}
+	}
+}
+
+void CMessageTableWriter::addSectionAccess( CArrayView<CMessageSection> sections, int& messagePos, CArray<CSectionAccess>& result ) const
+{
+	for( const auto& section : sections ) {
+		CSectionAccess access{};
+		access.FirstPos = messagePos;
+		access.EndPos = messagePos + section.GetKeyValues().Size();
+		for( int pos = access.FirstPos; pos < access.EndPos; pos++ ) {
+			access.Count = CAccessProfile::AddCounts( access.Count, profile->GetCount( ids.MessageIds[pos] ) );
+		}
+		result.Add( access );
+		messagePos = access.EndPos;
+	}
+}
+
+// Add the values of a locale to the blob in the layout order and remember their handles by locale and message ID.
+// An empty layout order keeps the file order.
+void CMessageTableWriter::addMessages( const CMessageFile& file, int localeId, CArrayView<int> layoutOrder, CStringBlobBuilder& blob,
+	CArray<int>& handles ) const
+{
+	CArray<CUnicodePart> values;
+	values.ReserveBuffer( file.MessageCount() );
+	getValues( file.GetUnnamedSections(), values );
+	getValues( file.GetNamedSections(), values );
+	assert( values.Size() == input.MessageCount() );
+
+	const int localeStart = localeId * ids.MessageIdLimit;
+	for( int i = 0; i < values.Size(); i++ ) {
+		const int messagePos = layoutOrder.IsEmpty() ? i : layoutOrder[i];
+		handles[localeStart + ids.MessageIds[messagePos]] = blob.Add( values[messagePos] );
+	}
+}
+
+void CMessageTableWriter::getValues( CArrayView<CMessageSection> sections, CArray<CUnicodePart>& result )
+{
+	for( const auto& section : sections ) {
+		for( const auto& value : section.GetKeyValues() ) {
+			result.Add( value );
+		}
+	}
+}
+
+int CMessageTableWriter::getMessageCount( CArrayView<CMessageSection> sections )
+{
+	int result = 0;
+	for( const auto& section : sections ) {
+		result += section.GetKeyValues().Size();
+	}
+	return result;
+}
+
+// Split the values of a locale into segments. Parameter entries are indexed like the message entries.
+void CMessageTableWriter::addParams( const CMessageFile& file, int localeId, CTables& tables ) const
+{
+	CMessageParamEntry* entries = tables.ParamEntries.Ptr() + localeId * ids.MessageIdLimit;
+	int messagePos = 0;
+	addParams( file.GetUnnamedSections(), ids.MessageIds, entries, messagePos, tables.Segments );
+	addParams( file.GetNamedSections(), ids.MessageIds, entries, messagePos, tables.Segments );
+}
+
+void CMessageTableWriter::addParams( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CMessageParamEntry* entries, int& messagePos,
+	CArray<CMessageSegment>& segments )
+{
+	for( const auto& section : sections ) {
+		for( const auto& value : section.GetKeyValues() ) {
+			entries[messageIds[messagePos]] = CMessageParams::AddSegments( value, segments );
+			messagePos++;
+		}
+	}
+}
+
+void CMessageTableWriter::AddIndexKeys( const CMessageFile& input, const CMessageIds& ids, TMessageTableEncoding encoding, int firstNamedMessagePos,
+	const std::function<int( CUnicodePart )>& addName, CIndexKeys& sectionKeys, CIndexKeys& messageKeys )
+{
+	int sectionPos = ids.SectionIds.Size() - input.GetNamedSections().Size();
+	int messagePos = firstNamedMessagePos;
+	for( const auto& section : input.GetNamedSections() ) {
+		const int sectionId = ids.SectionIds[sectionPos];
+		const CUnicodeString name = UnicodeStr( section.GetName() );
+		CHashIndexSlot sectionSlot{};
+		sectionSlot.SectionId = sectionId;
+		sectionKeys.Hashes.Add( GetNameHash( encoding, name ) );
+		sectionKeys.Slots.Add( sectionSlot );
+		sectionKeys.NameHandles.Add( addName( name ) );
+
+		for( const auto& key : section.GetKeyNames() ) {
+			const int messageId = ids.MessageIds[messagePos];
+			CHashIndexSlot keySlot{};
+			keySlot.SectionId = sectionId;
+			keySlot.MessageId = messageId;
+			messageKeys.Hashes.Add( GetKeyIndexHash( encoding, sectionId, key ) );
+			messageKeys.Slots.Add( keySlot );
+			messageKeys.NameHandles.Add( addName( key ) );
+			messagePos++;
+		}
+		sectionPos++;
+	}
+}
+
+// Set the final name positions in the index slots.
+void CMessageTableWriter::resolveNames( const CStringBlobBuilder& blob, CIndexKeys& keys )
+{
+	for( int i = 0; i < keys.Slots.Size(); i++ ) {
+		keys.Slots[i].NameOffset = blob.GetOffset( keys.NameHandles[i] );
+		keys.Slots[i].NameLength = blob.GetLength( keys.NameHandles[i] );
+	}
+}
+
+// Split the blob into blocks of at least the target size. Blocks end on string boundaries,
+// so every string can be read from a single decompressed block.
+void CMessageTableWriter::compressBlob( const CStringBlobBuilder& blob, CArray<CBlobBlock>& blocks, CArray<BYTE>& result ) const
+{
+	const BYTE* blobData = blob.GetBlob().Ptr();
+	const auto stringEnds = blob.GetStoredStringEnds();
+	int blockStart = 0;
+	for( int i = 0; i < stringEnds.Size(); i++ ) {
+		const int end = stringEnds[i];
+		if( end - blockStart >= options.CompressionBlockSize || i == stringEnds.Size() - 1 ) {
+			addCompressedBlock( blobData, blockStart, end, GetEncodingCharSize( options.Encoding ), blocks, result );
+			blockStart = end;
+		}
+	}
+	assert( blockStart == blob.GetBlob().Size() );
+}
+
+// Blocks that don't benefit from compression are stored as is. Every block is aligned to the char size.
+void CMessageTableWriter::addCompressedBlock( const BYTE* blobData, int start, int end, int charSize, CArray<CBlobBlock>& blocks,
+	CArray<BYTE>& result )
+{
+	const int paddingStart = result.Size();
+	const int paddingSize = ( charSize - paddingStart % charSize ) % charSize;
+	result.IncreaseSize( paddingStart + paddingSize );
+	memset( result.Ptr() + paddingStart, 0, paddingSize );
+
+	const int size = end - start;
+	CArray<BYTE> compressed;
+	CLzCodec::Compress( blobData + start, size, compressed );
+	const bool isRaw = compressed.Size() >= size;
+	const BYTE* storedData = isRaw ? blobData + start : compressed.Ptr();
+	const int storedSize = isRaw ? size : compressed.Size();
+
+	CBlobBlock block{};
+	block.UncompressedOffset = start;
+	block.CompressedOffset = result.Size();
+	block.UncompressedSize = size;
+	block.CompressedSize = storedSize;
+	blocks.Add( block );
+
+	result.IncreaseSize( result.Size() + storedSize );
+	memcpy( result.Ptr() + block.CompressedOffset, storedData, storedSize );
+}
+
+// Reserve the space for the index tables starting from the given offset. Return the end of the index.
+__int64 CMessageTableWriter::layoutIndex( const CPerfectHashBuilder& hash, __int64 offset, CHashIndexHeader& result )
+{
+	result.BucketCount = hash.BucketCount();
+	result.SlotCount = hash.SlotCount();
+	result.SeedTableOffset = offset;
+	offset = AlignTableOffset( offset + hash.BucketCount() * static_cast<__int64>( sizeof( int32_t ) ) );
+	result.SlotTableOffset = offset;
+	return AlignTableOffset( offset + hash.SlotCount() * static_cast<__int64>( sizeof( CHashIndexSlot ) ) );
+}
+
+void CMessageTableWriter::writeIndex( const CPerfectHashBuilder& hash, const CIndexKeys& keys, const CHashIndexHeader& header, BYTE* image )
+{
+	memcpy( image + header.SeedTableOffset, hash.Seeds().Ptr(), hash.BucketCount() * sizeof( int32_t ) );
+	auto slotTable = reinterpret_cast<CHashIndexSlot*>( image + header.SlotTableOffset );
+	const auto slots = hash.Slots();
+	for( int i = 0; i < slots.Size(); i++ ) {
+		slotTable[slots[i]] = keys.Slots[i];
+	}
+}
+
+CMessageTableStats CMessageTableWriter::Write( CUnicodeView fileName ) const
+{
+	CArray<BYTE> image;
+	CMessageTableStats stats;
+	CreateImage( image, stats );
+	CFileWriter outputFile( fileName, FCM_CreateAlways );
+	outputFile.Write( image.Ptr(), image.Size() );
+	return stats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
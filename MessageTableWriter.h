@@ -0,0 +1,129 @@
+#pragma once
+#include <MessageTableFormat.h>
+#include <CompilerOptions.h>
+
+namespace Msg {
+
+class CMessageFile;
+class CMessageSection;
+class CAccessProfile;
+struct CMessageIds;
+class CPerfectHashBuilder;
+class CStringBlobBuilder;
+//////////////////////////////////////////////////////////////////////////
+
+// Size statistics of a created table.
+struct CMessageTableStats {
+	// Size of all the strings before merging.
+	__int64 RawBlobSize = 0;
+	// Size of the blob after merging.
+	__int64 BlobSize = 0;
+	// Size of the blob in the table after compression.
+	__int64 StoredBlobSize = 0;
+};
+
+// Locale of a table that is compiled from several message files.
+struct CMessageLocale {
+	CUnicodeString Name;
+	// Message file with the keys of the reference file in the same order. Null for the reference locale.
+	const CMessageFile* File = nullptr;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Creator of a memory-mappable message table from a parsed message file.
+class CMessageTableWriter {
+public:
+	CMessageTableWriter( const CMessageFile& input, const CMessageIds& ids, const CCompilerOptions& options );
+
+	// Store several locales that share the IDs of the input file. The first locale is the reference locale, its messages come from the input.
+	// Strings of all the locales are merged, so identical translations are stored once.
+	void SetLocales( CArrayView<CMessageLocale> newValue )
+		{ locales = newValue; }
+	// Lay out the values of every locale from the most accessed to the least accessed. Null keeps the file order.
+	// The profile must outlive the writer.
+	void SetProfile( const CAccessProfile* newValue )
+		{ profile = newValue; }
+
+	// Create the whole file image in memory.
+	void CreateImage( CArray<BYTE>& result, CMessageTableStats& stats ) const;
+	// Create the image and write it to a file.
+	CMessageTableStats Write( CUnicodeView fileName ) const;
+	// Whether the images created with the options can be patched by PatchImage.
+	static bool IsPatchable( const CCompilerOptions& options );
+	// Update an image created by a writer with the same options for the input before its last update, which kept the keys and IDs.
+	// Only the sections parsed by the update are compared with the image. Their values that differ from the image are appended
+	// to the blob and their entries point to them, the rest of the image is kept.
+	// The hash of the blob is updated with the appended values, so the blob is not hashed again.
+	// Return false and leave the image unchanged if the blob would grow beyond maxBlobSize, then a new image must be created.
+	bool PatchImage( __int64 maxBlobSize, CArray<BYTE>& image, uint64_t& blobHash, int& patchedCount ) const;
+
+	// Keys of a hash index and the slots that correspond to them.
+	struct CIndexKeys {
+		CArray<uint64_t> Hashes;
+		CArray<CHashIndexSlot> Slots;
+		// Blob handles of the slot names.
+		CArray<int> NameHandles;
+	};
+
+	// Smallest ID of a named section. Named sections follow the unnamed ones unless stable IDs mix them.
+	static int GetFirstNamedSectionId( const CMessageFile& input, const CMessageIds& ids );
+	// Gather the keys of the named section indices. Slot names are put in the blob by addName, which returns their handles.
+	static void AddIndexKeys( const CMessageFile& input, const CMessageIds& ids, TMessageTableEncoding encoding, int firstNamedMessagePos,
+		const std::function<int( CUnicodePart )>& addName, CIndexKeys& sectionKeys, CIndexKeys& messageKeys );
+	// Tables that precede the blob.
+	struct CTables {
+		// Empty for a table without named locales.
+		CArray<CMessageTableLocale> Locales;
+		// Entry tables of all the locales.
+		CArray<CMessageTableEntry> Entries;
+		// Parameter tables of all the locales. Empty if the parameters are not precompiled.
+		CArray<CMessageParamEntry> ParamEntries;
+		CArray<CMessageSegment> Segments;
+		CIndexKeys SectionKeys;
+		CIndexKeys MessageKeys;
+		CArray<CBlobBlock> Blocks;
+	};
+
+	// Lay out the header and the tables that precede the blob. The header must have every field but the table offsets and sizes set.
+	// The result ends at the blob offset.
+	static void CreateTables( CMessageTableHeader& header, const CTables& tables, CArray<BYTE>& result );
+	// Set the table hash in the header of a table image. Only the bytes before the blob are read, the stored blob is given by its hash.
+	static void SetTableHash( uint64_t storedBlobHash, BYTE* image );
+
+private:
+	const CMessageFile& input;
+	const CMessageIds& ids;
+	const CCompilerOptions& options;
+	CArrayView<CMessageLocale> locales;
+	const CAccessProfile* profile = nullptr;
+
+	// Range of message positions of a section and the total number of lookups of its messages.
+	struct CSectionAccess {
+		int FirstPos;
+		int EndPos;
+		int64_t Count;
+	};
+
+	__int64 getExpectedBlobSize() const;
+	void getLayoutOrder( CArray<int>& result ) const;
+	void addSectionAccess( CArrayView<CMessageSection> sections, int& messagePos, CArray<CSectionAccess>& result ) const;
+	void addMessages( const CMessageFile& file, int localeId, CArrayView<int> layoutOrder, CStringBlobBuilder& blob, CArray<int>& handles ) const;
+	static void getValues( CArrayView<CMessageSection> sections, CArray<CUnicodePart>& result );
+	static int encodeString( TMessageTableEncoding encoding, CUnicodePart str, BYTE* buffer );
+	static int getEncodedSize( TMessageTableEncoding encoding, CUnicodePart str );
+	static int getMessageCount( CArrayView<CMessageSection> sections );
+	void addParams( const CMessageFile& file, int localeId, CTables& tables ) const;
+	static void addParams( CArrayView<CMessageSection> sections, CArrayView<int> messageIds, CMessageParamEntry* entries, int& messagePos,
+		CArray<CMessageSegment>& segments );
+	static void resolveNames( const CStringBlobBuilder& blob, CIndexKeys& keys );
+	void compressBlob( const CStringBlobBuilder& blob, CArray<CBlobBlock>& blocks, CArray<BYTE>& result ) const;
+	static void addCompressedBlock( const BYTE* blobData, int start, int end, int charSize, CArray<CBlobBlock>& blocks, CArray<BYTE>& result );
+	static __int64 layoutIndex( const CPerfectHashBuilder& hash, __int64 offset, CHashIndexHeader& result );
+	static void writeIndex( const CPerfectHashBuilder& hash, const CIndexKeys& keys, const CHashIndexHeader& header, BYTE* image );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
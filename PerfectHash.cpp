@@ -0,0 +1,117 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <PerfectHash.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Average number of keys in a bucket. Larger buckets give a smaller seed table but take longer to place.
+const int perfectHashBucketLoad = 4;
+// Limit on the seed search. Reaching it means that the hashes are not distinct.
+const int32_t maxPerfectHashSeed = 1 << 24;
+
+CPerfectHashBuilder::CPerfectHashBuilder( CArrayView<uint64_t> hashes )
+{
+	build( hashes );
+}
+
+extern const CError Err_DuplicatePerfectHashKey( L"Failed to build a perfect hash index. Two keys have the same hash." );
+extern const CError Err_PerfectHashFailed( L"Failed to build a perfect hash index. Key set contains a hash collision." );
+// Equal hashes can never be placed, so they are rejected before the seed search.
+void CPerfectHashBuilder::build( CArrayView<uint64_t> hashes )
+{
+	const int slotCount = hashes.Size();
+	if( slotCount == 0 ) {
+		return;
+	}
+	CArray<uint64_t> sortedHashes;
+	sortedHashes.ReserveBuffer( slotCount );
+	for( const uint64_t hash : hashes ) {
+		sortedHashes.Add( hash );
+	}
+	std::sort( sortedHashes.begin(), sortedHashes.end() );
+	for( int i = 1; i < slotCount; i++ ) {
+		check( sortedHashes[i] != sortedHashes[i - 1], Err_DuplicatePerfectHashKey );
+	}
+	const int bucketCount = ( slotCount + perfectHashBucketLoad - 1 ) / perfectHashBucketLoad;
+	seeds.IncreaseSize( bucketCount );
+	slots.IncreaseSize( slotCount );
+
+	CArray<CArray<int>> buckets;
+	buckets.IncreaseSize( bucketCount );
+	for( int i = 0; i < slotCount; i++ ) {
+		buckets[GetPerfectHashBucket( hashes[i], bucketCount )].Add( i );
+	}
+	// Place the largest buckets first while most of the slots are free.
+	CArray<int> bucketOrder;
+	bucketOrder.IncreaseSize( bucketCount );
+	for( int i = 0; i < bucketCount; i++ ) {
+		bucketOrder[i] = i;
+		seeds[i] = 0;
+	}
+	std::stable_sort( bucketOrder.begin(), bucketOrder.end(),
+		[&buckets]( int left, int right ) { return buckets[left].Size() > buckets[right].Size(); } );
+
+	CArray<bool> usedSlots;
+	usedSlots.IncreaseSize( slotCount );
+	for( int i = 0; i < slotCount; i++ ) {
+		usedSlots[i] = false;
+	}
+
+	int freeSlot = 0;
+	for( int bucketId : bucketOrder ) {
+		const auto& bucket = buckets[bucketId];
+		if( bucket.Size() > 1 ) {
+			int32_t seed = 0;
+			while( !tryPlaceBucket( hashes, bucket, seed, usedSlots ) ) {
+				seed++;
+				check( seed < maxPerfectHashSeed, Err_PerfectHashFailed );
+			}
+			seeds[bucketId] = seed;
+		} else if( bucket.Size() == 1 ) {
+			// Single key buckets take the remaining slots directly.
+			while( usedSlots[freeSlot] ) {
+				freeSlot++;
+			}
+			usedSlots[freeSlot] = true;
+			slots[bucket[0]] = freeSlot;
+			seeds[bucketId] = -freeSlot - 1;
+		}
+	}
+}
+
+bool CPerfectHashBuilder::tryPlaceBucket( CArrayView<uint64_t> hashes, CArrayView<int> bucket, int32_t seed, CArray<bool>& usedSlots )
+{
+	const int bucketCount = seeds.Size();
+	const int slotCount = slots.Size();
+	// Temporarily put the seed in place to compute the slots the same way the lookup does.
+	const int bucketId = GetPerfectHashBucket( hashes[bucket[0]], bucketCount );
+	seeds[bucketId] = seed;
+
+	int placedCount = 0;
+	for( ; placedCount < bucket.Size(); placedCount++ ) {
+		const int keyId = bucket[placedCount];
+		const int slot = GetPerfectHashSlot( hashes[keyId], seeds.Ptr(), bucketCount, slotCount );
+		if( usedSlots[slot] ) {
+			break;
+		}
+		usedSlots[slot] = true;
+		slots[keyId] = slot;
+	}
+	if( placedCount == bucket.Size() ) {
+		return true;
+	}
+
+	// Roll back the partial placement.
+	for( int i = 0; i < placedCount; i++ ) {
+		usedSlots[slots[bucket[i]]] = false;
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
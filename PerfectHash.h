@@ -0,0 +1,53 @@
+#pragma once
+#include <HashUtils.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Minimal perfect hash built with the hash and displace method.
+// Keys are split into buckets by the high half of their hash. Each bucket stores a seed that maps all of its keys to distinct slots.
+// A negative seed stores the slot of a single key bucket directly.
+// Lookup computes the key hash once, reads the bucket seed and gets the only slot that may contain the key.
+
+inline int GetPerfectHashBucket( uint64_t hash, int bucketCount )
+{
+	return static_cast<int>( ( hash >> 32 ) % static_cast<uint32_t>( bucketCount ) );
+}
+
+inline int GetPerfectHashSlot( uint64_t hash, const int32_t* seeds, int bucketCount, int slotCount )
+{
+	const int32_t seed = seeds[GetPerfectHashBucket( hash, bucketCount )];
+	if( seed < 0 ) {
+		return -seed - 1;
+	}
+	return static_cast<int>( MixHash( hash ^ ( seed * 0x9E3779B97F4A7C15ULL ) ) % static_cast<uint32_t>( slotCount ) );
+}
+
+// Builder of the perfect hash seeds for a set of distinct hashes.
+class CPerfectHashBuilder {
+public:
+	explicit CPerfectHashBuilder( CArrayView<uint64_t> hashes );
+
+	int BucketCount() const
+		{ return seeds.Size(); }
+	int SlotCount() const
+		{ return slots.Size(); }
+	CArrayView<int32_t> Seeds() const
+		{ return seeds; }
+	// Slot assigned to each of the hashes.
+	CArrayView<int> Slots() const
+		{ return slots; }
+
+private:
+	CArray<int32_t> seeds;
+	CArray<int> slots;
+
+	void build( CArrayView<uint64_t> hashes );
+	bool tryPlaceBucket( CArrayView<uint64_t> hashes, CArrayView<int> bucket, int32_t seed, CArray<bool>& usedSlots );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,204 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <StreamingTableWriter.h>
+#include <MessageFile.h>
+#include <MessageIdMap.h>
+#include <LzCodec.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Size of the writes of an uncompressed blob and of the parts of the blob copy.
+static const int writeBufferSize = 1 << 20;
+
+extern const CError Err_BlobFileFailed( L"Temporary blob file operation failed.\nError code: %0." );
+CStreamingTableWriter::CStreamingTableWriter( const CCompilerOptions& options ) :
+	encoding( options.Encoding ),
+	compressionBlockSize( options.CompressionBlockSize )
+{
+	wchar_t tempPath[MAX_PATH + 1];
+	wchar_t tempName[MAX_PATH + 1];
+	const bool hasName = ::GetTempPathW( MAX_PATH + 1, tempPath ) != 0 && ::GetTempFileNameW( tempPath, L"msg", 0, tempName ) != 0;
+	check( hasName, Err_BlobFileFailed, static_cast<int>( ::GetLastError() ) );
+	blobFile = ::CreateFileW( tempName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr );
+	if( blobFile == INVALID_HANDLE_VALUE ) {
+		const DWORD errorCode = ::GetLastError();
+		::DeleteFileW( tempName );
+		check( false, Err_BlobFileFailed, static_cast<int>( errorCode ) );
+	}
+}
+
+CStreamingTableWriter::~CStreamingTableWriter()
+{
+	::CloseHandle( blobFile );
+}
+
+void CStreamingTableWriter::AddMessage( bool isNamedSection, CUnicodePart value )
+{
+	const CStoredString str = addString( value );
+	if( isNamedSection ) {
+		namedMessages.Add( str );
+	} else {
+		unnamedMessages.Add( str );
+	}
+}
+
+void CStreamingTableWriter::CreateTables( const CMessageFile& input, const CMessageIds& ids, CMessageTableStats& stats )
+{
+	assert( unnamedMessages.Size() + namedMessages.Size() == input.MessageCount() );
+	const int messageCount = ids.MessageIdLimit;
+	CMessageTableWriter::CTables result;
+	CArray<CMessageTableEntry>& entries = result.Entries;
+	entries.IncreaseSize( messageCount );
+	if( messageCount > input.MessageCount() ) {
+		// Message IDs that are not used by the file point to an empty string.
+		const CMessageTableEntry emptyEntry = getEntry( addString( CUnicodePart() ) );
+		for( auto& entry : entries ) {
+			entry = emptyEntry;
+		}
+	}
+	int messagePos = 0;
+	for( const auto& message : unnamedMessages ) {
+		entries[ids.MessageIds[messagePos]] = getEntry( message );
+		messagePos++;
+	}
+	for( const auto& message : namedMessages ) {
+		entries[ids.MessageIds[messagePos]] = getEntry( message );
+		messagePos++;
+	}
+
+	const auto addName = [this]( CUnicodePart name ) {
+		names.Add( addString( name ) );
+		return names.Size() - 1;
+	};
+	CMessageTableWriter::AddIndexKeys( input, ids, encoding, unnamedMessages.Size(), addName, result.SectionKeys, result.MessageKeys );
+	resolveNames( result.SectionKeys );
+	resolveNames( result.MessageKeys );
+	flushPendingData();
+
+	CMessageTableHeader header{};
+	header.Encoding = encoding;
+	header.CharSize = GetEncodingCharSize( encoding );
+	header.MessageCount = messageCount;
+	header.SectionCount = ids.SectionIdLimit;
+	header.FirstNamedSectionId = CMessageTableWriter::GetFirstNamedSectionId( input, ids );
+	header.BlobSize = blobSize;
+	header.StoredBlobSize = storedBlobSize;
+	result.Blocks = move( blocks );
+	CMessageTableWriter::CreateTables( header, result, tables );
+	CMessageTableWriter::SetTableHash( blobHash, tables.Ptr() );
+	stats.RawBlobSize = blobSize;
+	stats.BlobSize = blobSize;
+	stats.StoredBlobSize = storedBlobSize;
+}
+
+// The blob is copied after the tables in parts.
+void CStreamingTableWriter::Write( CUnicodeView fileName ) const
+{
+	CFileWriter outputFile( fileName, FCM_CreateAlways );
+	outputFile.Write( tables.Ptr(), tables.Size() );
+
+	LARGE_INTEGER start{};
+	check( ::SetFilePointerEx( blobFile, start, nullptr, FILE_BEGIN ) != FALSE, Err_BlobFileFailed, static_cast<int>( ::GetLastError() ) );
+	CArray<BYTE> buffer;
+	buffer.IncreaseSize( writeBufferSize );
+	for( uint64_t copiedSize = 0; copiedSize < storedBlobSize; ) {
+		const uint64_t restSize = storedBlobSize - copiedSize;
+		const DWORD size = static_cast<DWORD>( restSize < static_cast<uint64_t>( writeBufferSize ) ? restSize : writeBufferSize );
+		DWORD readSize = 0;
+		const bool isRead = ::ReadFile( blobFile, buffer.Ptr(), size, &readSize, nullptr ) != FALSE && readSize == size;
+		check( isRead, Err_BlobFileFailed, static_cast<int>( ::GetLastError() ) );
+		outputFile.Write( buffer.Ptr(), static_cast<int>( size ) );
+		copiedSize += size;
+	}
+}
+
+// Strings are collected until the pending data reaches the block size, so blocks end on string boundaries as in CMessageTableWriter.
+CStreamingTableWriter::CStoredString CStreamingTableWriter::addString( CUnicodePart str )
+{
+	const int charSize = GetEncodingCharSize( encoding );
+	const int size = ( encoding == MTE_Utf8 ? CUtf8::EncodedSize( str ) : str.Length() * charSize ) + charSize;
+	const int start = pendingData.Size();
+	pendingData.IncreaseSize( start + size );
+	BYTE* data = pendingData.Ptr() + start;
+	if( encoding == MTE_Utf8 ) {
+		CUtf8::Encode( str, data );
+	} else {
+		memcpy( data, str.Ptr(), str.Length() * sizeof( wchar_t ) );
+	}
+	memset( data + size - charSize, 0, charSize );
+
+	CStoredString result;
+	result.Offset = blobSize;
+	result.Length = static_cast<uint32_t>( size / charSize - 1 );
+	blobSize += size;
+	if( pendingData.Size() >= ( compressionBlockSize > 0 ? compressionBlockSize : writeBufferSize ) ) {
+		flushPendingData();
+	}
+	return result;
+}
+
+// Blocks that don't benefit from compression are stored as is. Every block is aligned to the char size.
+void CStreamingTableWriter::flushPendingData()
+{
+	const int size = pendingData.Size();
+	if( size == 0 ) {
+		return;
+	}
+	if( compressionBlockSize == 0 ) {
+		writeBlob( pendingData.Ptr(), size );
+	} else {
+		CArray<BYTE> compressed;
+		CLzCodec::Compress( pendingData.Ptr(), size, compressed );
+		const bool isRaw = compressed.Size() >= size;
+		const int charSize = GetEncodingCharSize( encoding );
+		const int paddingSize = static_cast<int>( ( charSize - storedBlobSize % charSize ) % charSize );
+		if( paddingSize > 0 ) {
+			const BYTE padding[sizeof( wchar_t )] = {};
+			writeBlob( padding, paddingSize );
+		}
+
+		CBlobBlock block{};
+		block.UncompressedOffset = blobSize - size;
+		block.CompressedOffset = storedBlobSize;
+		block.UncompressedSize = size;
+		block.CompressedSize = isRaw ? size : compressed.Size();
+		blocks.Add( block );
+		writeBlob( isRaw ? pendingData.Ptr() : compressed.Ptr(), block.CompressedSize );
+	}
+	pendingData.Empty();
+}
+
+void CStreamingTableWriter::writeBlob( const BYTE* data, int size )
+{
+	DWORD writtenSize = 0;
+	const bool isWritten = ::WriteFile( blobFile, data, static_cast<DWORD>( size ), &writtenSize, nullptr ) != FALSE
+		&& static_cast<int>( writtenSize ) == size;
+	check( isWritten, Err_BlobFileFailed, static_cast<int>( ::GetLastError() ) );
+	storedBlobSize += size;
+	blobHash = HashBytes( data, size, blobHash );
+}
+
+void CStreamingTableWriter::resolveNames( CMessageTableWriter::CIndexKeys& keys ) const
+{
+	for( int i = 0; i < keys.Slots.Size(); i++ ) {
+		const CStoredString& name = names[keys.NameHandles[i]];
+		keys.Slots[i].NameOffset = name.Offset;
+		keys.Slots[i].NameLength = name.Length;
+	}
+}
+
+CMessageTableEntry CStreamingTableWriter::getEntry( const CStoredString& str )
+{
+	CMessageTableEntry result{};
+	result.Offset = str.Offset;
+	result.Length = str.Length;
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,70 @@
+#pragma once
+#include <MessageTableWriter.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Creator of a memory-mappable message table for a message file that is parsed in the streaming mode.
+// Messages are encoded and written to a temporary blob file while the file is parsed, only their blob positions are kept in memory.
+// A compressed blob is compressed block by block as the blocks fill up. The tables are created when the IDs are known,
+// and the table file is written as the tables followed by a copy of the temporary blob.
+// Messages are stored in the file order. String merging is not supported.
+class CStreamingTableWriter {
+public:
+	explicit CStreamingTableWriter( const CCompilerOptions& options );
+	~CStreamingTableWriter();
+
+	// Append a message. Messages of the unnamed and the named sections are enumerated separately, as they come in the file.
+	void AddMessage( bool isNamedSection, CUnicodePart value );
+
+	// Finish the blob and create the tables. Must be called once, after all the messages are added.
+	void CreateTables( const CMessageFile& input, const CMessageIds& ids, CMessageTableStats& stats );
+	// Size of the table file.
+	__int64 Size() const
+		{ return tables.Size() + static_cast<__int64>( storedBlobSize ); }
+	// Hash of the stored blob followed by the tables.
+	uint64_t ContentHash() const
+		{ return HashBytes( tables.Ptr(), tables.Size(), blobHash ); }
+	// Write the table file.
+	void Write( CUnicodeView fileName ) const;
+
+private:
+	// Position of a string in the uncompressed blob.
+	struct CStoredString {
+		uint64_t Offset;
+		// Length in code units not including the terminator.
+		uint32_t Length;
+	};
+
+	TMessageTableEncoding encoding;
+	int compressionBlockSize;
+	// The file is deleted when its handle is closed.
+	HANDLE blobFile = INVALID_HANDLE_VALUE;
+	CArray<CStoredString> unnamedMessages;
+	CArray<CStoredString> namedMessages;
+	// Names of the index slots. They follow the messages in the blob.
+	CArray<CStoredString> names;
+	// Encoded strings that are not written yet. A compressed blob keeps a single block here.
+	CArray<BYTE> pendingData;
+	uint64_t blobSize = 0;
+	uint64_t storedBlobSize = 0;
+	uint64_t blobHash = HashOffsetBasis;
+	CArray<CBlobBlock> blocks;
+	// Header and tables that precede the blob.
+	CArray<BYTE> tables;
+
+	CStoredString addString( CUnicodePart str );
+	void flushPendingData();
+	void writeBlob( const BYTE* data, int size );
+	void resolveNames( CMessageTableWriter::CIndexKeys& keys ) const;
+	static CMessageTableEntry getEntry( const CStoredString& str );
+
+	// Copying is prohibited.
+	CStreamingTableWriter( CStreamingTableWriter& ) = delete;
+	void operator=( CStreamingTableWriter& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,52 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <StringArena.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Chunk sizes in characters. The unused end of the last chunk is never larger than the maximum size.
+const int minArenaChunkSize = 64 * 1024;
+const int maxArenaChunkSize = 1024 * 1024;
+
+CUnicodePart CStringArena::Add( CUnicodePart str )
+{
+	const int length = str.Length();
+	wchar_t* buffer = allocate( length + 1 );
+	memcpy( buffer, str.Ptr(), length * sizeof( wchar_t ) );
+	buffer[length] = 0;
+	return CUnicodePart( buffer, length );
+}
+
+wchar_t* CStringArena::allocate( int size )
+{
+	if( size > freeSize ) {
+		// Chunks grow geometrically up to the maximum size, so small files take little memory and large files take few chunks.
+		const int lastChunkSize = chunks.IsEmpty() ? 0 : chunks.Last().Size();
+		int newChunkSize = lastChunkSize * 2 < maxArenaChunkSize ? lastChunkSize * 2 : maxArenaChunkSize;
+		newChunkSize = newChunkSize < minArenaChunkSize ? minArenaChunkSize : newChunkSize;
+		addChunk( size > newChunkSize ? size : newChunkSize );
+	}
+
+	wchar_t* result = freePtr;
+	freePtr += size;
+	freeSize -= size;
+	totalSize += size;
+	return result;
+}
+
+void CStringArena::addChunk( int size )
+{
+	chunks.IncreaseSize( chunks.Size() + 1 );
+	CArray<wchar_t>& chunk = chunks.Last();
+	chunk.IncreaseSize( size );
+	freePtr = chunk.Ptr();
+	freeSize = size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
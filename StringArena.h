@@ -0,0 +1,40 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Storage for immutable strings allocated in large chunks.
+// Strings are never freed separately, all the memory is released with the arena.
+class CStringArena {
+public:
+	CStringArena() = default;
+
+	// Copy a string to the arena. The copy is null-terminated and stays valid while the arena exists.
+	CUnicodePart Add( CUnicodePart str );
+
+	// Size of all the added strings in code units including terminators.
+	__int64 Size() const
+		{ return totalSize; }
+	int ChunkCount() const
+		{ return chunks.Size(); }
+
+private:
+	CArray<CArray<wchar_t>> chunks;
+	// Unused space in the last chunk.
+	wchar_t* freePtr = nullptr;
+	int freeSize = 0;
+	__int64 totalSize = 0;
+
+	wchar_t* allocate( int size );
+	void addChunk( int size );
+
+	// Copying is prohibited.
+	CStringArena( CStringArena& ) = delete;
+	void operator=( CStringArena& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,130 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <StringBlob.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+CStringBlobBuilder::CStringBlobBuilder( TMessageTableEncoding _encoding, int expectedSize ) :
+	encoding( _encoding ),
+	charSize( GetEncodingCharSize( _encoding ) )
+{
+	staging.ReserveBuffer( expectedSize );
+}
+
+int CStringBlobBuilder::Add( CUnicodePart str )
+{
+	const int offset = staging.Size();
+	const int byteLength = encoding == MTE_Utf8 ? CUtf8::EncodedSize( str ) : str.Length() * charSize;
+	staging.IncreaseSize( offset + byteLength + charSize );
+	BYTE* buffer = staging.Ptr() + offset;
+	if( encoding == MTE_Utf8 ) {
+		CUtf8::Encode( str, buffer );
+	} else {
+		memcpy( buffer, str.Ptr(), byteLength );
+	}
+	memset( buffer + byteLength, 0, charSize );
+
+	CStringInfo info;
+	info.StagingOffset = offset;
+	info.Size = byteLength + charSize;
+	info.Offset = offset;
+	strings.Add( info );
+	return strings.Size() - 1;
+}
+
+void CStringBlobBuilder::Build( bool mergeStrings )
+{
+	rawSize = staging.Size();
+	if( mergeStrings ) {
+		buildMerged();
+	} else {
+		// Offsets are already equal to the staging positions.
+		blob = move( staging );
+		storedStringEnds.ReserveBuffer( strings.Size() );
+		for( const auto& info : strings ) {
+			storedStringEnds.Add( info.Offset + info.Size );
+		}
+	}
+}
+
+// Strings are sorted by their reversed contents. A string that ends another string then immediately follows
+// either that string or another string with the same ending, so a single comparison with the previous string finds it.
+void CStringBlobBuilder::buildMerged()
+{
+	const int stringCount = strings.Size();
+	CArray<int> order;
+	order.IncreaseSize( stringCount );
+	for( int i = 0; i < stringCount; i++ ) {
+		order[i] = i;
+	}
+	std::sort( order.begin(), order.end(), [this]( int left, int right ) {
+		const int compareResult = compareReversed( strings[left], strings[right] );
+		return compareResult != 0 ? compareResult > 0 : left < right;
+	} );
+
+	// Each string is either stored itself or placed at the given byte shift inside its owner.
+	CArray<int> owners;
+	CArray<int> ownerShifts;
+	owners.IncreaseSize( stringCount );
+	ownerShifts.IncreaseSize( stringCount );
+	for( int i = 0; i < stringCount; i++ ) {
+		const int handle = order[i];
+		owners[handle] = handle;
+		ownerShifts[handle] = 0;
+		if( i > 0 && isSuffix( strings[order[i - 1]], strings[handle] ) ) {
+			const int previous = order[i - 1];
+			owners[handle] = owners[previous];
+			ownerShifts[handle] = ownerShifts[previous] + strings[previous].Size - strings[handle].Size;
+		}
+	}
+
+	// Stored strings keep the order of addition.
+	blob.ReserveBuffer( staging.Size() );
+	for( int handle = 0; handle < stringCount; handle++ ) {
+		if( owners[handle] != handle ) {
+			continue;
+		}
+		CStringInfo& info = strings[handle];
+		info.Offset = blob.Size();
+		blob.IncreaseSize( info.Offset + info.Size );
+		memcpy( blob.Ptr() + info.Offset, staging.Ptr() + info.StagingOffset, info.Size );
+		storedStringEnds.Add( blob.Size() );
+	}
+	for( int handle = 0; handle < stringCount; handle++ ) {
+		strings[handle].Offset = strings[owners[handle]].Offset + ownerShifts[handle];
+	}
+}
+
+bool CStringBlobBuilder::isSuffix( const CStringInfo& str, const CStringInfo& suffix ) const
+{
+	if( suffix.Size > str.Size ) {
+		return false;
+	}
+	const BYTE* strEnd = staging.Ptr() + str.StagingOffset + str.Size;
+	const BYTE* suffixStart = staging.Ptr() + suffix.StagingOffset;
+	return memcmp( strEnd - suffix.Size, suffixStart, suffix.Size ) == 0;
+}
+
+// Compare strings from the end. Return a positive value if left is greater.
+// Strings are compared by code units so that a shared ending never starts in the middle of a wide character.
+int CStringBlobBuilder::compareReversed( const CStringInfo& left, const CStringInfo& right ) const
+{
+	const BYTE* leftPtr = staging.Ptr() + left.StagingOffset + left.Size;
+	const BYTE* rightPtr = staging.Ptr() + right.StagingOffset + right.Size;
+	const int commonSize = left.Size < right.Size ? left.Size : right.Size;
+	for( int pos = charSize; pos <= commonSize; pos += charSize ) {
+		const int compareResult = memcmp( leftPtr - pos, rightPtr - pos, charSize );
+		if( compareResult != 0 ) {
+			return compareResult;
+		}
+	}
+	return left.Size - right.Size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,64 @@
+#pragma once
+#include <MessageTableFormat.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Builder of the message table string blob.
+// Strings are added first and laid out afterwards. The final offsets are available after the layout.
+class CStringBlobBuilder {
+public:
+	CStringBlobBuilder( TMessageTableEncoding encoding, int expectedSize );
+
+	// Add a string and return its handle.
+	int Add( CUnicodePart str );
+	// String length in code units of the blob encoding not including the terminator.
+	int GetLength( int handle ) const
+		{ return ( strings[handle].Size / charSize ) - 1; }
+
+	// Lay out the strings in the order of addition.
+	// If merging is enabled, identical strings and strings that end another string share the same bytes.
+	void Build( bool mergeStrings );
+
+	// String offset in the final blob.
+	int GetOffset( int handle ) const
+		{ return strings[handle].Offset; }
+	CArrayView<BYTE> GetBlob() const
+		{ return blob; }
+	// Size of all the added strings before merging.
+	int RawSize() const
+		{ return rawSize; }
+	// End positions of the strings stored in the blob. Merged strings lie inside the stored ones,
+	// so no string crosses these positions.
+	CArrayView<int> GetStoredStringEnds() const
+		{ return storedStringEnds; }
+
+private:
+	struct CStringInfo {
+		// Position in the staging buffer.
+		int StagingOffset;
+		// Size in bytes including the terminator.
+		int Size;
+		// Position in the final blob.
+		int Offset;
+	};
+
+	TMessageTableEncoding encoding;
+	int charSize;
+	// Encoded strings in the order of addition.
+	CArray<BYTE> staging;
+	CArray<CStringInfo> strings;
+	CArray<BYTE> blob;
+	CArray<int> storedStringEnds;
+	int rawSize = 0;
+
+	void buildMerged();
+	bool isSuffix( const CStringInfo& str, const CStringInfo& suffix ) const;
+	int compareReversed( const CStringInfo& left, const CStringInfo& right ) const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,88 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <TextFileReader.h>
+#include <Utf8.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+extern const CError Err_CannotReadFile( L"Failed to read a file.\nFile name: %0. Error code: %1." );
+CTextFileReader::CTextFileReader( CUnicodeView _fileName ) :
+	fileName( _fileName )
+{
+	file = ::CreateFileW( fileName.Ptr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+	check( file != INVALID_HANDLE_VALUE, Err_CannotReadFile, fileName, static_cast<int>( ::GetLastError() ) );
+}
+
+CTextFileReader::~CTextFileReader()
+{
+	::CloseHandle( file );
+}
+
+bool CTextFileReader::Read( int byteCount, CUnicodeString& result )
+{
+	if( buffer.Size() < pendingSize + byteCount ) {
+		buffer.IncreaseSize( pendingSize + byteCount );
+	}
+	DWORD readSize = 0;
+	const BOOL isRead = ::ReadFile( file, buffer.Ptr() + pendingSize, static_cast<DWORD>( byteCount ), &readSize, nullptr );
+	check( isRead != FALSE, Err_CannotReadFile, fileName, static_cast<int>( ::GetLastError() ) );
+	// Reads of a disk file are short only at the end of the file.
+	const bool isEnd = static_cast<int>( readSize ) < byteCount;
+
+	const int size = pendingSize + static_cast<int>( readSize );
+	const int start = isStarted ? 0 : skipByteOrderMark( size );
+	isStarted = true;
+	const int completeSize = getCompleteSize( start, size, isEnd );
+	const BYTE* data = buffer.Ptr();
+	if( isUtf16 ) {
+		result += CUnicodePart( reinterpret_cast<const wchar_t*>( data + start ), ( completeSize - start ) / sizeof( wchar_t ) );
+	} else {
+		CUtf8::Decode( data + start, completeSize - start, result );
+	}
+
+	pendingSize = size - completeSize;
+	memmove( buffer.Ptr(), data + completeSize, pendingSize );
+	return !isEnd;
+}
+
+// Detect the encoding by the first read bytes. Return the size of the mark.
+int CTextFileReader::skipByteOrderMark( int size )
+{
+	const BYTE* data = buffer.Ptr();
+	if( size >= 2 && data[0] == 0xFF && data[1] == 0xFE ) {
+		isUtf16 = true;
+		return 2;
+	}
+	if( size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF ) {
+		return 3;
+	}
+	return 0;
+}
+
+// Size of the data that ends on a character boundary. A character cut by the end of the file is decoded as invalid.
+int CTextFileReader::getCompleteSize( int start, int size, bool isEnd ) const
+{
+	if( isUtf16 ) {
+		return start + ( size - start ) / sizeof( wchar_t ) * sizeof( wchar_t );
+	}
+	if( isEnd ) {
+		return size;
+	}
+	// Find the lead byte of the last sequence. UTF-8 sequences are at most four bytes long.
+	const BYTE* data = buffer.Ptr();
+	for( int pos = size - 1; pos >= start && pos >= size - 3; pos-- ) {
+		const BYTE byte = data[pos];
+		if( ( byte & 0xC0 ) != 0x80 ) {
+			const int sequenceLength = byte >= 0xF0 ? 4 : ( byte >= 0xE0 ? 3 : ( byte >= 0xC0 ? 2 : 1 ) );
+			return pos + sequenceLength > size ? pos : size;
+		}
+	}
+	return size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Sequential reader of a text file that decodes the file to wide characters a part at a time.
+// UTF-16 files must start with a byte order mark. Other files are decoded as UTF-8 with or without the mark.
+// Only streamed message files are decoded by this class, whole files are read by File::ReadUnicodeText.
+class CTextFileReader {
+public:
+	explicit CTextFileReader( CUnicodeView fileName );
+	~CTextFileReader();
+
+	// Read up to the given number of bytes and append the decoded text to result.
+	// A character that is split by the end of the read is decoded by the next read.
+	// Return false if the end of the file has been reached.
+	bool Read( int byteCount, CUnicodeString& result );
+
+private:
+	CUnicodeString fileName;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	bool isUtf16 = false;
+	bool isStarted = false;
+	// Read bytes. The undecoded bytes of the last read are kept at the start.
+	CArray<BYTE> buffer;
+	int pendingSize = 0;
+
+	int skipByteOrderMark( int size );
+	int getCompleteSize( int start, int size, bool isEnd ) const;
+
+	// Copying is prohibited.
+	CTextFileReader( CTextFileReader& ) = delete;
+	void operator=( CTextFileReader& ) = delete;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
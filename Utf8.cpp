@@ -0,0 +1,157 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <Utf8.h>
+#include <HashUtils.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+const unsigned replacementCodePoint = 0xFFFD;
+// Maximum length of a single code point in UTF-8.
+const int maxEncodedCodePointSize = 4;
+
+int CUtf8::EncodedSize( CUnicodePart str )
+{
+	BYTE buffer[maxEncodedCodePointSize];
+	int result = 0;
+	for( int pos = 0; pos < str.Length(); ) {
+		result += encodeCodePoint( readCodePoint( str, pos ), buffer );
+	}
+	return result;
+}
+
+int CUtf8::Encode( CUnicodePart str, BYTE* buffer )
+{
+	BYTE* bufferPos = buffer;
+	for( int pos = 0; pos < str.Length(); ) {
+		bufferPos += encodeCodePoint( readCodePoint( str, pos ), bufferPos );
+	}
+	return static_cast<int>( bufferPos - buffer );
+}
+
+void CUtf8::Decode( const BYTE* data, int size, CUnicodeString& result )
+{
+	for( int pos = 0; pos < size; ) {
+		const unsigned codePoint = readEncodedCodePoint( data, size, pos );
+		if( codePoint >= 0x10000 ) {
+			result += static_cast<wchar_t>( 0xD800 + ( ( codePoint - 0x10000 ) >> 10 ) );
+			result += static_cast<wchar_t>( 0xDC00 + ( ( codePoint - 0x10000 ) & 0x3FF ) );
+		} else {
+			result += static_cast<wchar_t>( codePoint );
+		}
+	}
+}
+
+uint64_t CUtf8::Hash( CUnicodePart str, uint64_t hash )
+{
+	BYTE buffer[maxEncodedCodePointSize];
+	for( int pos = 0; pos < str.Length(); ) {
+		const int size = encodeCodePoint( readCodePoint( str, pos ), buffer );
+		hash = HashBytes( buffer, size, hash );
+	}
+	return hash;
+}
+
+bool CUtf8::Equals( const BYTE* data, int size, CUnicodePart str )
+{
+	BYTE buffer[maxEncodedCodePointSize];
+	int dataPos = 0;
+	for( int pos = 0; pos < str.Length(); ) {
+		const int codePointSize = encodeCodePoint( readCodePoint( str, pos ), buffer );
+		if( dataPos + codePointSize > size || memcmp( data + dataPos, buffer, codePointSize ) != 0 ) {
+			return false;
+		}
+		dataPos += codePointSize;
+	}
+	return dataPos == size;
+}
+
+// Get a code point from a UTF-16 string and move the position past it.
+unsigned CUtf8::readCodePoint( CUnicodePart str, int& pos )
+{
+	const unsigned first = static_cast<unsigned>( str[pos] );
+	pos++;
+	if( first < 0xD800 || first > 0xDFFF ) {
+		return first;
+	}
+	if( first > 0xDBFF || pos >= str.Length() ) {
+		return replacementCodePoint;
+	}
+	const unsigned second = static_cast<unsigned>( str[pos] );
+	if( second < 0xDC00 || second > 0xDFFF ) {
+		return replacementCodePoint;
+	}
+	pos++;
+	return 0x10000 + ( ( first - 0xD800 ) << 10 ) + ( second - 0xDC00 );
+}
+
+// Get a code point from a UTF-8 string and move the position past it.
+unsigned CUtf8::readEncodedCodePoint( const BYTE* data, int size, int& pos )
+{
+	const unsigned first = data[pos];
+	pos++;
+	if( first < 0x80 ) {
+		return first;
+	}
+
+	int continuationCount;
+	unsigned codePoint;
+	unsigned minCodePoint;
+	if( ( first & 0xE0 ) == 0xC0 ) {
+		continuationCount = 1;
+		codePoint = first & 0x1F;
+		minCodePoint = 0x80;
+	} else if( ( first & 0xF0 ) == 0xE0 ) {
+		continuationCount = 2;
+		codePoint = first & 0x0F;
+		minCodePoint = 0x800;
+	} else if( ( first & 0xF8 ) == 0xF0 ) {
+		continuationCount = 3;
+		codePoint = first & 0x07;
+		minCodePoint = 0x10000;
+	} else {
+		return replacementCodePoint;
+	}
+
+	for( int i = 0; i < continuationCount; i++ ) {
+		if( pos >= size || ( data[pos] & 0xC0 ) != 0x80 ) {
+			return replacementCodePoint;
+		}
+		codePoint = ( codePoint << 6 ) | ( data[pos] & 0x3F );
+		pos++;
+	}
+
+	const bool isSurrogate = codePoint >= 0xD800 && codePoint <= 0xDFFF;
+	return codePoint < minCodePoint || codePoint > 0x10FFFF || isSurrogate ? replacementCodePoint : codePoint;
+}
+
+int CUtf8::encodeCodePoint( unsigned codePoint, BYTE* buffer )
+{
+	if( codePoint < 0x80 ) {
+		buffer[0] = static_cast<BYTE>( codePoint );
+		return 1;
+	}
+	if( codePoint < 0x800 ) {
+		buffer[0] = static_cast<BYTE>( 0xC0 | ( codePoint >> 6 ) );
+		buffer[1] = static_cast<BYTE>( 0x80 | ( codePoint & 0x3F ) );
+		return 2;
+	}
+	if( codePoint < 0x10000 ) {
+		buffer[0] = static_cast<BYTE>( 0xE0 | ( codePoint >> 12 ) );
+		buffer[1] = static_cast<BYTE>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+		buffer[2] = static_cast<BYTE>( 0x80 | ( codePoint & 0x3F ) );
+		return 3;
+	}
+	buffer[0] = static_cast<BYTE>( 0xF0 | ( codePoint >> 18 ) );
+	buffer[1] = static_cast<BYTE>( 0x80 | ( ( codePoint >> 12 ) & 0x3F ) );
+	buffer[2] = static_cast<BYTE>( 0x80 | ( ( codePoint >> 6 ) & 0x3F ) );
+	buffer[3] = static_cast<BYTE>( 0x80 | ( codePoint & 0x3F ) );
+	return 4;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
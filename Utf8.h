@@ -0,0 +1,32 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// Conversion between wide strings and UTF-8.
+// Wide strings are UTF-16. Unpaired surrogates are replaced with U+FFFD.
+class CUtf8 {
+public:
+	// Size of the UTF-8 representation of a string in bytes.
+	static int EncodedSize( CUnicodePart str );
+	// Encode a string to the buffer. The buffer must have at least EncodedSize( str ) bytes. Return the number of written bytes.
+	static int Encode( CUnicodePart str, BYTE* buffer );
+	// Decode a UTF-8 string and append it to result. Invalid sequences are replaced with U+FFFD.
+	static void Decode( const BYTE* data, int size, CUnicodeString& result );
+
+	// Hash of the UTF-8 representation of a string. Equal to HashBytes of the encoded string.
+	static uint64_t Hash( CUnicodePart str, uint64_t hash );
+	// Compare a UTF-8 string with a wide string without converting either of them.
+	static bool Equals( const BYTE* data, int size, CUnicodePart str );
+
+private:
+	static unsigned readCodePoint( CUnicodePart str, int& pos );
+	static unsigned readEncodedCodePoint( const BYTE* data, int size, int& pos );
+	static int encodeCodePoint( unsigned codePoint, BYTE* buffer );
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
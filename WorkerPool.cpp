@@ -0,0 +1,118 @@
+#include <common.h>
+#pragma hdrstop
+
+#include <WorkerPool.h>
+#include <CompileStats.h>
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// A range of task indices owned by a single worker.
+// The owner takes tasks from the front, thieves take tasks from the back.
+class CTaskRange {
+public:
+	void Reset( int newBegin, int newEnd )
+		{ begin = newBegin; end = newEnd; }
+
+	bool PopFront( int& task );
+	bool PopBack( int& task );
+
+private:
+	std::mutex lock;
+	int begin = 0;
+	int end = 0;
+};
+
+bool CTaskRange::PopFront( int& task )
+{
+	std::lock_guard<std::mutex> guard( lock );
+	if( begin >= end ) {
+		return false;
+	}
+	task = begin;
+	begin++;
+	return true;
+}
+
+bool CTaskRange::PopBack( int& task )
+{
+	std::lock_guard<std::mutex> guard( lock );
+	if( begin >= end ) {
+		return false;
+	}
+	end--;
+	task = end;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CWorkerPool::CWorkerPool( int _workerCount ) :
+	workerCount( _workerCount )
+{
+	if( workerCount <= 0 ) {
+		const int hardwareCount = static_cast<int>( std::thread::hardware_concurrency() );
+		workerCount = hardwareCount > 0 ? hardwareCount : 1;
+	}
+}
+
+static bool stealTask( CTaskRange* ranges, int rangeCount, int thiefId, int& task )
+{
+	for( int i = 1; i < rangeCount; i++ ) {
+		if( ranges[( thiefId + i ) % rangeCount].PopBack( task ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void CWorkerPool::Run( int taskCount, const std::function<void( int )>& action ) const
+{
+	const int threadCount = taskCount < workerCount ? taskCount : workerCount;
+	if( threadCount <= 1 ) {
+		for( int i = 0; i < taskCount; i++ ) {
+			action( i );
+		}
+		return;
+	}
+
+	std::unique_ptr<CTaskRange[]> ranges( new CTaskRange[threadCount] );
+	for( int i = 0; i < threadCount; i++ ) {
+		const int begin = static_cast<int>( static_cast<__int64>( taskCount ) * i / threadCount );
+		const int end = static_cast<int>( static_cast<__int64>( taskCount ) * ( i + 1 ) / threadCount );
+		ranges[i].Reset( begin, end );
+	}
+
+	const auto workerProc = [&]( int workerId ) {
+		int task;
+		for( ;; ) {
+			if( ranges[workerId].PopFront( task ) || stealTask( ranges.get(), threadCount, workerId, task ) ) {
+				action( task );
+			} else {
+				// No task can be added after the start so an empty pool means that the work is done.
+				return;
+			}
+		}
+	};
+
+	// The workers count their allocations into the phase of the calling thread.
+	CAllocationScope* allocationScope = CCompileStats::GetAllocationScope();
+	std::vector<std::thread> threads;
+	threads.reserve( threadCount - 1 );
+	for( int i = 1; i < threadCount; i++ ) {
+		threads.emplace_back( [&, allocationScope]( int workerId ) {
+			CCompileStats::SetAllocationScope( allocationScope );
+			workerProc( workerId );
+		}, i );
+	}
+	workerProc( 0 );
+	for( auto& thread : threads ) {
+		thread.join();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace Msg {
+
+//////////////////////////////////////////////////////////////////////////
+
+// A pool of worker threads that processes a range of independent tasks.
+// Tasks are initially split between the workers in contiguous ranges.
+// A worker that runs out of its own tasks steals tasks from the back of the other workers' ranges.
+class CWorkerPool {
+public:
+	// Create a pool with the given number of workers. Zero means one worker per hardware thread.
+	explicit CWorkerPool( int workerCount = 0 );
+
+	int WorkerCount() const
+		{ return workerCount; }
+
+	// Call action( taskIndex ) for every index in [0, taskCount) and wait for all the tasks to finish.
+	// The action must not throw, task errors have to be handled by the caller.
+	void Run( int taskCount, const std::function<void( int )>& action ) const;
+
+private:
+	int workerCount;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+}	// namespace Msg.
+
@@ -2,21 +2,64 @@
 #pragma hdrstop
 
 #include <MessageCompiler.h>
+#include <BatchCompiler.h>
+#include <LocaleCompiler.h>
+#include <CommandLine.h>
+#include <CompileStats.h>
 
-int wmain( int argc, wchar_t* argv[] )
+static int compileBatch( const Msg::CCommandLine& commandLine )
+{
+	Msg::CBatchCompiler compiler( commandLine.WorkerCount(), commandLine.Options() );
+	for( auto manifest : commandLine.FileNames() ) {
+		compiler.AddManifest( manifest );
+	}
+	const int failedCount = compiler.Compile();
+	return failedCount == 0 ? 0 : -1;
+}
+
+static int compileLocales( const Msg::CCommandLine& commandLine )
+{
+	const auto fileNames = commandLine.FileNames();
+	Msg::CLocaleCompiler compiler( fileNames[0], commandLine.WorkerCount(), commandLine.Options() );
+	const int failedCount = compiler.Compile( fileNames[1], fileNames[2] );
+	return failedCount == 0 ? 0 : -1;
+}
+
+static int compileFile( const Msg::CCommandLine& commandLine )
+{
+	const auto fileNames = commandLine.FileNames();
+	CUnicodeView msgFile = fileNames[0];
+	CUnicodeView srcOutputFile = fileNames[1];
+	CUnicodeView binOutputFile = fileNames[2];
+
+	Msg::CMessageCompiler::CompileFile( msgFile, srcOutputFile, binOutputFile, commandLine.Options() );
+	return 0;
+}
+
+static int watchFile( const Msg::CCommandLine& commandLine )
 {
-	assert( argc == 4 );
-	CUnicodeView msgFile = argv[1];
-	CUnicodeView srcOutputFile = argv[2];
-	CUnicodeView binOutputFile = argv[3];
+	const auto fileNames = commandLine.FileNames();
+	Msg::CMessageCompiler::WatchFile( fileNames[0], fileNames[1], fileNames[2], commandLine.Options() );
+	return 0;
+}
 
+int wmain( int argc, wchar_t* argv[] )
+{
 	try {
-		Msg::CMessageCompiler compiler( msgFile );
-		compiler.Compile( srcOutputFile, binOutputFile );
+		const Msg::CCommandLine commandLine( argc, argv );
+		if( commandLine.Options().Stats != Msg::SF_None ) {
+			Msg::CCompileStats::EnableAllocationCounting();
+		}
+		if( commandLine.IsBatchMode() ) {
+			return compileBatch( commandLine );
+		}
+		if( commandLine.IsWatchMode() ) {
+			return watchFile( commandLine );
+		}
+		return commandLine.IsLocaleMode() ? compileLocales( commandLine ) : compileFile( commandLine );
 	} catch( CException& e ) {
 		Log::Exception( e );
 		return -1;
 	}
-	return 0;
 }
 